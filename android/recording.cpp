@@ -42,8 +42,7 @@ namespace {
         callback.log("Detection started");
 
         while (!global.stop) {
-            global.exchange->swapReceive(input);
-            if (global.stop) break;
+            if (!global.exchange->swapReceive(input)) break;
 
             frameStats.tick();
             sectionStats.start();
@@ -69,6 +68,10 @@ namespace {
             }
         }
 
+        std::ostringstream oss;
+        oss << "Detection stopped, dropped " << global.exchange->dropped() << " of "
+            << global.exchange->accepted() << " frames";
+        callback.log(oss.str().c_str());
         global.callbackRef.release(env);
     }
 
@@ -85,7 +88,9 @@ void Java_cz_fmo_Lib_detectionStart(JNIEnv* env, jclass, jint width, jint height
     global.dims = {width, height};
     env->GetJavaVM(&global.javaVM);
     global.stop = false;
-    global.exchange.reset(new fmo::Exchange<fmo::Image>(global.format, global.dims));
+    // only the most recent frame is worth processing
+    global.exchange.reset(new fmo::Exchange<fmo::Image>(fmo::ExchangePolicy::DROP_OLDEST, 1,
+                                                        global.format, global.dims));
     global.callbackRef = {env, cbObj};
 
     std::thread thread(threadImpl);
@@ -1,6 +1,8 @@
 #include "args.hpp"
 #include <iostream>
+#include <sstream>
 #include <fmo/assert.hpp>
+#include <fmo/isa.hpp>
 
 namespace {
     using doc_t = const char* const;
@@ -16,6 +18,13 @@ namespace {
     doc_t listDoc = "Display available algorithm names. Use --algorithm to select an algorithm.";
     doc_t headlessDoc = "Don't draw any GUI unless the playback is paused. Must not be used with "
                         "--wait, --fast.";
+    doc_t jobsDoc = "<n> Processes up to n input files at once, each with its own instance of the "
+                    "algorithm. The results are the same as when processing the files one by one. "
+                    "Must be used with --headless. Must not be used with --camera, --frame, "
+                    "--paused, --pause-fn|fp|rg|im.";
+    doc_t isaDoc = "<name> Forces the instruction set used by the image processing kernels: scalar, "
+                   "sse2, avx2, avx512bw or neon. By default, the best one supported by the CPU "
+                   "is used. Overrides the FMO_ISA environment variable.";
     doc_t demoDoc = "Force demo visualization method. This visualization method is preferred when "
                     "--camera is used.";
     doc_t debugDoc = "Force debug visualization method. This visualization method is preferred "
@@ -46,6 +55,11 @@ namespace {
                       "camera, if available. Must not be used with --input, --wait, --fast, "
                       "--frame, --pause.";
     doc_t yuvDoc = "Feed image data into the algorithm in YCbCr color space.";
+    doc_t roiDoc = "<x,y,w,h> Restricts detection to a rectangle, in input frame pixels. Can be "
+                   "used multiple times. Only supported by --algorithm taxonomy-v1.";
+    doc_t roiMaskDoc = "<path> Image whose non-zero pixels mark the area where objects are "
+                       "detected. Can be combined with --roi. Only supported by --algorithm "
+                       "taxonomy-v1.";
     doc_t recordDirDoc = "<dir> Output directory to save video to. A new video file will be "
                          "created, storing the input video with optionally overlaid detections. The name of the video file "
                          "will be determined by system time. The directory must exist.";
@@ -88,6 +102,7 @@ Args::Args(int argc, char** argv)
       names(),
       camera(-1),
       yuv(false),
+      roiMask(),
       recordDir("."),
       pauseFn(false),
       pauseFp(false),
@@ -101,6 +116,7 @@ Args::Args(int argc, char** argv)
       wait(-1),
       tex(false),
       headless(false),
+      jobs(1),
       demo(false),
       tutdemo(false),
       utiademo(false),
@@ -116,7 +132,79 @@ Args::Args(int argc, char** argv)
       mHelp(false),
       mDefaults(false),
       mList(false) {
+    addParameters();
 
+    // parse command-line
+    mParser.parse(argc, argv);
+
+    // if requested, display help and exit
+    if (mHelp) {
+        mParser.printHelp(std::cerr);
+        std::exit(-1);
+    }
+
+    // if requested, display defaults and exit
+    if (mDefaults) {
+        mDefaults = false;
+        mParser.printValues(std::cerr, '\n');
+        std::exit(-1);
+    }
+
+    // if requested, display list and exit
+    if (mList) {
+        auto algoNames = fmo::Algorithm::listFactories();
+        for (auto& name : algoNames) { std::cerr << name << '\n'; }
+        std::exit(-1);
+    }
+
+    // validate parameters, throw if there is trouble
+    validate();
+
+    if (!roiMask.empty()) { params.roiMask = fmo::Image{roiMask, fmo::Format::GRAY}; }
+}
+
+Args::Args(const Args& other)
+    : inputs(other.inputs),
+      gts(other.gts),
+      names(other.names),
+      camera(other.camera),
+      yuv(other.yuv),
+      roiMask(other.roiMask),
+      recordDir(other.recordDir),
+      pauseFn(other.pauseFn),
+      pauseFp(other.pauseFp),
+      pauseRg(other.pauseRg),
+      pauseIm(other.pauseIm),
+      evalDir(other.evalDir),
+      inputDir(other.inputDir),
+      gtDir(other.gtDir),
+      detectDir(other.detectDir),
+      scoreFile(other.scoreFile),
+      baseline(other.baseline),
+      frame(other.frame),
+      wait(other.wait),
+      tex(other.tex),
+      headless(other.headless),
+      jobs(other.jobs),
+      demo(other.demo),
+      tutdemo(other.tutdemo),
+      utiademo(other.utiademo),
+      debug(other.debug),
+      removal(other.removal),
+      noRecord(other.noRecord),
+      exposure(other.exposure),
+      fps(other.fps),
+      radius(other.radius),
+      p2cm(other.p2cm),
+      params(other.params),
+      mParser(),
+      mHelp(false),
+      mDefaults(false),
+      mList(false) {
+    addParameters();
+}
+
+void Args::addParameters() {
     // add commands
     mParser.add("\nHelp:");
     mParser.add("--help", helpDoc, mHelp);
@@ -128,6 +216,9 @@ Args::Args(int argc, char** argv)
 
     mParser.add("\nMode selection:");
     mParser.add("--headless", headlessDoc, headless);
+    mParser.add("--jobs", jobsDoc, jobs);
+    mParser.add("--isa", isaDoc,
+                [](const std::string& name) { fmo::setIsa(fmo::isaFromName(name.c_str())); });
     mParser.add("--demo", demoDoc, demo);
     mParser.add("--tutdemo", demoDoc, tutdemo);
     mParser.add("--utiademo", demoDoc, utiademo);
@@ -151,6 +242,17 @@ Args::Args(int argc, char** argv)
     mParser.add("--baseline", baselineDoc, baseline);
     mParser.add("--camera", cameraDoc, camera);
     mParser.add("--yuv", yuvDoc, yuv);
+    mParser.add("--roi", roiDoc, [this](const std::string& rect) {
+        int x, y, w, h;
+        char sep[3];
+        std::istringstream in{rect};
+        in >> x >> sep[0] >> y >> sep[1] >> w >> sep[2] >> h;
+        if (!in || sep[0] != ',' || sep[1] != ',' || sep[2] != ',' || w <= 0 || h <= 0) {
+            throw std::runtime_error("--roi expects a rectangle in the form x,y,w,h");
+        }
+        params.roi.push_back({{x, y}, {x + w - 1, y + h - 1}});
+    });
+    mParser.add("--roi-mask", roiMaskDoc, roiMask);
 
     mParser.add("\nOutput:");
     mParser.add("--record-dir", recordDirDoc, recordDir);
@@ -177,10 +279,12 @@ Args::Args(int argc, char** argv)
     mParser.add("--p-diff-adjust-period", paramDocI, params.diff.adjustPeriod);
     mParser.add("--p-diff-min-noise", paramDocF, params.diff.noiseMin);
     mParser.add("--p-diff-max-noise", paramDocF, params.diff.noiseMax);
+    mParser.add("--p-background-window", paramDocI, params.backgroundWindow);
     mParser.add("--p-max-gap-x", paramDocF, params.maxGapX);
     mParser.add("--p-min-gap-y", paramDocF, params.minGapY);
     mParser.add("--p-max-image-height", paramDocI, params.maxImageHeight);
     mParser.add("--p-image-height", paramDocI, params.imageHeight);
+    mParser.add("--p-gray-only", paramDocB, params.grayOnly);
     mParser.add("--p-min-strip-height", paramDocI, params.minStripHeight);
     mParser.add("--p-min-strips-in-object", paramDocI, params.minStripsInObject);
     mParser.add("--p-min-strip-area", paramDocF, params.minStripArea);
@@ -214,32 +318,7 @@ Args::Args(int argc, char** argv)
     mParser.add("--p-max-distance", paramDocF, params.maxDistance);
     mParser.add("--p-max-gaps-length", paramDocF, params.maxGapsLength);
     mParser.add("--p-min-motion", paramDocF, params.minMotion);
-
-    // parse command-line
-    mParser.parse(argc, argv);
-
-    // if requested, display help and exit
-    if (mHelp) {
-        mParser.printHelp(std::cerr);
-        std::exit(-1);
-    }
-
-    // if requested, display defaults and exit
-    if (mDefaults) {
-        mDefaults = false;
-        mParser.printValues(std::cerr, '\n');
-        std::exit(-1);
-    }
-
-    // if requested, display list and exit
-    if (mList) {
-        auto algoNames = fmo::Algorithm::listFactories();
-        for (auto& name : algoNames) { std::cerr << name << '\n'; }
-        std::exit(-1);
-    }
-
-    // validate parameters, throw if there is trouble
-    validate();
+    mParser.add("--p-gray-diff", paramDocB, params.grayDiff);
 }
 
 void Args::validate() const {
@@ -289,6 +368,17 @@ void Args::validate() const {
     if (headless && wait != -1) {
         throw std::runtime_error("--headless cannot be used with --wait or --fast");
     }
+    if (jobs < 1) { throw std::runtime_error("--jobs must be at least 1"); }
+    if (jobs > 1) {
+        if (!headless) { throw std::runtime_error("--jobs must be used with --headless"); }
+        if (camera != -1) { throw std::runtime_error("--jobs cannot be used with --camera"); }
+        if (frame != -1) {
+            throw std::runtime_error("--jobs cannot be used with --frame or --paused");
+        }
+        if (pauseFn || pauseFp || pauseRg || pauseIm) {
+            throw std::runtime_error("--jobs cannot be used with --pause-fn|fp|rg|im");
+        }
+    }
     if (evalDir.empty() && tex) {
         throw std::runtime_error("--tex cannot be used without --eval-dir");
     }
@@ -9,11 +9,17 @@ struct Args {
     /// Read arguments from the command line. Throws exceptions if there are any errors.
     Args(int argc, char** argv);
 
+    /// Copies the settings without parsing the command line again. The copy registers its own
+    /// fields with its own parser, so that printParameters() reports the values of the copy.
+    Args(const Args& other);
+    Args& operator=(const Args&) = delete;
+
     std::vector<std::string> inputs; ///< paths to video files to use as inputs
     std::vector<std::string> gts;    ///< paths to ground truth text files, enables evaluation
     std::vector<std::string> names;  ///< names of inputs to be displayed in the report table
     int camera;                      ///< camera ID to use as input
     bool yuv;                        ///< force YCbCr color space
+    std::string roiMask;             ///< path to an image restricting the area of detection
     std::string recordDir;           ///< directory to save recording to
     bool pauseFn;                    ///< pause when a false negative is encountered
     bool pauseFp;                    ///< pause when a false positive is encountered
@@ -29,6 +35,7 @@ struct Args {
     int wait;                        ///< frame time in milliseconds
     bool tex;                        ///< format tables in the report as TeX tables
     bool headless;                   ///< don't draw GUI unless the playback is paused
+    int jobs;                        ///< number of input files to process in parallel
     bool demo;                       ///< force demo visualizer
     bool tutdemo;                    ///< force tutdemo visualizer
     bool utiademo;                   ///< force utiademo visualizer
@@ -45,6 +52,7 @@ struct Args {
     void printParameters(std::ostream& out, char sep) const { mParser.printValues(out, sep); }
 
 private:
+    void addParameters();
     void validate() const;
 
     Parser mParser;
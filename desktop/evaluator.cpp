@@ -79,6 +79,16 @@ const FileResults& Results::getFile(const std::string& name) const {
     return *found->second;
 }
 
+void Results::merge(Results&& other) {
+    for (auto& file : other.mList) {
+        auto& mine = newFile(file.name);
+        mine.frames = std::move(file.frames);
+        mine.iou = std::move(file.iou);
+    }
+    other.mMap.clear();
+    other.mList.clear();
+}
+
 namespace {
     std::string introToken{"/FMO/EVALUATION/V3/"};
     constexpr Event eventOrder[4] = {Event::FN, Event::FP, Event::TN, Event::TP};
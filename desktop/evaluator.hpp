@@ -83,6 +83,10 @@ struct Results {
     /// empty data structure is returned.
     const FileResults& getFile(const std::string& name) const;
 
+    /// Moves data regarding all files from another instance. Files that are already present are
+    /// overwritten. The order of the files is preserved.
+    void merge(Results&& other);
+
     /// Loads results from a stream.
     void load(std::istream& in);
 
@@ -2,9 +2,13 @@
 #include <iostream>
 #include <typeinfo>
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 bool replace(std::string& str, const std::string& from, const std::string& to) {
     size_t start_pos = str.find(from);
@@ -14,6 +18,56 @@ bool replace(std::string& str, const std::string& from, const std::string& to) {
     return true;
 }
 
+/// Processes the input files using several worker threads. Each worker has its own settings,
+/// algorithm instance and evaluator. Evaluation results and detection reports are kept separately
+/// for each file and merged in the order of the inputs once all work is done, so that the output
+/// does not depend on the number of workers. The progress messages about each file are buffered
+/// and printed in the order of the inputs as well.
+std::vector<Statistics> processParallel(Status& s) {
+    const size_t numInputs = s.args.inputs.size();
+    std::vector<Statistics> stats(numInputs);
+    std::vector<Results> results(numInputs);
+    std::vector<std::unique_ptr<DetectionReport>> reports(numInputs);
+    std::vector<std::string> messages(numInputs);
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&]() {
+        try {
+            Status w{s.args};
+            if (!w.args.baseline.empty()) { w.baseline.load(w.args.baseline); }
+
+            for (size_t i; (i = next++) < numInputs;) {
+                if (s.rpt) { w.rpt.reset(new DetectionReport()); }
+                std::ostringstream console;
+                w.console = &console;
+                stats[i] = processVideo(w, i);
+                messages[i] = console.str();
+                std::swap(results[i], w.results);
+                reports[i] = std::move(w.rpt);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) error = std::current_exception();
+            next = numInputs;
+        }
+    };
+
+    size_t numWorkers = std::min(size_t(s.args.jobs), numInputs);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < numWorkers; i++) { workers.emplace_back(work); }
+    for (auto& worker : workers) { worker.join(); }
+    if (error) std::rethrow_exception(error);
+
+    for (size_t i = 0; i < numInputs; i++) {
+        *s.console << messages[i];
+        s.results.merge(std::move(results[i]));
+        if (s.rpt) { s.rpt->append(*reports[i]); }
+    }
+    return stats;
+}
+
 int main(int argc, char** argv) try
 {
     Status s{argc, argv};
@@ -59,16 +113,15 @@ int main(int argc, char** argv) try
     }
 
     std::vector<Statistics> stats(s.args.inputs.size());
-    for (size_t i = 0; !s.quit && i < s.args.inputs.size(); i++) {
-//        try {
+    if (s.args.jobs > 1) {
+        stats = processParallel(s);
+    } else {
+        for (size_t i = 0; !s.quit && i < s.args.inputs.size(); i++) {
             do {
                 s.reload = false;
                 stats[i] = processVideo(s, i);
             } while (s.reload);
-//        } catch (std::exception& e) {
-//            std::cerr << "while playing '" << s.args.inputs.at(i) << "'\n";
-//            throw e;
-//        }
+        }
     }
 
     EvaluationReport report(s.results, s.baseline, s.args, s.date,
@@ -2,8 +2,11 @@
 #include "objectset.hpp"
 #include "video.hpp"
 #include <fmo/processing.hpp>
+#include <fmo/queue.hpp>
 #include <fmo/stats.hpp>
+#include <exception>
 #include <stack>
+#include <thread>
 #include <ctime>
 #include <unistd.h>
 #include <vector>
@@ -27,11 +30,225 @@ void toc() {
 
 namespace {
     const std::vector<fmo::PointSet> noObjects;
+
+    /// The number of items that may wait between two stages of the pipeline.
+    const size_t PIPELINE_DEPTH = 4;
+
+    /// Detection that keeps a copy of its points, so that it remains valid after the algorithm
+    /// moves on to the next frame.
+    struct DetachedDetection : public fmo::Algorithm::Detection {
+        DetachedDetection(const Detection& d) : Detection(d.object, d.predecessor) {
+            d.getPoints(mPoints);
+        }
+
+        virtual void getPoints(fmo::PointSet& out) const override { out = mPoints; }
+
+    private:
+        fmo::PointSet mPoints;
+    };
+
+    /// Detections of a single frame, passed from the detection stage to the reporting stage.
+    struct FrameOutput {
+        int outFrameNum = 0;
+        fmo::Algorithm::Output output;
+    };
+
+    /// Pipelining is only possible when nothing needs to inspect the algorithm in between frames,
+    /// i.e. when processing a file without visualization and without pausing.
+    bool canPipeline(const Status& s) {
+        const Args& a = s.args;
+        return !s.haveCamera() && a.headless && !s.paused && !s.haveFrame() && !a.pauseFn &&
+               !a.pauseFp && !a.pauseRg && !a.pauseIm;
+    }
+
+    /// Processes the input one frame at a time, allowing visualization and interaction.
+    void processSequential(Status& s, VideoInput& input, fmo::Algorithm& algorithm,
+                           fmo::Format format, fmo::Dims dims, Evaluator* evaluator,
+                           DetectionReport::Sequence* sequenceReport, Statistics& stat) {
+        fmo::Region frame;
+        fmo::Algorithm::Output outputCache;
+        EvalResult evalResult;
+
+        for (; !s.quit && !s.reload; s.inFrameNum++, s.outFrameNum++) {
+            // end the video early when GT requests it
+            bool allowNewFrames = true;
+            if (evaluator) {
+                int numGtFrames = evaluator->gt().numFrames();
+                if (s.outFrameNum > numGtFrames) {
+                    // end the loop once evaluation is done
+                    break;
+                } else if (s.inFrameNum > numGtFrames) {
+                    // stop receiving fresh frames once GT ends
+                    allowNewFrames = false;
+                }
+            }
+
+            // read video
+            if (allowNewFrames) {
+                frame = input.receiveFrame();
+                if (frame.data() == nullptr) {
+                    // end the loop unconditionally when a new frame is needed but is not available
+                    break;
+                }
+                if (s.haveCamera()) {
+                    fmo::flip(frame,frame);
+                }
+            }
+
+            // process
+            fmo::convert(frame, algorithm.acquireInputBuffer(), format);
+            algorithm.commitInput();
+            algorithm.getOutput(outputCache, false);
+            stat.nextFrame((int)outputCache.detections.size());
+
+            // evaluate
+            if (evaluator) {
+                if (s.outFrameNum >= 1) {
+                    evaluator->evaluateFrame(outputCache, s.outFrameNum, evalResult, s.args.params.iouThreshold);
+                    if (s.args.pauseFn && evalResult.eval[Event::FN] > 0) s.paused = true;
+                    if (s.args.pauseFp && evalResult.eval[Event::FP] > 0) s.paused = true;
+                    if (s.args.pauseRg && evalResult.comp == Comparison::REGRESSION) s.paused = true;
+                    if (s.args.pauseIm && evalResult.comp == Comparison::IMPROVEMENT) s.paused = true;
+                } else {
+                    evalResult.clear();
+                    evalResult.comp = Comparison::BUFFERING;
+                }
+            }
+
+            // write to detection report
+            if (sequenceReport) { sequenceReport->writeFrame(s.outFrameNum, outputCache, evalResult); }
+
+            // pause when the sought-for frame number is encountered
+            if (s.args.frame == s.inFrameNum) {
+                s.unsetFrame();
+                s.paused = true;
+            }
+
+            // skip other steps if seeking
+            if (s.haveFrame()) continue;
+
+            // skip visualization if in headless mode (but not paused)
+            if (s.args.headless && !s.paused) continue;
+
+            // visualize
+            s.visualizer->visualize(s, frame, evaluator, evalResult, algorithm);
+        }
+    }
+
+    /// Processes a file in three stages running in separate threads: decoding with format
+    /// conversion, detection, and evaluation with reporting. The stages are connected by bounded
+    /// queues, so the throughput is given by the slowest stage. Decoded image buffers are
+    /// recycled through a queue of free images. The results are the same as with the sequential
+    /// loop.
+    void processPipelined(Status& s, VideoInput& input, fmo::Algorithm& algorithm,
+                          fmo::Format format, fmo::Dims dims, Evaluator* evaluator,
+                          DetectionReport::Sequence* sequenceReport, Statistics& stat) {
+        const int numGtFrames = evaluator ? evaluator->gt().numFrames() : 0;
+        fmo::BoundedQueue<fmo::Image> freeImages{PIPELINE_DEPTH + 2};
+        fmo::BoundedQueue<fmo::Image> decoded{PIPELINE_DEPTH};
+        fmo::BoundedQueue<FrameOutput> freeOutputs{PIPELINE_DEPTH + 1};
+        fmo::BoundedQueue<FrameOutput> detected{PIPELINE_DEPTH};
+        for (size_t i = 0; i < PIPELINE_DEPTH + 1; i++) {
+            freeImages.push(fmo::Image{format, dims});
+            freeOutputs.push(FrameOutput{});
+        }
+
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto fail = [&]() {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) error = std::current_exception();
+            freeImages.close();
+            decoded.close();
+            freeOutputs.close();
+            detected.close();
+        };
+
+        // decoding stage
+        std::thread decoder([&]() {
+            try {
+                for (int inFrameNum = 1; !evaluator || inFrameNum <= numGtFrames; inFrameNum++) {
+                    fmo::Image image;
+                    if (!freeImages.pop(image)) break;
+                    if (format == fmo::Format::BGR) {
+                        // the decoded frame can be passed on without a copy
+                        if (!input.receiveFrameSwap(image)) break;
+                    } else {
+                        fmo::Region frame = input.receiveFrame();
+                        if (frame.data() == nullptr) break;
+                        fmo::convert(frame, image, format);
+                    }
+                    if (!decoded.push(std::move(image))) break;
+                }
+                decoded.close();
+            } catch (...) { fail(); }
+        });
+
+        // evaluation and reporting stage
+        std::thread reporter([&]() {
+            try {
+                FrameOutput item;
+                EvalResult evalResult;
+                while (detected.pop(item)) {
+                    stat.nextFrame((int)item.output.detections.size());
+                    if (evaluator) {
+                        if (item.outFrameNum >= 1) {
+                            evaluator->evaluateFrame(item.output, item.outFrameNum, evalResult,
+                                                     s.args.params.iouThreshold);
+                        } else {
+                            evalResult.clear();
+                            evalResult.comp = Comparison::BUFFERING;
+                        }
+                    }
+                    if (sequenceReport) {
+                        sequenceReport->writeFrame(item.outFrameNum, item.output, evalResult);
+                    }
+                    if (!freeOutputs.push(std::move(item))) break;
+                }
+            } catch (...) { fail(); }
+        });
+
+        // detection stage
+        try {
+            fmo::Image image;
+            fmo::Image last;
+            for (; ; s.inFrameNum++, s.outFrameNum++) {
+                // once GT ends, keep feeding the last frame until evaluation is done
+                if (evaluator && s.outFrameNum > numGtFrames) break;
+                if (evaluator && s.inFrameNum > numGtFrames) {
+                    fmo::copy(last, image);
+                    algorithm.setInputSwap(image);
+                } else {
+                    if (!decoded.pop(image)) break;
+                    if (evaluator && s.inFrameNum == numGtFrames) fmo::copy(image, last);
+                    algorithm.setInputSwap(image);
+                    if (!freeImages.push(std::move(image))) break;
+                }
+
+                FrameOutput item;
+                if (!freeOutputs.pop(item)) break;
+                algorithm.getOutput(item.output, false);
+                for (auto& detection : item.output.detections) {
+                    detection.reset(new DetachedDetection(*detection));
+                }
+                item.outFrameNum = s.outFrameNum;
+                if (!detected.push(std::move(item))) break;
+            }
+        } catch (...) { fail(); }
+
+        // make the other stages finish
+        freeImages.close();
+        decoded.close();
+        detected.close();
+        decoder.join();
+        reporter.join();
+        if (error) std::rethrow_exception(error);
+    }
 }
 
 Statistics processVideo(Status& s, size_t inputNum) {
     // open input
-    if(s.args.names.size() > inputNum) std::cout << "Processing " << s.args.names.at(inputNum) << std::endl;
+    if(s.args.names.size() > inputNum) *s.console << "Processing " << s.args.names.at(inputNum) << std::endl;
     auto input = (!s.haveCamera()) ? VideoInput::makeFromFile(s.args.inputs.at(inputNum))
                                    : VideoInput::makeFromCamera(s.args.camera);
 
@@ -39,8 +256,8 @@ Statistics processVideo(Status& s, size_t inputNum) {
         input->set_exposure(s.args.exposure); 
     if(s.args.fps != -1)
         input->set_fps(s.args.fps); 
-    std::cout << "Exposure value: " << input->get_exposure() << std::endl;
-    std::cout << "FPS: " << input->fps() << std::endl;
+    *s.console << "Exposure value: " << input->get_exposure() << std::endl;
+    *s.console << "FPS: " << input->fps() << std::endl;
 
     auto dims = input->dims();
     float fps = input->fps();
@@ -71,83 +288,20 @@ Statistics processVideo(Status& s, size_t inputNum) {
 
     // setup caches
     fmo::Format format = s.args.yuv ? fmo::Format::YUV : fmo::Format::BGR;
-    std::vector<fmo::PointSet> objectVec;
-    objectVec.resize(1);
     auto algorithm = fmo::Algorithm::make(s.args.params, format, dims);
-    fmo::Region frame;
-    fmo::Image frameCopy{format, dims};
-    fmo::Algorithm::Output outputCache;
-    EvalResult evalResult;
     s.inFrameNum = 1;
     s.outFrameNum = 1 + algorithm->getOutputOffset();
 
     Statistics stat;
-    for (; !s.quit && !s.reload; s.inFrameNum++, s.outFrameNum++) {
-        // end the video early when GT requests it
-        bool allowNewFrames = true;
-        if (evaluator) {
-            int numGtFrames = evaluator->gt().numFrames();
-            if (s.outFrameNum > numGtFrames) {
-                // end the loop once evaluation is done
-                break;
-            } else if (s.inFrameNum > numGtFrames) {
-                // stop receiving fresh frames once GT ends
-                allowNewFrames = false;
-            }
-        }
-
-        // read video
-        if (allowNewFrames) {
-            frame = input->receiveFrame();
-            if (frame.data() == nullptr) {
-                // end the loop unconditionally when a new frame is needed but is not available
-                break;
-            }
-            if (s.haveCamera()) {
-                fmo::flip(frame,frame);
-            }
-        }
-
-        // process
-        fmo::convert(frame, frameCopy, format);
-        algorithm->setInputSwap(frameCopy);
-        algorithm->getOutput(outputCache, false);
-        stat.nextFrame((int)outputCache.detections.size());
-
-        // evaluate
-        if (evaluator) {
-            if (s.outFrameNum >= 1) {
-                evaluator->evaluateFrame(outputCache, s.outFrameNum, evalResult, s.args.params.iouThreshold);
-                if (s.args.pauseFn && evalResult.eval[Event::FN] > 0) s.paused = true;
-                if (s.args.pauseFp && evalResult.eval[Event::FP] > 0) s.paused = true;
-                if (s.args.pauseRg && evalResult.comp == Comparison::REGRESSION) s.paused = true;
-                if (s.args.pauseIm && evalResult.comp == Comparison::IMPROVEMENT) s.paused = true;
-            } else {
-                evalResult.clear();
-                evalResult.comp = Comparison::BUFFERING;
-            }
-        }
-
-        // write to detection report
-        if (sequenceReport) { sequenceReport->writeFrame(s.outFrameNum, outputCache, evalResult); }
-
-        // pause when the sought-for frame number is encountered
-        if (s.args.frame == s.inFrameNum) {
-            s.unsetFrame();
-            s.paused = true;
-        }
-
-        // skip other steps if seeking
-        if (s.haveFrame()) continue;
-
-        // skip visualization if in headless mode (but not paused)
-        if (s.args.headless && !s.paused) continue;
-
-        // visualize
-        s.visualizer->visualize(s, frame, evaluator.get(), evalResult, *algorithm);
+    if (canPipeline(s)) {
+        processPipelined(s, *input, *algorithm, format, dims, evaluator.get(),
+                         sequenceReport.get(), stat);
+    } else {
+        processSequential(s, *input, *algorithm, format, dims, evaluator.get(),
+                          sequenceReport.get(), stat);
     }
 
-    stat.print();
+    stat.print(*s.console);
     input->default_camera();                               
     return stat;
 }
@@ -345,9 +345,6 @@ void DemoVisualizer::onDetection(const Status& s, const fmo::Algorithm::Detectio
         }
         mEventsDetected++;
         mSegments.clear();
-        for(auto& c : mCurves) {
-            delete c;
-        }
         mCurves.clear();
     }
     mLastDetectFrame = s.outFrameNum;
@@ -357,10 +354,9 @@ void DemoVisualizer::onDetection(const Status& s, const fmo::Algorithm::Detectio
         fmo::Bounds segment = {detection.predecessor.center, detection.object.center};
         mSegments.push_back(segment);
         // std::cout << "-----------------------------\n";
-    } else if (detection.object.curve != nullptr) {
-        fmo::SCurve *c = detection.object.curve->clone();
-        c->scale = detection.object.scale;
-        mCurves.push_back(c);
+    } else if (!detection.object.curve.empty()) {
+        mCurves.push_back(detection.object.curve);
+        mCurves.back().common().scale = detection.object.scale;
         float radiusCm = s.args.radius; // floorball = 3.6; tennis = 3.27
         float sp = 0;
         float fpsReal = 29.97;
@@ -393,17 +389,15 @@ void DemoVisualizer::onDetection(const Status& s, const fmo::Algorithm::Detectio
         }
     }
 
-    if(detection.object.curve != nullptr) mMaxSpeed = mSpeedNow;
+    if(!detection.object.curve.empty()) mMaxSpeed = mSpeedNow;
 
     // make sure to keep the number of segments bounded in case there's a long event
     if (mSegments.size() > MAX_SEGMENTS) {
         mSegments.erase(begin(mSegments), begin(mSegments) + (mSegments.size() / 2));
     }
     int maxCurves = 20;
-    for (int i = 0; i < int(mCurves.size()) - maxCurves; ++i)
-    {
-        delete mCurves[0];
-        mCurves.erase(mCurves.begin());
+    if (int(mCurves.size()) > maxCurves) {
+        mCurves.erase(begin(mCurves), end(mCurves) - maxCurves);
     }
 }
 
@@ -426,7 +420,7 @@ void DemoVisualizer::drawSegments(fmo::Image& im) {
         color.r = std::max(color.r, uint8_t(color.r + 4));
         cv::Scalar cvColor(color.b, color.g, color.r);
 
-        curve->drawSmooth(mat, cvColor, thickness);
+        curve.drawSmooth(mat, cvColor, thickness);
     }
 }
 
@@ -435,9 +429,6 @@ void DemoVisualizer::process(Status& s, const fmo::Region& frame, fmo::Algorithm
     if (s.outFrameNum < mLastDetectFrame) {
         mEventsDetected = s.outFrameNum;
         mSegments.clear();
-        for(auto& c : mCurves) {
-            delete c;
-        }
         mCurves.clear();
     }
 
@@ -23,7 +23,7 @@ public:
     }
 
     float getMean() { return (float)totalDetections/nFrames; }
-    void print() {std::cout << "Detections: total - " << totalDetections <<
+    void print(std::ostream& out) {out << "Detections: total - " << totalDetections <<
                             ", average - " << getMean() << std::endl;}
     int totalDetections = 0;
     int nFrames = 0;
@@ -47,8 +47,10 @@ struct Status {
     bool reload = false;                    ///< load the same video again
     bool sound = false;                     ///< play sounds
     std::string inputString = "Baseline";
+    std::ostream* console = &std::cout;     ///< stream for progress messages about each input
 
     Status(int argc, char** argv) : args(argc, argv) {}
+    Status(const Args& aArgs) : args(aArgs) {}
     bool haveCamera() const { return args.camera != -1; }
     bool haveWait() const { return args.wait != -1; }
     bool haveFrame() const { return args.frame != -1; }
@@ -127,7 +129,7 @@ private:
     std::unique_ptr<AutomaticRecorder> mAutomatic; ///< for automatic-mode recording
     fmo::Algorithm::Output mOutput;                ///< cached output object
     std::vector<fmo::Bounds> mSegments;            ///< object path being visualized
-    std::vector<fmo::SCurve*> mCurves;             ///< curves being visualized
+    std::vector<fmo::Curve> mCurves;               ///< curves being visualized
     int mEventsDetected = 0;                       ///< event counter
     int mMaxDetections = 0;
     int mLastDetectFrame = -EVENT_GAP_FRAMES;      ///< the frame when the last detection happened
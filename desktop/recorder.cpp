@@ -3,6 +3,7 @@
 #include <fmo/assert.hpp>
 #include <fmo/processing.hpp>
 #include <fmo/region.hpp>
+#include <iostream>
 
 // RecordingThread
 
@@ -12,21 +13,25 @@ RecordingThread::RecordingThread(const std::string& dir, fmo::Format format, fmo
       mDims(dims),
       mVideoOutput(VideoOutput::makeInDirectory(dir, dims, fps)),
       mStop(false),
-      mExchange(format, dims),
+      mExchange(fmo::ExchangePolicy::DROP_OLDEST, EXCHANGE_CAPACITY, format, dims),
       mThread(threadImpl, this) {}
 
 RecordingThread::~RecordingThread() {
     mStop = true;
     mExchange.exit();
     mThread.join();
+
+    if (mExchange.dropped() > 0) {
+        std::cerr << "Recording dropped " << mExchange.dropped() << " of "
+                  << mExchange.accepted() << " frames\n";
+    }
 }
 
 void RecordingThread::threadImpl(RecordingThread* self) {
     fmo::Image input{self->mFormat, self->mDims};
 
     while (!self->mStop) {
-        self->mExchange.swapReceive(input);
-        if (self->mStop) return;
+        if (!self->mExchange.swapReceive(input)) return;
         self->mVideoOutput->sendFrame(input);
     }
 }
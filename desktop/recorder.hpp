@@ -14,6 +14,9 @@ struct RecordingThread {
     void swapSend(fmo::Image& input);
 
 private:
+    /// The number of frames that may wait for encoding before the oldest ones get dropped.
+    static constexpr size_t EXCHANGE_CAPACITY = 4;
+
     static void threadImpl(RecordingThread* self);
 
     const fmo::Format mFormat;
@@ -7,9 +7,9 @@ namespace {
 // DetectionReport
 
 DetectionReport::DetectionReport(const std::string& directory, const Date& date)
-    : mOut(fileName(directory, date), std::ios_base::out | std::ios_base::binary) {
+    : mFile(fileName(directory, date), std::ios_base::out | std::ios_base::binary), mOut(mFile) {
 
-    if (!mOut) {
+    if (!mFile) {
         std::cerr << "failed to open '" << fileName(directory, date) << "'\n";
         throw std::runtime_error("failed to open detection report file for writing");
     }
@@ -19,7 +19,13 @@ DetectionReport::DetectionReport(const std::string& directory, const Date& date)
     mOut << space[0] << "<date>" << date.preciseStamp() << "</date>\n";
 }
 
-DetectionReport::~DetectionReport() { mOut << "</run>\n"; }
+DetectionReport::DetectionReport() : mOut(mBuffer) {}
+
+DetectionReport::~DetectionReport() {
+    if (mFile.is_open()) { mOut << "</run>\n"; }
+}
+
+void DetectionReport::append(const DetectionReport& other) { mOut << other.mBuffer.str(); }
 
 std::unique_ptr<DetectionReport::Sequence> DetectionReport::makeSequence(const std::string& input) {
     return std::make_unique<Sequence>(*this, input);
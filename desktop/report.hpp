@@ -7,6 +7,7 @@
 #include <fstream>
 #include <iosfwd>
 #include <memory>
+#include <sstream>
 
 /// For creating an evaluation report file, along with human-readable tables and statistics.
 struct EvaluationReport {
@@ -55,14 +56,24 @@ struct DetectionReport {
         DetectionReport* const me;
     };
 
+    /// Creates a report file in the specified directory.
     DetectionReport(const std::string& directory, const Date& date);
+
+    /// Creates a report that is kept in memory until it is appended to another report.
+    DetectionReport();
+
     ~DetectionReport();
     std::unique_ptr<Sequence> makeSequence(const std::string& input);
 
+    /// Writes all sequences of an in-memory report.
+    void append(const DetectionReport& other);
+
 private:
     static std::string fileName(const std::string& directory, const Date& date);
 
-    std::ofstream mOut;
+    std::ofstream mFile;
+    std::ostringstream mBuffer;
+    std::ostream& mOut; ///< either the file or the buffer
     fmo::PointSet mPointsCache;
 };
 
@@ -2,18 +2,105 @@
 #include "calendar.hpp"
 #include "desktop-opencv.hpp"
 #include <algorithm>
+#include <exception>
 #include <fmo/assert.hpp>
+#include <fmo/queue.hpp>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
+
+namespace {
+    /// The number of decoded frames kept in memory when reading from a file.
+    const size_t PREFETCH_DEPTH = 4;
+}
+
+// VideoInput::Prefetcher
+
+namespace {
+    /// Decodes the next frame directly into the provided image. Returns false if there are no
+    /// more frames.
+    bool decodeInto(cv::VideoCapture& cap, fmo::Image& image, fmo::Dims dims) {
+        image.resize(fmo::Format::BGR, dims);
+        cv::Mat mat = image.wrap();
+        cap >> mat;
+
+        if (mat.empty()) { return false; }
+
+        FMO_ASSERT(mat.type() == CV_8UC3, "bad type");
+        FMO_ASSERT(mat.cols == dims.width, "bad width");
+        FMO_ASSERT(mat.rows == dims.height, "bad height");
+        FMO_ASSERT(mat.data == image.data(), "frame not decoded in place");
+        return true;
+    }
+}
+
+/// Decodes frames in a background thread into a ring of reusable images. Images circulate
+/// between a queue of free images and a queue of decoded frames. Frames are handed over by
+/// swapping, so that the image of the consumer becomes a part of the ring.
+struct VideoInput::Prefetcher {
+    Prefetcher(cv::VideoCapture& cap, fmo::Dims dims, size_t depth)
+        : mFree(depth), mReady(depth) {
+        for (size_t i = 0; i < depth; i++) { mFree.push(fmo::Image{fmo::Format::BGR, dims}); }
+        mThread = std::thread([this, &cap, dims]() { decode(cap, dims); });
+    }
+
+    ~Prefetcher() {
+        mFree.close();
+        mReady.close();
+        mThread.join();
+    }
+
+    /// Swaps the oldest decoded frame into the provided image, recycling the previous contents
+    /// of the image. Returns false if there are no more frames.
+    bool receive(fmo::Image& frame) {
+        fmo::Image decoded;
+        if (!mReady.pop(decoded)) {
+            if (mError) { std::rethrow_exception(mError); }
+            return false;
+        }
+        frame.swap(decoded);
+        mFree.push(std::move(decoded));
+        return true;
+    }
+
+private:
+    void decode(cv::VideoCapture& cap, fmo::Dims dims) {
+        try {
+            fmo::Image image;
+            while (mFree.pop(image)) {
+                if (!decodeInto(cap, image, dims)) break;
+                if (!mReady.push(std::move(image))) break;
+            }
+        } catch (...) { mError = std::current_exception(); }
+        mReady.close();
+    }
+
+    fmo::BoundedQueue<fmo::Image> mFree;  ///< images ready to be decoded into
+    fmo::BoundedQueue<fmo::Image> mReady; ///< decoded frames, oldest first
+    std::exception_ptr mError;            ///< set by the decoding thread before it finishes
+    std::thread mThread;
+};
 
 // VideoInput
 
 VideoInput::~VideoInput() = default;
 VideoInput::VideoInput(VideoInput&& rhs) = default;
-VideoInput& VideoInput::operator=(VideoInput&&) = default;
+
+VideoInput& VideoInput::operator=(VideoInput&& rhs) {
+    // the decoding thread reads from the capture, so it must be joined before the capture is
+    // replaced; the default would destroy the capture first
+    stopPrefetch();
+    mFrame = std::move(rhs.mFrame);
+    mCap = std::move(rhs.mCap);
+    mPrefetch = std::move(rhs.mPrefetch);
+    mPrefetchDepth = rhs.mPrefetchDepth;
+    mDims = rhs.mDims;
+    mFps = rhs.mFps;
+    return *this;
+}
 
 VideoInput::VideoInput(std::unique_ptr<cv::VideoCapture>&& cap)
-    : mMat(std::make_unique<cv::Mat>()), mCap(std::move(cap)) {
+    : mCap(std::move(cap)) {
     if (!mCap->isOpened()) { throw std::runtime_error("failed to open video"); }
 
 #if CV_MAJOR_VERSION == 2
@@ -38,7 +125,9 @@ std::unique_ptr<VideoInput> VideoInput::makeFromCamera(int camId) {
 
 std::unique_ptr<VideoInput> VideoInput::makeFromFile(const std::string& filename) {
     try {
-        return std::make_unique<VideoInput>(std::make_unique<cv::VideoCapture>(filename));
+        auto input = std::make_unique<VideoInput>(std::make_unique<cv::VideoCapture>(filename));
+        input->mPrefetchDepth = PREFETCH_DEPTH;
+        return input;
     } catch (std::exception& e) {
         std::cerr << "while opening file '" << filename << "'\n";
         throw e;
@@ -46,16 +135,46 @@ std::unique_ptr<VideoInput> VideoInput::makeFromFile(const std::string& filename
 }
 
 fmo::Region VideoInput::receiveFrame() {
-    *mCap >> *mMat;
+    if (!receiveFrameSwap(mFrame)) { return {}; }
+
+    auto rowStep = size_t(3 * mDims.width);
+    return {fmo::Format::BGR, {0, 0}, mDims, mFrame.data(), nullptr, rowStep};
+}
 
-    if (mMat->empty()) { return {}; }
+bool VideoInput::receiveFrameSwap(fmo::Image& frame) {
+    if (mPrefetchDepth == 0) { return decodeInto(*mCap, frame, mDims); }
+    if (!mPrefetch) { mPrefetch = std::make_unique<Prefetcher>(*mCap, mDims, mPrefetchDepth); }
+    return mPrefetch->receive(frame);
+}
 
-    FMO_ASSERT(mMat->type() == CV_8UC3, "bad type");
-    FMO_ASSERT(mMat->cols == mDims.width, "bad width");
-    FMO_ASSERT(mMat->rows == mDims.height, "bad height");
+void VideoInput::stopPrefetch() { mPrefetch.reset(); }
 
-    auto rowStep = size_t(3 * mDims.width);
-    return {fmo::Format::BGR, {0, 0}, mDims, mMat->data, nullptr, rowStep};
+void VideoInput::restart() {
+    stopPrefetch();
+    mCap->set(CV_CAP_PROP_POS_AVI_RATIO, 0);
+}
+
+void VideoInput::set_fps(float fpsVal) {
+    stopPrefetch();
+    mCap->set(CV_CAP_PROP_FPS, fpsVal);
+    mFps = (float)mCap->get(CV_CAP_PROP_FPS);
+}
+
+double VideoInput::get_exposure() {
+    stopPrefetch();
+    return mCap->get(CV_CAP_PROP_EXPOSURE);
+}
+
+void VideoInput::set_exposure(float expVal) {
+    stopPrefetch();
+    mCap->set(CV_CAP_PROP_AUTO_EXPOSURE, 0.25);
+    mCap->set(CV_CAP_PROP_EXPOSURE, expVal);
+}
+
+void VideoInput::default_camera() {
+    stopPrefetch();
+    mCap->set(CV_CAP_PROP_AUTO_EXPOSURE, 0.75);
+    mCap->set(CV_CAP_PROP_FPS, 30);
 }
 
 // VideoOutput
@@ -2,6 +2,7 @@
 #define FMO_DESKTOP_VIDEO_HPP
 
 #include <fmo/common.hpp>
+#include <fmo/image.hpp>
 #include <fmo/region.hpp>
 #include <memory>
 #include <string>
@@ -30,39 +31,42 @@ struct VideoInput {
     static std::unique_ptr<VideoInput> makeFromFile(const std::string& filename);
 
     /// Provides the next frame from the file or device. May block until the next frame is
-    /// available. If there are no more frames, the returned region will point to nullptr.
+    /// available. If there are no more frames, the returned region will point to nullptr. The
+    /// region remains valid until the next call to receiveFrame(). When reading from a file,
+    /// frames are decoded ahead of time in a background thread.
     fmo::Region receiveFrame();
 
-    void restart() {
-        mCap->set(CV_CAP_PROP_POS_AVI_RATIO,0);
-    }
+    /// Provides the next frame by swapping it into the provided image, which will have the BGR
+    /// format. The previous contents of the image are used to decode future frames. Avoids the
+    /// copy that would be necessary to keep the region provided by receiveFrame(). Returns false
+    /// if there are no more frames.
+    bool receiveFrameSwap(fmo::Image& frame);
 
-    void set_fps(float fpsVal) {
-        mCap->set(CV_CAP_PROP_FPS, fpsVal); 
-        mFps = (float)mCap->get(CV_CAP_PROP_FPS);;
-    }
+    void restart();
 
-    double get_exposure() {
-        return mCap->get(CV_CAP_PROP_EXPOSURE);
-    }
+    void set_fps(float fpsVal);
 
-    void set_exposure(float expVal) {
-        mCap->set(CV_CAP_PROP_AUTO_EXPOSURE, 0.25); 
-        mCap->set(CV_CAP_PROP_EXPOSURE, expVal); 
-    }
+    double get_exposure();
 
-    void default_camera() {
-        mCap->set(CV_CAP_PROP_AUTO_EXPOSURE, 0.75); 
-        mCap->set(CV_CAP_PROP_FPS, 30); 
-    }
+    void set_exposure(float expVal);
+
+    void default_camera();
 
     fmo::Dims dims() const { return mDims; }
     float fps() const { return mFps; }
 
 private:
+    struct Prefetcher;
+
+    /// Stops decoding ahead, so that the capture device can be accessed directly. Frames that
+    /// have been decoded but not received are discarded.
+    void stopPrefetch();
+
     // data
-    std::unique_ptr<cv::Mat> mMat;
+    fmo::Image mFrame; ///< frame provided by receiveFrame()
     std::unique_ptr<cv::VideoCapture> mCap;
+    std::unique_ptr<Prefetcher> mPrefetch;
+    size_t mPrefetchDepth = 0; ///< number of frames to decode ahead, zero to disable
     fmo::Dims mDims;
     float mFps;
 };
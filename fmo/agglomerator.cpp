@@ -1,5 +1,5 @@
 #include <fmo/agglomerator.hpp>
 
 namespace fmo {
-    constexpr Agglomerator::Id_t Agglomerator::safetyMaxNumClusters;
+    constexpr Agglomerator::Dist_t Agglomerator::infDist;
 }
@@ -5,6 +5,7 @@ namespace fmo {
     Algorithm::Config::Config()
         : name("taxonomy-v1"),
           diff(),
+          backgroundWindow(0),
           //
           iouThreshold(0.5f),
           maxGapX(0.020f),
@@ -32,6 +33,9 @@ namespace fmo {
           outputNoRobustRadius(false),
           //
           imageHeight(480),
+          grayOnly(false),
+          roi(),
+          roiMask(),
           //
           minStripsInComponent(2),
           minStripsInCluster(12),
@@ -46,6 +50,7 @@ namespace fmo {
           maxGapsLength(0.75f),
           minMotion(0.25f),
           maxMotion(0.50f),
+          grayDiff(false),
           pointSetSourceResolution(false) {}
 
     using AlgorithmRegistry = std::map<std::string, Algorithm::Factory>;
@@ -81,7 +86,10 @@ namespace fmo {
         auto& registry = getRegistry();
         auto it = registry.find(config.name);
         if (it == registry.end()) { throw std::runtime_error("unknown algorithm name"); }
-        return it->second(config, format, dims);
+        auto algorithm = it->second(config, format, dims);
+        algorithm->mInputFormat = format;
+        algorithm->mInputDims = dims;
+        return algorithm;
     }
 
     void Algorithm::registerFactory(const std::string& name, const Factory& factory) {
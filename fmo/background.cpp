@@ -0,0 +1,195 @@
+#include "image-util.hpp"
+#include "include-simd.hpp"
+#include <fmo/background.hpp>
+
+namespace fmo {
+    namespace {
+        int checkWindow(int window) {
+            if (window != 0 &&
+                (window < 3 || window > BackgroundModel::MAX_WINDOW || window % 2 == 0)) {
+                throw std::runtime_error("BackgroundModel: window must be 0 or odd, 3 to 63");
+            }
+            return window;
+        }
+    }
+
+    /// Replaces a single value in each of the sorted per-pixel windows, keeping them sorted. With
+    /// S the sorted window, o the leaving value and n the arriving value:
+    ///
+    ///   if n >= o: S'[k] = S[k] >= o ? max(S[k], min(S[k + 1], n)) : S[k]
+    ///   if n <  o: S'[k] = S[k] <= o ? min(S[k], max(S[k - 1], n)) : S[k]
+    ///
+    /// where S[-1] = 0x00 and S[N] = 0xFF. Both cases are evaluated and the result is selected
+    /// per byte, so there are no branches.
+    struct BackgroundUpdateJob : public cv::ParallelLoopBody {
+#if defined(FMO_HAVE_AVX2)
+        using batch_t = __m256i;
+
+        static batch_t load(const uint8_t* src) { return _mm256_load_si256((const batch_t*)src); }
+        static void store(uint8_t* dst, batch_t v) { _mm256_store_si256((batch_t*)dst, v); }
+        static batch_t broadcast(uint8_t v) { return _mm256_set1_epi8(char(v)); }
+        static batch_t max(batch_t a, batch_t b) { return _mm256_max_epu8(a, b); }
+        static batch_t min(batch_t a, batch_t b) { return _mm256_min_epu8(a, b); }
+        static batch_t ge(batch_t a, batch_t b) { return _mm256_cmpeq_epi8(max(a, b), a); }
+        static batch_t le(batch_t a, batch_t b) { return _mm256_cmpeq_epi8(min(a, b), a); }
+        static batch_t select(batch_t mask, batch_t a, batch_t b) {
+            return _mm256_blendv_epi8(b, a, mask);
+        }
+#elif defined(FMO_HAVE_SSE2)
+        using batch_t = __m128i;
+
+        static batch_t load(const uint8_t* src) { return _mm_load_si128((const batch_t*)src); }
+        static void store(uint8_t* dst, batch_t v) { _mm_store_si128((batch_t*)dst, v); }
+        static batch_t broadcast(uint8_t v) { return _mm_set1_epi8(char(v)); }
+        static batch_t max(batch_t a, batch_t b) { return _mm_max_epu8(a, b); }
+        static batch_t min(batch_t a, batch_t b) { return _mm_min_epu8(a, b); }
+        static batch_t ge(batch_t a, batch_t b) { return _mm_cmpeq_epi8(max(a, b), a); }
+        static batch_t le(batch_t a, batch_t b) { return _mm_cmpeq_epi8(min(a, b), a); }
+        static batch_t select(batch_t mask, batch_t a, batch_t b) {
+            return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+        }
+#elif defined(FMO_HAVE_NEON)
+        using batch_t = uint8x16_t;
+
+        static batch_t load(const uint8_t* src) { return vld1q_u8(src); }
+        static void store(uint8_t* dst, batch_t v) { vst1q_u8(dst, v); }
+        static batch_t broadcast(uint8_t v) { return vdupq_n_u8(v); }
+        static batch_t max(batch_t a, batch_t b) { return vmaxq_u8(a, b); }
+        static batch_t min(batch_t a, batch_t b) { return vminq_u8(a, b); }
+        static batch_t ge(batch_t a, batch_t b) { return vcgeq_u8(a, b); }
+        static batch_t le(batch_t a, batch_t b) { return vcleq_u8(a, b); }
+        static batch_t select(batch_t mask, batch_t a, batch_t b) { return vbslq_u8(mask, a, b); }
+#else
+        using batch_t = uint8_t;
+
+        static batch_t load(const uint8_t* src) { return *src; }
+        static void store(uint8_t* dst, batch_t v) { *dst = v; }
+        static batch_t broadcast(uint8_t v) { return v; }
+        static batch_t max(batch_t a, batch_t b) { return std::max(a, b); }
+        static batch_t min(batch_t a, batch_t b) { return std::min(a, b); }
+        static batch_t ge(batch_t a, batch_t b) { return (a >= b) ? uint8_t(0xFF) : uint8_t(0); }
+        static batch_t le(batch_t a, batch_t b) { return (a <= b) ? uint8_t(0xFF) : uint8_t(0); }
+        static batch_t select(batch_t mask, batch_t a, batch_t b) { return mask ? a : b; }
+#endif
+
+        static void impl(const uint8_t* leaving, const uint8_t* arriving, uint8_t* const* planes,
+                         int window, size_t first, size_t last) {
+            // s[0] and s[window + 1] are sentinels
+            batch_t s[BackgroundModel::MAX_WINDOW + 2];
+            s[0] = broadcast(0x00);
+            s[window + 1] = broadcast(0xFF);
+
+            for (size_t i = first; i < last; i += sizeof(batch_t)) {
+                batch_t o = load(leaving + i);
+                batch_t n = load(arriving + i);
+                batch_t up = ge(n, o);
+
+                for (int k = 0; k < window; k++) { s[k + 1] = load(planes[k] + i); }
+
+                for (int k = 1; k <= window; k++) {
+                    batch_t sk = s[k];
+                    batch_t raised = select(ge(sk, o), max(sk, min(s[k + 1], n)), sk);
+                    batch_t lowered = select(le(sk, o), min(sk, max(s[k - 1], n)), sk);
+                    store(planes[k - 1] + i, select(up, raised, lowered));
+                }
+            }
+        }
+
+        BackgroundUpdateJob(const Image& leaving, const Image& arriving, uint8_t* const* planes,
+                            int window)
+            : mLeaving(leaving.data()), mArriving(arriving.data()), mPlanes(planes),
+              mWindow(window) {}
+
+        virtual void operator()(const cv::Range& pieces) const override {
+            size_t first = size_t(pieces.start) * sizeof(batch_t);
+            size_t last = size_t(pieces.end) * sizeof(batch_t);
+            impl(mLeaving, mArriving, mPlanes, mWindow, first, last);
+        }
+
+        /// Processes the bytes that do not fill a whole batch.
+        void tail(size_t first, size_t last) const {
+            uint8_t s[BackgroundModel::MAX_WINDOW + 2];
+            s[0] = 0x00;
+            s[mWindow + 1] = 0xFF;
+
+            for (size_t i = first; i < last; i++) {
+                uint8_t o = mLeaving[i];
+                uint8_t n = mArriving[i];
+
+                for (int k = 0; k < mWindow; k++) { s[k + 1] = mPlanes[k][i]; }
+
+                for (int k = 1; k <= mWindow; k++) {
+                    uint8_t sk = s[k];
+                    if (n >= o) {
+                        mPlanes[k - 1][i] = (sk >= o) ? std::max(sk, std::min(s[k + 1], n)) : sk;
+                    } else {
+                        mPlanes[k - 1][i] = (sk <= o) ? std::min(sk, std::max(s[k - 1], n)) : sk;
+                    }
+                }
+            }
+        }
+
+    private:
+        const uint8_t* const mLeaving;
+        const uint8_t* const mArriving;
+        uint8_t* const* const mPlanes;
+        const int mWindow;
+    };
+
+    BackgroundModel::BackgroundModel(int window)
+        : mWindow(checkWindow(window)),
+          mHistory(std::max(4, window + 1)),
+          mFrames(size_t(mHistory)),
+          mBackground(&mLegacy) {}
+
+    const Image& BackgroundModel::frame(int age) const {
+        if (age < 0 || age >= mHistory) {
+            throw std::runtime_error("BackgroundModel::frame(): age out of range");
+        }
+        return mFrames[(mNewest + age) % mHistory];
+    }
+
+    void BackgroundModel::swapInput(Image& input) {
+        if (mNumFrames == 0) {
+            init(input);
+        } else if (input.format() != frame(0).format() || input.dims() != frame(0).dims()) {
+            throw std::runtime_error("BackgroundModel: format/dimensions mismatch");
+        }
+
+        // the oldest frame is recycled
+        mNewest = (mNewest + mHistory - 1) % mHistory;
+        mFrames[mNewest].swap(input);
+        mNumFrames++;
+
+        if (incremental()) { update(frame(mWindow), frame(0)); }
+    }
+
+    void BackgroundModel::init(const Image& first) {
+        for (auto& frame : mFrames) { frame = first; }
+
+        if (incremental()) {
+            mPlanes.resize(size_t(mWindow));
+            mPlaneData.clear();
+            for (auto& plane : mPlanes) {
+                plane = first;
+                mPlaneData.push_back(plane.data());
+            }
+            mBackground = &mPlanes[mWindow / 2];
+        } else {
+            mLegacy.resize(first.format(), first.dims());
+            std::fill(mLegacy.begin(), mLegacy.end(), uint8_t(0));
+        }
+    }
+
+    void BackgroundModel::update(const Image& leaving, const Image& arriving) {
+        const size_t bytes = getNumBytes(arriving.format(), arriving.dims());
+        const size_t pieces = bytes / sizeof(BackgroundUpdateJob::batch_t);
+
+        // run the job in parallel
+        BackgroundUpdateJob job{leaving, arriving, mPlaneData.data(), mWindow};
+        cv::parallel_for_(cv::Range{0, int(pieces)}, job, cv::getNumThreads());
+
+        // process the last few bytes individually
+        job.tail(pieces * sizeof(BackgroundUpdateJob::batch_t), bytes);
+    }
+}
@@ -5,7 +5,9 @@
 #include <fmo/benchmark.hpp>
 #include <fmo/subsampler.hpp>
 #include <fmo/differentiator.hpp>
+#include <fmo/distance.hpp>
 #include <fmo/image.hpp>
+#include <fmo/isa.hpp>
 #include <fmo/processing.hpp>
 #include <fmo/stats.hpp>
 #include <fmo/strip.hpp>
@@ -59,6 +61,7 @@ namespace fmo {
 #if defined(FMO_HAVE_NEON)
         log(logFunc, " + NEON");
 #endif
+        log(logFunc, "\nDispatch: %s", isaName(activeIsa()));
 
         log(logFunc, "\nCores: %d / Threads: %d\n", cv::getNumberOfCPUs(), cv::getNumThreads());
     }
@@ -114,7 +117,9 @@ namespace fmo {
             fmo::Image yuv420SpNoiseImage3;
             fmo::Image yuvNoiseImage;
             fmo::Image yuvNoiseImage2;
+            fmo::Image yuvBackgroundImage;
             fmo::Image outImage;
+            fmo::Image outImage2;
             std::vector<fmo::Image> outImageVec;
 
             std::mt19937 re{5489};
@@ -127,6 +132,7 @@ namespace fmo {
             fmo::Differentiator::Config diffCfg;
             fmo::Differentiator diff{diffCfg};
             fmo::StripGen stripGen;
+            fmo::DistanceTransform distTran;
             std::vector<fmo::Pos16> pos16Vec;
             std::vector<fmo::Strip> stripVec;
         } global;
@@ -201,6 +207,9 @@ namespace fmo {
                     }
                 }
 
+                global.yuvBackgroundImage.resize(fmo::Format::YUV, {W, H});
+                std::memset(global.yuvBackgroundImage.data(), 0x80, 3 * W * H);
+
                 {
                     global.grayCircles = newGrayMat();
                     auto* data = global.grayCircles.data;
@@ -271,6 +280,26 @@ namespace fmo {
                                                   global.outImage);
                                   }};
 
+        Benchmark FMO_UNIQUE_NAME{"fmo::Differentiator median5", []() {
+                                      init();
+                                      global.diff(global.yuvNoiseImage, global.yuvNoiseImage2,
+                                                  global.yuvNoiseImage, global.yuvNoiseImage2,
+                                                  global.yuvBackgroundImage, global.outImage);
+                                  }};
+
+        Benchmark FMO_UNIQUE_NAME{"fmo::DistanceTransform", []() {
+                                      init();
+                                      global.distTran(global.grayCirclesImage, global.outImage,
+                                                      global.outImage2);
+                                  }};
+
+        Benchmark FMO_UNIQUE_NAME{"fmo::distance_transform + fmo::local_maxima", []() {
+                                      init();
+                                      fmo::distance_transform(global.grayCirclesImage,
+                                                              global.outImage);
+                                      fmo::local_maxima(global.outImage, global.outImage2);
+                                  }};
+
         Benchmark FMO_UNIQUE_NAME{"fmo::copy + fmo::Algorithm GRAY", []() {
                                       init();
                                       static int i = 0;
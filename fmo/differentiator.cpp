@@ -1,7 +1,9 @@
 #include "image-util.hpp"
 #include "include-opencv.hpp"
 #include "include-simd.hpp"
+#include <fmo/background.hpp>
 #include <fmo/differentiator.hpp>
+#include <fmo/isa.hpp>
 #include <fmo/processing.hpp>
 
 namespace fmo {
@@ -13,89 +15,234 @@ namespace fmo {
     }
 
     Differentiator::Config::Config()
-        : thresh(24), diffThFactor(1.0), noiseMin(0.0035), noiseMax(0.0047), adjustPeriod(4) {}
+        : thresh(24),
+          diffThFactor(1.0),
+          noiseMin(0.0035),
+          noiseMax(0.0047),
+          adjustPeriod(4),
+          binary(false) {}
 
     Differentiator::Differentiator(const Config& cfg)
         : mCfg(cfg), mThresh(std::min(std::max(cfg.thresh, threshMin), threshMax)) {
         mNoise.reserve(mCfg.adjustPeriod);
     }
 
-    struct AddAndThreshJob : public cv::ParallelLoopBody {
+    namespace {
+        using addAndThresh_t = void (*)(const uint8_t* src, uint8_t* dst, size_t pixels,
+                                        uint8_t thresh);
 
-#if defined(FMO_HAVE_NEON)
-        using batch_t = uint8x16_t;
-        using batch3_t = uint8x16x3_t;
+        void addAndThreshScalar(const uint8_t* src, uint8_t* dst, size_t pixels, uint8_t thresh) {
+            int t = int(thresh);
+            for (uint8_t* dstEnd = dst + pixels; dst < dstEnd; src += 3, dst++) {
+                *dst = ((src[0] + src[1] + src[2]) > t) ? uint8_t(0xFF) : uint8_t(0);
+            }
+        }
+
+#if defined(FMO_HAVE_SSE2)
+        /// Four rounds of interleaving the first and the second half of six registers holding
+        /// 32 three-channel pixels de-interleave the channels: registers 0, 1, 2 receive the
+        /// channels of the even pixels and registers 3, 4, 5 the channels of the odd pixels.
+        /// Memory access is unaligned, because rows of BINARY output start anywhere in the input.
+        void addAndThreshSse2(const uint8_t* src, uint8_t* dst, size_t pixels, uint8_t thresh) {
+            using batch_t = __m128i;
+            const batch_t threshVec = _mm_set1_epi8(char(thresh));
+            const batch_t zero = _mm_setzero_si128();
+            const batch_t ones = _mm_cmpeq_epi8(zero, zero);
+
+            for (uint8_t* dstEnd = dst + pixels; dst < dstEnd; src += 6 * sizeof(batch_t),
+                                                              dst += 2 * sizeof(batch_t)) {
+                batch_t v[6], w[6];
+                for (int i = 0; i < 6; i++) {
+                    v[i] = _mm_loadu_si128((const batch_t*)(src + i * sizeof(batch_t)));
+                }
+                for (int round = 0; round < 4; round++) {
+                    for (int i = 0; i < 3; i++) {
+                        w[2 * i] = _mm_unpacklo_epi8(v[i], v[i + 3]);
+                        w[2 * i + 1] = _mm_unpackhi_epi8(v[i], v[i + 3]);
+                    }
+                    std::copy(w, w + 6, v);
+                }
+
+                batch_t even = _mm_adds_epu8(_mm_adds_epu8(v[0], v[1]), v[2]);
+                batch_t odd = _mm_adds_epu8(_mm_adds_epu8(v[3], v[4]), v[5]);
+                even = _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(even, threshVec), zero), ones);
+                odd = _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(odd, threshVec), zero), ones);
+                _mm_storeu_si128((batch_t*)dst, _mm_unpacklo_epi8(even, odd));
+                _mm_storeu_si128((batch_t*)(dst + sizeof(batch_t)), _mm_unpackhi_epi8(even, odd));
+            }
+        }
+#endif
+
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+        /// Same as the SSE2 variant. The lower and upper lanes of the registers hold two
+        /// consecutive runs of 32 pixels, so that the de-interleaving never crosses lanes.
+#   if defined(FMO_HAVE_X86_DISPATCH)
+        FMO_TARGET_AVX2
+#   endif
+        void addAndThreshAvx2(const uint8_t* src, uint8_t* dst, size_t pixels, uint8_t thresh) {
+            using batch_t = __m256i;
+            using half_t = __m128i;
+            const batch_t threshVec = _mm256_set1_epi8(char(thresh));
+            const batch_t zero = _mm256_setzero_si256();
+            const batch_t ones = _mm256_cmpeq_epi8(zero, zero);
+
+            for (uint8_t* dstEnd = dst + pixels; dst < dstEnd; src += 6 * sizeof(batch_t),
+                                                              dst += 2 * sizeof(batch_t)) {
+                batch_t v[6], w[6];
+                for (int i = 0; i < 6; i++) {
+                    half_t lo = _mm_loadu_si128((const half_t*)(src + i * sizeof(half_t)));
+                    half_t hi = _mm_loadu_si128((const half_t*)(src + (i + 6) * sizeof(half_t)));
+                    v[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+                }
+                for (int round = 0; round < 4; round++) {
+                    for (int i = 0; i < 3; i++) {
+                        w[2 * i] = _mm256_unpacklo_epi8(v[i], v[i + 3]);
+                        w[2 * i + 1] = _mm256_unpackhi_epi8(v[i], v[i + 3]);
+                    }
+                    std::copy(w, w + 6, v);
+                }
 
-        static void impl(const uint8_t* src, const uint8_t* srcEnd, uint8_t* dst, uint8_t thresh) {
+                batch_t even = _mm256_adds_epu8(_mm256_adds_epu8(v[0], v[1]), v[2]);
+                batch_t odd = _mm256_adds_epu8(_mm256_adds_epu8(v[3], v[4]), v[5]);
+                even = _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(even, threshVec), zero),
+                                        ones);
+                odd = _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(odd, threshVec), zero),
+                                       ones);
+                batch_t lo = _mm256_unpacklo_epi8(even, odd);
+                batch_t hi = _mm256_unpackhi_epi8(even, odd);
+                _mm256_storeu_si256((batch_t*)dst, _mm256_permute2x128_si256(lo, hi, 0x20));
+                _mm256_storeu_si256((batch_t*)(dst + sizeof(batch_t)),
+                                   _mm256_permute2x128_si256(lo, hi, 0x31));
+            }
+        }
+#endif
+
+#if defined(FMO_HAVE_NEON)
+        void addAndThreshNeon(const uint8_t* src, uint8_t* dst, size_t pixels, uint8_t thresh) {
+            using batch_t = uint8x16_t;
+            using batch3_t = uint8x16x3_t;
             batch_t threshVec = vld1q_dup_u8(&thresh);
 
-            for (; src < srcEnd; src += SRC_BATCH_SIZE, dst += DST_BATCH_SIZE) {
+            for (uint8_t* dstEnd = dst + pixels; dst < dstEnd; src += 3 * sizeof(batch_t),
+                                                              dst += sizeof(batch_t)) {
                 batch3_t v = vld3q_u8(src);
                 batch_t sum = vqaddq_u8(vqaddq_u8(v.val[0], v.val[1]), v.val[2]);
                 sum = vcgtq_u8(sum, threshVec);
                 vst1q_u8(dst, sum);
             }
         }
-#else
-        using batch_t = uint8_t;
+#endif
 
-        static void impl(const uint8_t* src, const uint8_t* srcEnd, uint8_t* dst, uint8_t thresh) {
-            int t = int(thresh);
-            for (; src < srcEnd; src += SRC_BATCH_SIZE, dst += DST_BATCH_SIZE) {
-                *dst = ((src[0] + src[1] + src[2]) > t) ? uint8_t(0xFF) : uint8_t(0);
+        /// Picks the kernel variant for the active instruction set.
+        addAndThresh_t selectAddAndThresh() {
+            switch (activeIsa()) {
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+            case Isa::AVX512BW:
+            case Isa::AVX2:
+                return addAndThreshAvx2;
+#endif
+#if defined(FMO_HAVE_SSE2)
+            case Isa::SSE2:
+                return addAndThreshSse2;
+#endif
+#if defined(FMO_HAVE_NEON)
+            case Isa::NEON:
+                return addAndThreshNeon;
+#endif
+            default:
+                return addAndThreshScalar;
             }
         }
-#endif
+    }
 
+    struct AddAndThreshJob : public cv::ParallelLoopBody {
         enum : size_t {
-            SRC_BATCH_SIZE = sizeof(batch_t) * 3,
-            DST_BATCH_SIZE = sizeof(batch_t),
+            BATCH_SIZE = 64, ///< pixels in a piece of work, a multiple of any kernel's batch
         };
 
-        AddAndThreshJob(const uint8_t* src, uint8_t* dst, uint8_t thresh)
-            : mSrc(src), mDst(dst), mThresh(thresh) {}
+        AddAndThreshJob(const uint8_t* src, uint8_t* dst, size_t pixels, uint8_t thresh)
+            : mSrc(src), mDst(dst), mPixels(pixels), mThresh(thresh),
+              mKernel(selectAddAndThresh()) {}
+
+        /// The number of pieces, including the last, possibly incomplete one.
+        size_t pieces() const { return (mPixels + BATCH_SIZE - 1) / BATCH_SIZE; }
 
         virtual void operator()(const cv::Range& pieces) const override {
-            size_t firstSrc = size_t(pieces.start) * SRC_BATCH_SIZE;
-            size_t lastSrc = size_t(pieces.end) * SRC_BATCH_SIZE;
-            size_t firstDst = size_t(pieces.start) * DST_BATCH_SIZE;
-            const uint8_t* src = mSrc + firstSrc;
-            const uint8_t* srcEnd = mSrc + lastSrc;
-            uint8_t* dst = mDst + firstDst;
-            impl(src, srcEnd, dst, mThresh);
+            size_t first = size_t(pieces.start) * BATCH_SIZE;
+            size_t last = std::min(size_t(pieces.end) * BATCH_SIZE, mPixels);
+            size_t lastFull = first + (last - first) / BATCH_SIZE * BATCH_SIZE;
+            mKernel(mSrc + first * 3, mDst + first, lastFull - first, mThresh);
+
+            // the last piece may be incomplete
+            addAndThreshScalar(mSrc + lastFull * 3, mDst + lastFull, last - lastFull, mThresh);
         }
 
     private:
         const uint8_t* const mSrc;
         uint8_t* const mDst;
-        uint8_t mThresh;
+        const size_t mPixels;
+        const uint8_t mThresh;
+        const addAndThresh_t mKernel;
     };
 
+    /// Like AddAndThreshJob, but each piece is a row and the result is packed into a BINARY
+    /// image. A row is thresholded into a small buffer first, then packed.
+    struct AddAndThreshBinaryJob : public cv::ParallelLoopBody {
+        AddAndThreshBinaryJob(const Image& src, Image& dst, uint8_t thresh)
+            : mSrc(src.data()),
+              mDst(dst.data()),
+              mDstSkip(dst.skip()),
+              mWidth(size_t(src.dims().width)),
+              mThresh(thresh),
+              mKernel(selectAddAndThresh()),
+              mPack(selectPackBinaryRow()) {}
+
+        virtual void operator()(const cv::Range& rows) const override {
+            std::vector<uint8_t> buffer(mWidth);
+            const size_t full = mWidth / AddAndThreshJob::BATCH_SIZE * AddAndThreshJob::BATCH_SIZE;
+
+            for (int row = rows.start; row < rows.end; row++) {
+                const uint8_t* src = mSrc + size_t(row) * mWidth * 3;
+                mKernel(src, buffer.data(), full, mThresh);
+                addAndThreshScalar(src + full * 3, buffer.data() + full, mWidth - full, mThresh);
+                mPack(buffer.data(), (uint64_t*)(mDst + size_t(row) * mDstSkip), int(mWidth), 0);
+            }
+        }
+
+    private:
+        const uint8_t* const mSrc;
+        uint8_t* const mDst;
+        const size_t mDstSkip;
+        const size_t mWidth;
+        const uint8_t mThresh;
+        const addAndThresh_t mKernel;
+        const packBinaryRow_t mPack;
+    };
+
+    void addAndThreshBinary(const Image& src, Image& dst, uint8_t thresh) {
+        if (getPixelStep(src.format()) != 3) {
+            throw std::runtime_error("addAndThreshBinary(): bad format");
+        }
+
+        dst.resize(Format::BINARY, src.dims());
+        AddAndThreshBinaryJob job{src, dst, thresh};
+        cv::parallel_for_(cv::Range{0, src.dims().height}, job, cv::getNumThreads());
+    }
+
     void addAndThresh(const Image& src, Image& dst, uint8_t thresh) {
         const Format format = src.format();
         const Dims dims = src.dims();
         const size_t pixels = size_t(dims.width) * size_t(dims.height);
-        const size_t pieces = pixels / AddAndThreshJob::DST_BATCH_SIZE;
 
         if (getPixelStep(format) != 3) { throw std::runtime_error("addAndThresh(): bad format"); }
 
         // run the job in parallel
         dst.resize(Format::GRAY, dims);
-        AddAndThreshJob job{src.data(), dst.data(), thresh};
-        cv::parallel_for_(cv::Range{0, int(pieces)}, job, cv::getNumThreads());
-
-        // process the last few bytes individually
-        size_t lastIndex = pieces * AddAndThreshJob::DST_BATCH_SIZE;
-        const uint8_t* data = src.data() + (lastIndex * 3);
-        uint8_t* out = dst.data() + lastIndex;
-        uint8_t* outEnd = dst.data() + pixels;
-        int t = int(thresh);
-        for (; out < outEnd; out++, data += 3) {
-            *out = ((data[0] + data[1] + data[2]) > t) ? uint8_t(0xFF) : uint8_t(0);
-        }
+        AddAndThreshJob job{src.data(), dst.data(), pixels, thresh};
+        cv::parallel_for_(cv::Range{0, int(job.pieces())}, job, cv::getNumThreads());
     }
 
-    void Differentiator::operator()(const Mat& src1, const Mat& src2, Image& dst) {
+    uint8_t Differentiator::calibrate(Dims dims) {
         // calibrate threshold based on measured noise
         if (int(mNoise.size()) >= mCfg.adjustPeriod) {
             std::sort(begin(mNoise), end(mNoise));
@@ -103,7 +250,7 @@ namespace fmo {
             int noiseAmount = *median;
             mNoise.clear();
 
-            int numPixels = src1.dims().width * src1.dims().height;
+            int numPixels = dims.width * dims.height;
             double noiseFrac = double(noiseAmount) / double(numPixels);
 
             if (noiseFrac > mCfg.noiseMax) {
@@ -117,19 +264,32 @@ namespace fmo {
             }
         }
 
+        return uint8_t(mCfg.diffThFactor * mThresh);
+    }
+
+    void Differentiator::operator()(const Mat& src1, const Mat& src2, Image& dst) {
+        uint8_t usedThresh = calibrate(src1.dims());
+
         // calculate absolute differences
         absdiff(src1, src2, mAbsDiff);
 
         // threshold
-        auto mUsedThresh = mCfg.diffThFactor*mThresh;
         switch (mAbsDiff.format()) {
         case Format::GRAY: {
-            greater_than(mAbsDiff, dst, mUsedThresh);
+            if (mCfg.binary) {
+                greater_than_binary(mAbsDiff, dst, usedThresh);
+            } else {
+                greater_than(mAbsDiff, dst, usedThresh);
+            }
             return;
         }
         case Format::BGR:
         case Format::YUV: {
-            addAndThresh(mAbsDiff, dst, mUsedThresh);
+            if (mCfg.binary) {
+                addAndThreshBinary(mAbsDiff, dst, usedThresh);
+            } else {
+                addAndThresh(mAbsDiff, dst, usedThresh);
+            }
             return;
         }
         default:
@@ -137,5 +297,26 @@ namespace fmo {
         }
     }
 
+    void Differentiator::operator()(const Image& src1, const Image& src2, const Image& src3,
+                                    const Image& src4, Image& background, Image& dst) {
+        uint8_t usedThresh = calibrate(src1.dims());
+        if (mCfg.binary) {
+            // the fused kernel produces GRAY output, pack it afterwards
+            median5_diff(src1, src2, src3, src4, background, background, mGrayDiff, usedThresh);
+            greater_than_binary(mGrayDiff, dst, 0);
+        } else {
+            median5_diff(src1, src2, src3, src4, background, background, dst, usedThresh);
+        }
+    }
+
+    void Differentiator::operator()(BackgroundModel& model, Image& dst) {
+        if (model.incremental()) {
+            (*this)(model.frame(0), model.background(), dst);
+        } else {
+            (*this)(model.frame(0), model.frame(1), model.frame(2), model.frame(3),
+                    model.background(), dst);
+        }
+    }
+
     void Differentiator::reportAmountOfNoise(int noise) { mNoise.push_back(noise); }
 }
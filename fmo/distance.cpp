@@ -0,0 +1,400 @@
+#include "image-util.hpp"
+#include "include-simd.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fmo/distance.hpp>
+
+namespace fmo {
+    namespace {
+        // the fixed-point metric of cv::distanceTransform() with DIST_L2 and DIST_MASK_3, i.e.
+        // the products 0.955f * 2^16 and 1.3693f * 2^16, evaluated in float, then rounded
+        constexpr int DIST_SHIFT = 16;
+        constexpr int32_t HV_DIST = 62587;   // round(62586.88f)
+        constexpr int32_t DIAG_DIST = 89738; // round(89738.445f)
+        constexpr int32_t DIST_MAX = INT32_MAX >> 2;
+        constexpr float DIST_SCALE = 1.f / (1 << DIST_SHIFT);
+
+        /// Finds the index of the first non-zero byte, or returns -1 if there is none.
+        int firstNonZero(const uint8_t* data, int len) {
+            int i = 0;
+            for (; i + 8 <= len; i += 8) {
+                uint64_t word;
+                std::memcpy(&word, data + i, 8);
+                if (word != 0) break;
+            }
+            for (; i < len; i++) {
+                if (data[i] != 0) return i;
+            }
+            return -1;
+        }
+
+        /// Finds the index of the last non-zero byte, or returns -1 if there is none.
+        int lastNonZero(const uint8_t* data, int len) {
+            int i = len;
+            for (; i >= 8; i -= 8) {
+                uint64_t word;
+                std::memcpy(&word, data + i - 8, 8);
+                if (word != 0) break;
+            }
+            for (; i > 0; i--) {
+                if (data[i - 1] != 0) return i - 1;
+            }
+            return -1;
+        }
+    }
+
+    /// Processes each box with the two-pass 3x3 chamfer algorithm used by OpenCV. Each pass is
+    /// split into a vertical step, which takes the row above (or below) into account and is
+    /// vectorized, and a horizontal step, which has to be sequential. Rows are finalized from the
+    /// bottom up; local maxima of a row are found as soon as the row above it is final.
+    struct DistanceTransformJob : public cv::ParallelLoopBody {
+#if defined(FMO_HAVE_AVX2)
+        using batch_t = __m256i;
+
+        static batch_t load(const int32_t* src) { return _mm256_loadu_si256((const batch_t*)src); }
+        static void store(int32_t* dst, batch_t v) { _mm256_storeu_si256((batch_t*)dst, v); }
+        static batch_t broadcast(int32_t v) { return _mm256_set1_epi32(v); }
+        static batch_t add(batch_t a, batch_t b) { return _mm256_add_epi32(a, b); }
+        static batch_t min(batch_t a, batch_t b) { return _mm256_min_epi32(a, b); }
+        static batch_t max(batch_t a, batch_t b) { return _mm256_max_epi32(a, b); }
+        static batch_t gt(batch_t a, batch_t b) { return _mm256_cmpgt_epi32(a, b); }
+        static batch_t andNot(batch_t a, batch_t b) { return _mm256_andnot_si256(a, b); }
+        static void storeFloat(float* dst, batch_t v) {
+            __m256 scale = _mm256_set1_ps(DIST_SCALE);
+            _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+        }
+        static void storeMasks(uint8_t* dst, const batch_t* m) {
+            batch_t m16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(m[0], m[1]), 0xD8);
+            __m128i m8 = _mm_packs_epi16(_mm256_castsi256_si128(m16),
+                                         _mm256_extracti128_si256(m16, 1));
+            _mm_storeu_si128((__m128i*)dst, m8);
+        }
+#elif defined(FMO_HAVE_SSE2)
+        using batch_t = __m128i;
+
+        static batch_t load(const int32_t* src) { return _mm_loadu_si128((const batch_t*)src); }
+        static void store(int32_t* dst, batch_t v) { _mm_storeu_si128((batch_t*)dst, v); }
+        static batch_t broadcast(int32_t v) { return _mm_set1_epi32(v); }
+        static batch_t add(batch_t a, batch_t b) { return _mm_add_epi32(a, b); }
+        static batch_t min(batch_t a, batch_t b) {
+            batch_t mask = _mm_cmpgt_epi32(a, b);
+            return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+        }
+        static batch_t max(batch_t a, batch_t b) {
+            batch_t mask = _mm_cmpgt_epi32(a, b);
+            return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+        }
+        static batch_t gt(batch_t a, batch_t b) { return _mm_cmpgt_epi32(a, b); }
+        static batch_t andNot(batch_t a, batch_t b) { return _mm_andnot_si128(a, b); }
+        static void storeFloat(float* dst, batch_t v) {
+            _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(DIST_SCALE)));
+        }
+        static void storeMasks(uint8_t* dst, const batch_t* m) {
+            batch_t lo = _mm_packs_epi32(m[0], m[1]);
+            batch_t hi = _mm_packs_epi32(m[2], m[3]);
+            _mm_storeu_si128((batch_t*)dst, _mm_packs_epi16(lo, hi));
+        }
+#elif defined(FMO_HAVE_NEON)
+        using batch_t = int32x4_t;
+
+        static batch_t load(const int32_t* src) { return vld1q_s32(src); }
+        static void store(int32_t* dst, batch_t v) { vst1q_s32(dst, v); }
+        static batch_t broadcast(int32_t v) { return vdupq_n_s32(v); }
+        static batch_t add(batch_t a, batch_t b) { return vaddq_s32(a, b); }
+        static batch_t min(batch_t a, batch_t b) { return vminq_s32(a, b); }
+        static batch_t max(batch_t a, batch_t b) { return vmaxq_s32(a, b); }
+        static batch_t gt(batch_t a, batch_t b) { return vreinterpretq_s32_u32(vcgtq_s32(a, b)); }
+        static batch_t andNot(batch_t a, batch_t b) { return vbicq_s32(b, a); }
+        static void storeFloat(float* dst, batch_t v) {
+            vst1q_f32(dst, vmulq_n_f32(vcvtq_f32_s32(v), DIST_SCALE));
+        }
+        static void storeMasks(uint8_t* dst, const batch_t* m) {
+            uint16x8_t lo = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(m[0])),
+                                         vmovn_u32(vreinterpretq_u32_s32(m[1])));
+            uint16x8_t hi = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(m[2])),
+                                         vmovn_u32(vreinterpretq_u32_s32(m[3])));
+            vst1q_u8(dst, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+        }
+#else
+        using batch_t = int32_t;
+
+        static batch_t load(const int32_t* src) { return *src; }
+        static void store(int32_t* dst, batch_t v) { *dst = v; }
+        static batch_t broadcast(int32_t v) { return v; }
+        static batch_t add(batch_t a, batch_t b) { return a + b; }
+        static batch_t min(batch_t a, batch_t b) { return std::min(a, b); }
+        static batch_t max(batch_t a, batch_t b) { return std::max(a, b); }
+        static batch_t gt(batch_t a, batch_t b) { return (a > b) ? -1 : 0; }
+        static batch_t andNot(batch_t a, batch_t b) { return ~a & b; }
+        static void storeFloat(float* dst, batch_t v) { *dst = float(v) * DIST_SCALE; }
+        static void storeMasks(uint8_t* dst, const batch_t* m) {
+            for (int i = 0; i < 16; i++) { dst[i] = uint8_t(m[i]); }
+        }
+#endif
+
+        enum : int {
+            LANES = sizeof(batch_t) / sizeof(int32_t), ///< distances in a batch
+            MASK_PIXELS = 16,                          ///< pixels handled by storeMasks()
+        };
+
+        /// Forward pass over a single row. The row above must be final, the border cells of the
+        /// current row must be set.
+        static void forward(const uint8_t* src, const int32_t* up, int32_t* cur, int width) {
+            const batch_t hv = broadcast(HV_DIST);
+            const batch_t diag = broadcast(DIAG_DIST);
+            int j = 0;
+
+            for (; j + LANES <= width; j += LANES) {
+                batch_t v = min(add(load(up + j - 1), diag), add(load(up + j), hv));
+                store(cur + j, min(v, add(load(up + j + 1), diag)));
+            }
+            for (; j < width; j++) {
+                int32_t v = std::min(up[j - 1] + DIAG_DIST, up[j] + HV_DIST);
+                cur[j] = std::min(v, up[j + 1] + DIAG_DIST);
+            }
+
+            int32_t left = cur[-1];
+            for (j = 0; j < width; j++) {
+                left = src[j] ? std::min(cur[j], left + HV_DIST) : 0;
+                cur[j] = left;
+            }
+        }
+
+        /// Backward pass over a single row. The row below must be final. Converts the final
+        /// distances to floating point.
+        static void backward(const int32_t* down, int32_t* cur, float* dst, int width) {
+            const batch_t hv = broadcast(HV_DIST);
+            const batch_t diag = broadcast(DIAG_DIST);
+            int j = 0;
+
+            for (; j + LANES <= width; j += LANES) {
+                batch_t v = min(load(cur + j), add(load(down + j - 1), diag));
+                v = min(v, add(load(down + j), hv));
+                store(cur + j, min(v, add(load(down + j + 1), diag)));
+            }
+            for (; j < width; j++) {
+                int32_t v = std::min(cur[j], down[j - 1] + DIAG_DIST);
+                v = std::min(v, down[j] + HV_DIST);
+                cur[j] = std::min(v, down[j + 1] + DIAG_DIST);
+            }
+
+            int32_t right = cur[width];
+            for (j = width - 1; j >= 0; j--) {
+                right = std::min(std::min(cur[j], right + HV_DIST), DIST_MAX);
+                cur[j] = right;
+            }
+
+            for (j = 0; j + LANES <= width; j += LANES) { storeFloat(dst + j, load(cur + j)); }
+            for (; j < width; j++) { dst[j] = float(cur[j]) * DIST_SCALE; }
+        }
+
+        /// Tests whether a pixel is a local maximum, ignoring neighbors outside the row.
+        static uint8_t isMaximum(const int32_t* up, const int32_t* cur, const int32_t* down, int j,
+                                 int width) {
+            const int32_t c = cur[j];
+            if (c <= 0) return 0x00;
+            const int first = std::max(j - 1, 0);
+            const int last = std::min(j + 1, width - 1);
+            for (int k = first; k <= last; k++) {
+                if (up[k] > c || cur[k] > c || down[k] > c) return 0x00;
+            }
+            return 0xFF;
+        }
+
+        /// Marks the local maxima in a row. All three rows must be final.
+        static void maxima(const int32_t* up, const int32_t* cur, const int32_t* down, uint8_t* dst,
+                           int width) {
+            const batch_t zero = broadcast(0);
+            dst[0] = isMaximum(up, cur, down, 0, width);
+            int j = 1;
+
+            for (; j + MASK_PIXELS < width; j += MASK_PIXELS) {
+                batch_t m[MASK_PIXELS / LANES];
+                for (int k = 0; k < MASK_PIXELS / LANES; k++) {
+                    const int i = j + k * LANES;
+                    batch_t c = load(cur + i);
+                    batch_t n = max(load(cur + i - 1), load(cur + i + 1));
+                    n = max(n, max(max(load(up + i - 1), load(up + i)), load(up + i + 1)));
+                    n = max(n, max(max(load(down + i - 1), load(down + i)), load(down + i + 1)));
+                    m[k] = andNot(gt(n, c), gt(c, zero));
+                }
+                storeMasks(dst + j, m);
+            }
+            for (; j < width; j++) { dst[j] = isMaximum(up, cur, down, j, width); }
+        }
+
+        /// Sets the row above or below the box. Rows outside the image are far away, rows inside
+        /// the image are background.
+        static void initRow(int32_t* row, int width, bool outside, int32_t left, int32_t right) {
+            row[-1] = outside ? DIST_MAX : left;
+            std::fill(row, row + width, outside ? DIST_MAX : 0);
+            row[width] = outside ? DIST_MAX : right;
+        }
+
+        DistanceTransformJob(const Mat& src, Image& dist, Image& maxima, const Bounds* boxes,
+                             const size_t* offsets, int32_t* temp, const int32_t* zeros)
+            : mDims(src.dims()),
+              mSrcSkip(src.skip()),
+              mSrc(src.data()),
+              mDist((float*)dist.data()),
+              mMaxima(maxima.data()),
+              mBoxes(boxes),
+              mOffsets(offsets),
+              mTemp(temp),
+              mZeros(zeros) {}
+
+        virtual void operator()(const cv::Range& pieces) const override {
+            for (int i = pieces.start; i < pieces.end; i++) {
+                processBox(mBoxes[i], mTemp + mOffsets[i]);
+            }
+        }
+
+        void processBox(const Bounds& box, int32_t* temp) const {
+            const int width = box.max.x - box.min.x + 1;
+            const int height = box.max.y - box.min.y + 1;
+            const int stride = width + 2;
+            auto row = [=](int r) { return temp + (r + 1) * stride + 1; };
+
+            const int32_t left = (box.min.x == 0) ? DIST_MAX : 0;
+            const int32_t right = (box.max.x == mDims.width - 1) ? DIST_MAX : 0;
+            initRow(row(-1), width, box.min.y == 0, left, right);
+            initRow(row(height), width, box.max.y == mDims.height - 1, left, right);
+
+            const uint8_t* src = mSrc + box.min.y * mSrcSkip + box.min.x;
+            for (int r = 0; r < height; r++, src += mSrcSkip) {
+                int32_t* cur = row(r);
+                cur[-1] = left;
+                cur[width] = right;
+                forward(src, row(r - 1), cur, width);
+            }
+
+            const size_t offset = size_t(box.min.y) * mDims.width + box.min.x;
+            float* dist = mDist + offset;
+            uint8_t* lm = mMaxima + offset;
+            for (int r = height - 1; r >= 0; r--) {
+                backward(row(r + 1), row(r), dist + r * mDims.width, width);
+
+                if (r + 1 < height) {
+                    const int32_t* below = (r + 2 < height) ? row(r + 2) : mZeros;
+                    maxima(row(r), row(r + 1), below, lm + (r + 1) * mDims.width, width);
+                }
+            }
+            maxima(mZeros, row(0), (height > 1) ? row(1) : mZeros, lm, width);
+        }
+
+    private:
+        const Dims mDims;
+        const size_t mSrcSkip;
+        const uint8_t* const mSrc;
+        float* const mDist;
+        uint8_t* const mMaxima;
+        const Bounds* const mBoxes;
+        const size_t* const mOffsets;
+        int32_t* const mTemp;
+        const int32_t* const mZeros;
+    };
+
+    void DistanceTransform::operator()(const Mat& src, Image& dist, Image& maxima) {
+        if (src.format() != Format::GRAY) {
+            throw std::runtime_error("DistanceTransform: input must be GRAY");
+        }
+
+        findBoxes(src);
+        process(src, dist, maxima);
+    }
+
+    void DistanceTransform::operator()(const Mat& src, const std::vector<Bounds>& boxes,
+                                       Image& dist, Image& maxima) {
+        if (src.format() != Format::GRAY) {
+            throw std::runtime_error("DistanceTransform: input must be GRAY");
+        }
+
+        mBoxes = boxes;
+        process(src, dist, maxima);
+    }
+
+    void DistanceTransform::process(const Mat& src, Image& dist, Image& maxima) {
+        dist.resize(Format::FLOAT, src.dims());
+        maxima.resize(Format::GRAY, src.dims());
+        clear(dist, maxima);
+
+        // each box gets its own part of the cache so that the boxes can be processed in parallel
+        size_t size = 0;
+        size_t maxWidth = 0;
+        mOffsets.clear();
+        for (auto& box : mBoxes) {
+            size_t width = size_t(box.max.x - box.min.x + 1);
+            size_t height = size_t(box.max.y - box.min.y + 1);
+            mOffsets.push_back(size);
+            size += (width + 2) * (height + 2);
+            maxWidth = std::max(maxWidth, width);
+        }
+        mTemp.resize(size);
+        if (mZeros.size() < maxWidth) { mZeros.resize(maxWidth, 0); }
+
+        if (!mBoxes.empty()) {
+            DistanceTransformJob job{src, dist, maxima, mBoxes.data(), mOffsets.data(),
+                                     mTemp.data(), mZeros.data()};
+            cv::parallel_for_(cv::Range{0, int(mBoxes.size())}, job, cv::getNumThreads());
+        }
+
+        mDirty = mBoxes;
+        mDistData = dist.data();
+        mMaximaData = maxima.data();
+        mDims = src.dims();
+    }
+
+    void DistanceTransform::findBoxes(const Mat& src) {
+        const Dims dims = src.dims();
+        const size_t skip = src.skip();
+        const uint8_t* data = src.data();
+        bool open = false;
+        Bounds box;
+        mBoxes.clear();
+
+        for (int y = 0; y < dims.height; y++, data += skip) {
+            int first = firstNonZero(data, dims.width);
+
+            if (first < 0) {
+                if (open) {
+                    mBoxes.push_back(box);
+                    open = false;
+                }
+                continue;
+            }
+
+            int last = first + lastNonZero(data + first, dims.width - first);
+            if (open) {
+                box.min.x = std::min(box.min.x, first);
+                box.max.x = std::max(box.max.x, last);
+                box.max.y = y;
+            } else {
+                box = {{first, y}, {last, y}};
+                open = true;
+            }
+        }
+
+        if (open) { mBoxes.push_back(box); }
+    }
+
+    void DistanceTransform::clear(Image& dist, Image& maxima) {
+        const Dims dims = dist.dims();
+
+        if (dist.data() != mDistData || maxima.data() != mMaximaData || dims != mDims) {
+            // the outputs are unknown, clear them entirely
+            size_t numPixels = size_t(dims.width) * size_t(dims.height);
+            std::fill_n((float*)dist.data(), numPixels, 0.f);
+            std::memset(maxima.data(), 0, numPixels);
+            return;
+        }
+
+        for (auto& box : mDirty) {
+            size_t width = size_t(box.max.x - box.min.x + 1);
+            for (int y = box.min.y; y <= box.max.y; y++) {
+                size_t offset = size_t(y) * dims.width + box.min.x;
+                std::fill_n((float*)dist.data() + offset, width, 0.f);
+                std::memset(maxima.data() + offset, 0, width);
+            }
+        }
+    }
+}
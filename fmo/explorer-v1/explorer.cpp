@@ -1,5 +1,6 @@
 #include "explorer.hpp"
 #include <limits>
+#include <stdexcept>
 
 namespace fmo {
     namespace {
@@ -9,6 +10,9 @@ namespace fmo {
     void registerExplorerV1() {
         Algorithm::registerFactory(
             "explorer-v1", [](const Algorithm::Config& config, Format format, Dims dims) {
+                if (config.haveRoi()) {
+                    throw std::runtime_error("explorer-v1: roi and roiMask are not supported");
+                }
                 return std::unique_ptr<Algorithm>(new ExplorerV1(config, format, dims));
             });
     }
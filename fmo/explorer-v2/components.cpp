@@ -16,15 +16,6 @@ namespace fmo {
         FMO_ASSERT(mStrips.size() < size_t(int16_max), "too many strips");
         int numStrips = int(mStrips.size());
 
-        // sort strips by x coordinate
-        std::sort(begin(mStrips), end(mStrips), [](const Strip& l, const Strip& r) {
-            if (l.pos.x == r.pos.x) {
-                return l.pos.y < r.pos.y;
-            } else {
-                return l.pos.x < r.pos.x;
-            }
-        });
-
         for (int i = 0; i < numStrips; i++) {
             Strip& me = mStrips[i];
 
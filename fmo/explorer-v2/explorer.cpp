@@ -1,6 +1,7 @@
 #include "explorer.hpp"
 #include <iostream>
 #include <limits>
+#include <stdexcept>
 
 namespace fmo {
     namespace {
@@ -10,6 +11,9 @@ namespace fmo {
     void registerExplorerV2() {
         Algorithm::registerFactory(
             "explorer-v2", [](const Algorithm::Config& config, Format format, Dims dims) {
+                if (config.haveRoi()) {
+                    throw std::runtime_error("explorer-v2: roi and roiMask are not supported");
+                }
                 return std::unique_ptr<Algorithm>(new ExplorerV2(config, format, dims));
             });
     }
@@ -58,12 +58,6 @@ namespace fmo {
                 cluster.lengthTotal = distL2(cluster.l.pos, cluster.r.pos);
                 cluster.lengthGaps = 0.f;
             }
-
-            if (mClusters.size() > size_t(Agglomerator::safetyMaxNumClusters)) {
-                // if there is way too many clusters, ignore this frame entirely
-                mClusters.clear();
-                return;
-            }
         };
 
         // evaluate the viability of merging clusters i and j
@@ -1,15 +1,26 @@
 #include "explorer.hpp"
 #include <iostream>
 #include <limits>
+#include <stdexcept>
 
 namespace fmo {
     namespace {
         constexpr int int16_max = std::numeric_limits<int16_t>::max();
+
+        /// Differentiator settings; the difference images are BINARY unless disabled.
+        Differentiator::Config diffConfig(const Algorithm::Config& cfg) {
+            Differentiator::Config result = cfg.diff;
+            result.binary = !cfg.grayDiff;
+            return result;
+        }
     }
 
     void registerExplorerV3() {
         Algorithm::registerFactory(
             "explorer-v3", [](const Algorithm::Config& config, Format format, Dims dims) {
+                if (config.haveRoi()) {
+                    throw std::runtime_error("explorer-v3: roi and roiMask are not supported");
+                }
                 return std::unique_ptr<Algorithm>(new ExplorerV3(config, format, dims));
             });
     }
@@ -17,7 +28,7 @@ namespace fmo {
     ExplorerV3::~ExplorerV3() = default;
 
     ExplorerV3::ExplorerV3(const Config& cfg, Format format, Dims dims)
-        : mDiff(cfg.diff), mCfg(cfg) {
+        : mDiff(diffConfig(cfg)), mCfg(cfg) {
         if (dims.width <= 0 || dims.height <= 0 || dims.width > int16_max ||
             dims.height > int16_max) {
             throw std::runtime_error("bad config");
@@ -55,9 +66,10 @@ namespace fmo {
         mLevel.image1.resize(format, dims);
         mLevel.image2.resize(format, dims);
         mLevel.image3.resize(format, dims);
-        mLevel.diff1.resize(Format::GRAY, dims);
-        mLevel.diff2.resize(Format::GRAY, dims);
-        mLevel.preprocessed.resize(Format::GRAY, dims);
+        const Format diffFormat = mCfg.grayDiff ? Format::GRAY : Format::BINARY;
+        mLevel.diff1.resize(diffFormat, dims);
+        mLevel.diff2.resize(diffFormat, dims);
+        mLevel.preprocessed.resize(diffFormat, dims);
         mLevel.step = step;
     }
 
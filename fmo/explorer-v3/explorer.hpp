@@ -138,7 +138,7 @@ namespace fmo {
             Image image1;                    ///< newest source image
             Image image2;                    ///< source image from previous frame
             Image image3;                    ///< source image from two frames before
-            Image diff1;                     ///< newest difference image
+            Image diff1;                     ///< newest difference image, BINARY or GRAY
             Image diff2;                     ///< difference image from previous frame
             std::vector<ProtoStrip> strips1; ///< strips in the newest difference image
             std::vector<ProtoStrip> strips2; ///< strips in the difference image from previous frame
@@ -150,6 +150,7 @@ namespace fmo {
 
         /// Miscellaneous cached objects, typically accessed by a single method.
         struct Cache {
+            Image visDiffUnpacked;
             Image visDiffGray;
             Image visDiffColor;
             Image visColor;
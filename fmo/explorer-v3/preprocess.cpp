@@ -39,10 +39,7 @@ namespace fmo {
 
         // combine difference images to create the preprocessed image
         if (mFrameNum >= 3) {
-            cv::Mat diff1Mat = level.diff1.wrap();
-            cv::Mat diff2Mat = level.diff2.wrap();
-            cv::Mat preprocessedMat = level.preprocessed.wrap();
-            cv::bitwise_or(diff1Mat, diff2Mat, preprocessedMat);
+            bitwise_or(level.diff1, level.diff2, level.preprocessed);
         }
     }
 }
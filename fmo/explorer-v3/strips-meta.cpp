@@ -28,8 +28,8 @@ namespace fmo {
             return UNRELATED;
         };
 
-        // sort strips before merging
-        std::sort(begin(mLevel.strips1), end(mLevel.strips1), stripComp);
+        // strips1 is already sorted as per stripComp, because StripGen outputs strips sorted by x,
+        // then by y, and strips in the same column don't overlap
 
         float maxRatio = mCfg.maxHeightRatioStrips;
         float minRatio = 1.f / maxRatio;
@@ -21,9 +21,14 @@ namespace fmo {
 
         // scale the current diff to source size
         {
+            const Image* diff = &mLevel.preprocessed;
+            if (diff->format() == Format::BINARY) {
+                convert(*diff, mCache.visDiffUnpacked, Format::GRAY);
+                diff = &mCache.visDiffUnpacked;
+            }
             mCache.visDiffGray.resize(Format::GRAY, mSourceLevel.dims);
             cv::Size cvSize{mSourceLevel.dims.width, mSourceLevel.dims.height};
-            cv::resize(mLevel.preprocessed.wrap(), mCache.visDiffGray.wrap(), cvSize, 0, 0,
+            cv::resize(diff->wrap(), mCache.visDiffGray.wrap(), cvSize, 0, 0,
                        cv::INTER_NEAREST);
             copy(mCache.visDiffGray, mCache.visDiffColor, Format::BGR);
         }
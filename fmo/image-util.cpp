@@ -18,6 +18,9 @@ namespace fmo {
         case Format::YUV420SP:
             result = (result * 3) / 2;
             break;
+        case Format::BINARY:
+            result = getBinaryRowBytes(dims.width) * static_cast<size_t>(dims.height);
+            break;
         default:
             throw std::runtime_error("getNumBytes: unsupported format");
         }
@@ -28,10 +31,14 @@ namespace fmo {
     cv::Size getCvSize(Format format, Dims dims) {
         cv::Size result{dims.width, dims.height};
         if (format == Format::YUV420SP) { result.height = (result.height * 3) / 2; }
+        if (format == Format::BINARY) { result.width = int(getBinaryRowBytes(dims.width)); }
         return result;
     }
 
     Dims getDims(Format format, cv::Size size) {
+        if (format == Format::BINARY) {
+            throw std::runtime_error("getDims: not applicable to BINARY");
+        }
         Dims result{size.width, size.height};
         if (format == Format::YUV420SP) { result.height = (result.height * 2) / 3; }
         return result;
@@ -50,6 +57,8 @@ namespace fmo {
             return CV_8UC1;
         case Format::FLOAT:
             return CV_32FC1;
+        case Format::BINARY:
+            return CV_8UC1;
         default:
             throw std::runtime_error("getCvType: unsupported format");
         }
@@ -67,6 +76,8 @@ namespace fmo {
             return 4;
         case Format::YUV420SP:
             throw std::runtime_error("getPixelStep: not applicable to YUV420SP");
+        case Format::BINARY:
+            throw std::runtime_error("getPixelStep: not applicable to BINARY");
         default:
             throw std::runtime_error("getPixelStep: unsupported format");
         }
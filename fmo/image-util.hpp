@@ -8,8 +8,12 @@ namespace fmo {
     /// Get the number of bytes of data that an image requires, given its format and dimensions.
     size_t getNumBytes(Format format, Dims dims);
 
+    /// Get the number of bytes in a row of a BINARY image.
+    inline size_t getBinaryRowBytes(int width) { return ((size_t(width) + 63) / 64) * 8; }
+
     /// Convert the actual dimensions to the size that is used by OpenCV. OpenCV considers YUV
-    /// 4:2:0 SP images 1.5x taller.
+    /// 4:2:0 SP images 1.5x taller. BINARY images are seen as GRAY images with one byte per eight
+    /// pixels.
     cv::Size getCvSize(Format format, Dims dims);
 
     /// Convert the size used by OpenCV to the actual dimensions. OpenCV considers YUV 4:2:0 SP
@@ -23,6 +27,17 @@ namespace fmo {
     /// for interleaved formats, such as GRAY, BGR, or INT32.
     size_t getPixelStep(Format format);
 
+    /// Expands a BINARY image into a GRAY image with values 0x00 and 0xFF.
+    void unpackBinary(const Mat& src, Mat& dst);
+
+    /// Stores a row of a GRAY image into a row of a BINARY image; bits are set for pixels that
+    /// are greater than thresh.
+    using packBinaryRow_t = void (*)(const uint8_t* src, uint64_t* dst, int width, uint8_t thresh);
+
+    /// Picks the packBinaryRow_t kernel for the active instruction set. Call it once per image,
+    /// not for every row.
+    packBinaryRow_t selectPackBinaryRow();
+
     /// Access the gray channel of a YUV420SP mat.
     cv::Mat yuv420SPWrapGray(const Mat& mat);
 
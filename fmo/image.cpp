@@ -30,6 +30,12 @@ namespace fmo {
     }
 
     void Image::assign(Format format, Dims dims, const uint8_t* data) {
+        if (format == Format::UNKNOWN) {
+            // copying an empty image
+            clear();
+            return;
+        }
+
         size_t bytes = getNumBytes(format, dims);
         mData.resize(bytes);
         mDims = dims;
@@ -45,7 +51,18 @@ namespace fmo {
 
         auto rowStep = static_cast<size_t>(mDims.width);
 
-        if (mFormat == Format::YUV420SP) {
+        if (mFormat == Format::BINARY) {
+            if (pos.x % 64 != 0) {
+                throw std::runtime_error("region: BINARY regions must be aligned to 64px");
+            }
+
+            rowStep = getBinaryRowBytes(mDims.width);
+            uint8_t* start = mData.data();
+            start += static_cast<size_t>(pos.x / 8);
+            start += rowStep * static_cast<size_t>(pos.y);
+
+            return {mFormat, pos, dims, start, nullptr, rowStep};
+        } else if (mFormat == Format::YUV420SP) {
             if (pos.x % 2 != 0 || pos.y % 2 != 0 || dims.width % 2 != 0 || dims.height % 2 != 0) {
                 throw std::runtime_error("region: YUV420SP regions must be aligned to 2px");
             }
@@ -71,6 +88,11 @@ namespace fmo {
         }
     }
 
+    size_t Image::skip() const {
+        if (mFormat == Format::BINARY) { return getBinaryRowBytes(mDims.width); }
+        return mDims.width;
+    }
+
     void Image::resize(Format format, Dims dims) {
         size_t bytes = getNumBytes(format, dims);
         mData.resize(bytes);
@@ -17,6 +17,15 @@
 #   define FMO_HAVE_AVX2
 #endif
 
+// x86 kernels for instruction sets beyond the compile-time baseline are built with per-function
+// target attributes and selected at runtime, see fmo/isa.hpp
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define FMO_HAVE_X86_DISPATCH
+#   define FMO_TARGET_AVX2 __attribute__((target("avx2")))
+#   define FMO_TARGET_AVX512BW __attribute__((target("avx512f,avx512bw")))
+#endif
+
 #if defined(__ARM_NEON__) || defined(__ARM_NEON)
 #   include <arm_neon.h>
 #   define FMO_HAVE_NEON
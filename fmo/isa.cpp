@@ -0,0 +1,96 @@
+#include "include-simd.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fmo/isa.hpp>
+#include <stdexcept>
+
+namespace fmo {
+    namespace {
+        const Isa ALL_ISAS[] = {Isa::SCALAR, Isa::SSE2, Isa::AVX2, Isa::AVX512BW, Isa::NEON};
+
+        /// Chooses the instruction set to use by default.
+        Isa initialIsa() {
+            const char* env = std::getenv("FMO_ISA");
+            if (env != nullptr) {
+                for (Isa isa : ALL_ISAS) {
+                    if (std::strcmp(env, isaName(isa)) == 0 && isaSupported(isa)) { return isa; }
+                }
+            }
+
+            for (Isa isa : {Isa::AVX512BW, Isa::AVX2, Isa::SSE2, Isa::NEON}) {
+                if (isaSupported(isa)) { return isa; }
+            }
+            return Isa::SCALAR;
+        }
+
+        std::atomic<Isa>& active() {
+            static std::atomic<Isa> instance{initialIsa()};
+            return instance;
+        }
+    }
+
+    bool isaSupported(Isa isa) {
+        switch (isa) {
+        case Isa::SCALAR:
+            return true;
+        case Isa::SSE2:
+#if defined(FMO_HAVE_SSE2)
+            return true;
+#else
+            return false;
+#endif
+        case Isa::AVX2:
+#if defined(FMO_HAVE_X86_DISPATCH)
+            return __builtin_cpu_supports("avx2");
+#elif defined(FMO_HAVE_AVX2)
+            return true;
+#else
+            return false;
+#endif
+        case Isa::AVX512BW:
+#if defined(FMO_HAVE_X86_DISPATCH)
+            return __builtin_cpu_supports("avx512bw");
+#else
+            return false;
+#endif
+        case Isa::NEON:
+#if defined(FMO_HAVE_NEON)
+            return true;
+#else
+            return false;
+#endif
+        }
+        return false;
+    }
+
+    Isa activeIsa() { return active().load(std::memory_order_relaxed); }
+
+    void setIsa(Isa isa) {
+        if (!isaSupported(isa)) { throw std::runtime_error("setIsa: instruction set not supported"); }
+        active().store(isa, std::memory_order_relaxed);
+    }
+
+    const char* isaName(Isa isa) {
+        switch (isa) {
+        case Isa::SCALAR:
+            return "scalar";
+        case Isa::SSE2:
+            return "sse2";
+        case Isa::AVX2:
+            return "avx2";
+        case Isa::AVX512BW:
+            return "avx512bw";
+        case Isa::NEON:
+            return "neon";
+        }
+        return "unknown";
+    }
+
+    Isa isaFromName(const char* name) {
+        for (Isa isa : ALL_ISAS) {
+            if (std::strcmp(name, isaName(isa)) == 0) { return isa; }
+        }
+        throw std::runtime_error("isaFromName: unknown instruction set");
+    }
+}
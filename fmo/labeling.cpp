@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fmo/common.hpp>
+#include <fmo/labeling.hpp>
+#include <stdexcept>
+
+namespace fmo {
+    namespace {
+        /// Tests whether all bytes of a word are non-zero.
+        inline bool noZeroByte(uint64_t word) {
+            const uint64_t lo = 0x0101010101010101ULL;
+            const uint64_t hi = 0x8080808080808080ULL;
+            return ((word - lo) & ~word & hi) == 0;
+        }
+
+        inline int lowestBit(uint64_t word) {
+#if defined(__GNUC__)
+            return __builtin_ctzll(word);
+#else
+            int result = 0;
+            while ((word & 1) == 0) {
+                word >>= 1;
+                result++;
+            }
+            return result;
+#endif
+        }
+    }
+
+    void ComponentLabeler::operator()(const Mat& img) {
+        const Dims dims = img.dims();
+        mRuns.clear();
+        mComponents.clear();
+        if (dims.width > 0 && dims.height > 0) {
+            encode(img, Bounds{{0, 0}, {dims.width - 1, dims.height - 1}});
+            label(0);
+        }
+        group();
+    }
+
+    void ComponentLabeler::operator()(const Mat& img, const std::vector<Bounds>& boxes) {
+        mRuns.clear();
+        mComponents.clear();
+        for (auto& box : boxes) {
+            int first = int(mRuns.size());
+            encode(img, box);
+            label(first);
+        }
+        group();
+    }
+
+    void ComponentLabeler::operator()(const std::vector<Run>& runs) {
+        mRuns.assign(runs.begin(), runs.end());
+        mComponents.clear();
+        label(0);
+        group();
+    }
+
+    void ComponentLabeler::encode(const Mat& img, const Bounds& box) {
+        const Format format = img.format();
+        if (format != Format::GRAY && format != Format::BINARY) {
+            throw std::runtime_error("ComponentLabeler: image must be GRAY or BINARY");
+        }
+        const size_t skip = img.skip();
+        const int end = box.max.x + 1;
+
+        for (int y = box.min.y; y <= box.max.y; y++) {
+            const uint8_t* row = img.data() + y * skip;
+
+            if (format == Format::BINARY) {
+                // finds the first column, starting at x, where the bit differs from background
+                auto next = [row, end](int x, uint64_t background) {
+                    while (x < end) {
+                        uint64_t word;
+                        std::memcpy(&word, row + (x >> 6) * sizeof(word), sizeof(word));
+                        word = (word ^ background) >> (x & 63);
+                        if (word != 0) return std::min(end, x + lowestBit(word));
+                        x = (x | 63) + 1;
+                    }
+                    return end;
+                };
+
+                for (int x = next(box.min.x, 0); x < end;) {
+                    int x0 = x;
+                    x = next(x, ~uint64_t(0));
+                    mRuns.push_back(Run{y, x0, x});
+                    x = next(x, 0);
+                }
+                continue;
+            }
+
+            int x = box.min.x;
+            while (x < end) {
+                // skip the background, eight pixels at a time where possible
+                for (uint64_t word; x + 8 <= end; x += 8) {
+                    std::memcpy(&word, row + x, sizeof(word));
+                    if (word != 0) break;
+                }
+                while (x < end && row[x] == 0) x++;
+                if (x == end) break;
+
+                // skip the foreground, eight pixels at a time where possible
+                int x0 = x;
+                for (uint64_t word; x + 8 <= end; x += 8) {
+                    std::memcpy(&word, row + x, sizeof(word));
+                    if (!noZeroByte(word)) break;
+                }
+                while (x < end && row[x] != 0) x++;
+                mRuns.push_back(Run{y, x0, x});
+            }
+        }
+    }
+
+    int ComponentLabeler::find(int i) {
+        int root = i;
+        while (mParent[root] != root) root = mParent[root];
+        while (mParent[i] != root) {
+            int next = mParent[i];
+            mParent[i] = root;
+            i = next;
+        }
+        return root;
+    }
+
+    void ComponentLabeler::label(int first) {
+        const int n = int(mRuns.size());
+        mParent.resize(mRuns.size());
+        mLabel.resize(mRuns.size());
+        for (int i = first; i < n; i++) mParent[i] = i;
+
+        // merge each run with the touching runs of the previous row; the root of each tree is its
+        // first run, so that components are numbered in the order of their first pixel
+        int prevBegin = first, prevEnd = first, rowBegin = first;
+        for (int i = first; i < n; i++) {
+            const Run& run = mRuns[i];
+            if (run.y != mRuns[rowBegin].y) {
+                bool adjacent = run.y == mRuns[rowBegin].y + 1;
+                prevBegin = adjacent ? rowBegin : i;
+                prevEnd = i;
+                rowBegin = i;
+            }
+
+            // runs that end left of this run cannot touch any of the following runs either
+            while (prevBegin < prevEnd && mRuns[prevBegin].x1 < run.x0) prevBegin++;
+            for (int j = prevBegin; j < prevEnd && mRuns[j].x0 <= run.x1; j++) {
+                int a = find(i), b = find(j);
+                if (a < b) {
+                    mParent[b] = a;
+                } else if (b < a) {
+                    mParent[a] = b;
+                }
+            }
+        }
+
+        // assign component indices and accumulate the statistics
+        for (int i = first; i < n; i++) {
+            const Run& run = mRuns[i];
+            int root = find(i);
+            if (root == i) {
+                mLabel[i] = int(mComponents.size());
+                mComponents.push_back(
+                    Component{{{run.x0, run.y}, {run.x1 - 1, run.y}}, 0, 0., 0., 0, 0});
+            } else {
+                mLabel[i] = mLabel[root];
+            }
+
+            Component& comp = mComponents[mLabel[i]];
+            int len = run.x1 - run.x0;
+            comp.bounds.min.x = std::min(comp.bounds.min.x, run.x0);
+            comp.bounds.max.x = std::max(comp.bounds.max.x, run.x1 - 1);
+            comp.bounds.max.y = run.y;
+            comp.area += len;
+            comp.centerX += 0.5 * double(len) * double(run.x0 + run.x1 - 1);
+            comp.centerY += double(len) * double(run.y);
+            comp.numRuns++;
+        }
+    }
+
+    void ComponentLabeler::group() {
+        int offset = 0;
+        for (auto& comp : mComponents) {
+            comp.firstRun = offset;
+            offset += comp.numRuns;
+            comp.numRuns = 0;
+            comp.centerX /= comp.area;
+            comp.centerY /= comp.area;
+        }
+
+        // the runs are visited in the order of rows, so they stay sorted within each component
+        mSorted.resize(mRuns.size());
+        for (size_t i = 0; i < mRuns.size(); i++) {
+            Component& comp = mComponents[mLabel[i]];
+            mSorted[comp.firstRun + comp.numRuns++] = mRuns[i];
+        }
+    }
+}
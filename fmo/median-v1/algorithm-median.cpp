@@ -1,11 +1,15 @@
 #include "algorithm-median.hpp"
 #include "../include-opencv.hpp"
 #include <fmo/processing.hpp>
+#include <stdexcept>
 
 namespace fmo {
     void registerMedianV1() {
         Algorithm::registerFactory(
             "median-v1", [](const Algorithm::Config& config, Format format, Dims dims) {
+                if (config.haveRoi()) {
+                    throw std::runtime_error("median-v1: roi and roiMask are not supported");
+                }
                 return std::unique_ptr<Algorithm>(new MedianV1(config, format, dims));
             });
     }
@@ -1,17 +1,22 @@
 #include "algorithm-median.hpp"
 #include "../include-opencv.hpp"
 #include <fmo/processing.hpp>
+#include <stdexcept>
 
 namespace fmo {
     void registerMedianV2() {
         Algorithm::registerFactory(
             "median-v2", [](const Algorithm::Config& config, Format format, Dims dims) {
+                if (config.haveRoi()) {
+                    throw std::runtime_error("median-v2: roi and roiMask are not supported");
+                }
                 return std::unique_ptr<Algorithm>(new MedianV2(config, format, dims));
             });
     }
 
     MedianV2::MedianV2(const Config& cfg, Format format, Dims dims)
-        : mCfg(cfg), mSourceLevel{{format, dims}, 0}, mDiff(cfg.diff) {}
+        : mCfg(cfg), mSourceLevel{{format, dims}, 0}, mBackground(cfg.backgroundWindow),
+          mDiff(cfg.diff) {}
 
     void MedianV2::setInputSwap(Image& in) {
         swapAndSubsampleInput(in);
@@ -55,11 +60,8 @@ namespace fmo {
             throw std::runtime_error("setInputSwap(): input image too small");
         }
 
-        // swap the product of decimation into the processing level
-        mProcessingLevel.inputs[3].swap(mProcessingLevel.inputs[2]);
-        mProcessingLevel.inputs[2].swap(mProcessingLevel.inputs[1]);
-        mProcessingLevel.inputs[1].swap(mProcessingLevel.inputs[0]);
-        mProcessingLevel.inputs[0].swap(*input);
+        // swap the product of decimation into the background model
+        mBackground.swapInput(*input);
         mProcessingLevel.pixelSizeLog2 = pixelSizeLog2;
     }
 
@@ -68,16 +70,11 @@ namespace fmo {
 
         if (mSourceLevel.frameNum < 4) {
             // initial frames: just generate a black diff
-            level.binDiff.resize(Format::GRAY, level.inputs[0].dims());
+            level.binDiff.resize(Format::GRAY, mBackground.frame(0).dims());
             level.binDiff.wrap().setTo(uint8_t(0x00));
-
-            level.background.resize(Format::BGR, level.inputs[0].dims());
-            level.background.wrap().setTo(uint8_t(0x00));
             return;
         }
 
-        fmo::median5(level.inputs[0], level.inputs[1], level.inputs[2], 
-            level.inputs[3], level.background, level.background);
-        mDiff(level.inputs[0], level.background, level.binDiff);
+        mDiff(mBackground, level.binDiff);
     }
 }
@@ -4,6 +4,7 @@
 #include <fmo/agglomerator.hpp>
 #include <fmo/algebra.hpp>
 #include <fmo/algorithm.hpp>
+#include <fmo/background.hpp>
 #include <fmo/subsampler.hpp>
 #include <fmo/stats.hpp>
 #include <fmo/strip.hpp>
@@ -100,8 +101,7 @@ namespace fmo {
         /// subsampled image.
         void swapAndSubsampleInput(Image& in);
 
-        /// Calculates the per-pixel median of the last three frames to obtain the background.
-        /// Creates a binary difference image of background vs. the latest image.
+        /// Creates a binary difference image of the background vs. the latest image.
         void computeBinDiff();
 
         /// Detects strips by iterating over the pixels in the image. Creates connected components
@@ -135,8 +135,6 @@ namespace fmo {
 
         struct {
             int pixelSizeLog2;     ///< processing-level pixel size compared to source level, log2
-            Image inputs[4];       ///< input images subsampled to processing resolution, 0 - newest
-            Image background;      ///< median of the last three inputs
             Image binDiff;         ///< binary difference image, latest image vs. background
             int objectCounter = 0; ///< used to generate unique identifiers for detections
         } mProcessingLevel;
@@ -155,6 +153,7 @@ namespace fmo {
         } mCache;
 
         Subsampler mSubsampler;               ///< decimation tool that handles any image format
+        BackgroundModel mBackground;        ///< subsampled inputs and the background
         Differentiator mDiff;               ///< for creating the binary difference image
         StripGen mStripGen;                 ///< for finding strips in the difference image
         std::vector<Strip> mStrips;         ///< detected strips, ordered by x coordinate
@@ -11,15 +11,6 @@ namespace fmo {
         mStripGen(input, minHeight, minGapY, step, mStrips, outNoise);
         mDiff.reportAmountOfNoise(outNoise);
 
-        // sort strips by x coordinate
-        std::sort(begin(mStrips), end(mStrips), [](const Strip& l, const Strip& r) {
-            if (l.pos.x == r.pos.x) {
-                return l.pos.y < r.pos.y;
-            } else {
-                return l.pos.x < r.pos.x;
-            }
-        });
-
         // sanity check: strips must be addressable with int16_t
         constexpr size_t int16Max = size_t(std::numeric_limits<int16_t>::max());
         if (mStrips.size() > int16Max) {
@@ -88,6 +88,15 @@ namespace fmo {
             return;
         }
 
+        if (srcFormat == Format::GRAY && dstFormat == Format::BINARY) {
+            greater_than_binary(src, dst, 0);
+            return;
+        }
+        if (srcFormat == Format::BINARY && dstFormat == Format::GRAY) {
+            unpackBinary(src, dst);
+            return;
+        }
+
         enum { ERROR = -1 };
         int code = ERROR;
 
@@ -170,7 +179,7 @@ namespace fmo {
         // non maxima suppression
         cv::Mat temp;
         cv::dilate(srcMat, temp, cv::Mat());
-        dstMat = srcMat == temp;
+        cv::compare(srcMat, temp, dstMat, cv::CMP_EQ);
 //        cv::bitwise_and(dstMat, srcMat >= 1.5, dstMat);
 
         FMO_ASSERT(dstMat.data == dst.data(), "local_maxima: dst buffer reallocated");
@@ -0,0 +1,176 @@
+#include "image-util.hpp"
+#include "include-simd.hpp"
+#include <algorithm>
+#include <fmo/assert.hpp>
+#include <fmo/isa.hpp>
+#include <fmo/processing.hpp>
+
+namespace fmo {
+    namespace {
+        void packScalar(const uint8_t* src, uint64_t* dst, int width, uint8_t thresh) {
+            for (int x = 0; x < width; x += 64, dst++) {
+                const int iEnd = std::min(64, width - x);
+                uint64_t word = 0;
+                for (int i = 0; i < iEnd; i++) {
+                    if (src[x + i] > thresh) { word |= uint64_t(1) << i; }
+                }
+                *dst = word;
+            }
+        }
+
+#if defined(FMO_HAVE_SSE2)
+        void packSse2(const uint8_t* src, uint64_t* dst, int width, uint8_t thresh) {
+            const __m128i threshVec = _mm_set1_epi8(char(thresh));
+            const __m128i zero = _mm_setzero_si128();
+            int x = 0;
+            for (; x + 64 <= width; x += 64, dst++) {
+                uint64_t word = 0;
+                for (int k = 0; k < 4; k++) {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(src + x + 16 * k));
+                    v = _mm_cmpeq_epi8(_mm_subs_epu8(v, threshVec), zero);
+                    uint64_t notGreater = uint64_t(uint32_t(_mm_movemask_epi8(v)));
+                    word |= (notGreater ^ 0xFFFF) << (16 * k);
+                }
+                *dst = word;
+            }
+            packScalar(src + x, dst, width - x, thresh);
+        }
+#endif
+
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+#   if defined(FMO_HAVE_X86_DISPATCH)
+        FMO_TARGET_AVX2
+#   endif
+        void packAvx2(const uint8_t* src, uint64_t* dst, int width, uint8_t thresh) {
+            const __m256i threshVec = _mm256_set1_epi8(char(thresh));
+            const __m256i zero = _mm256_setzero_si256();
+            int x = 0;
+            for (; x + 64 <= width; x += 64, dst++) {
+                __m256i lo = _mm256_loadu_si256((const __m256i*)(src + x));
+                __m256i hi = _mm256_loadu_si256((const __m256i*)(src + x + 32));
+                lo = _mm256_cmpeq_epi8(_mm256_subs_epu8(lo, threshVec), zero);
+                hi = _mm256_cmpeq_epi8(_mm256_subs_epu8(hi, threshVec), zero);
+                uint64_t notGreater = uint64_t(uint32_t(_mm256_movemask_epi8(lo))) |
+                                      (uint64_t(uint32_t(_mm256_movemask_epi8(hi))) << 32);
+                *dst = ~notGreater;
+            }
+            packScalar(src + x, dst, width - x, thresh);
+        }
+#endif
+
+#if defined(FMO_HAVE_X86_DISPATCH)
+        FMO_TARGET_AVX512BW
+        void packAvx512(const uint8_t* src, uint64_t* dst, int width, uint8_t thresh) {
+            const __m512i threshVec = _mm512_set1_epi8(char(thresh));
+            int x = 0;
+            for (; x + 64 <= width; x += 64, dst++) {
+                __m512i v = _mm512_loadu_si512((const void*)(src + x));
+                *dst = uint64_t(_mm512_cmpgt_epu8_mask(v, threshVec));
+            }
+            packScalar(src + x, dst, width - x, thresh);
+        }
+#endif
+    }
+
+    packBinaryRow_t selectPackBinaryRow() {
+        switch (activeIsa()) {
+#if defined(FMO_HAVE_X86_DISPATCH)
+        case Isa::AVX512BW:
+            return packAvx512;
+#endif
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+        case Isa::AVX2:
+            return packAvx2;
+#endif
+#if defined(FMO_HAVE_SSE2)
+        case Isa::SSE2:
+            return packSse2;
+#endif
+        default:
+            return packScalar;
+        }
+    }
+
+    struct PackBinaryJob : public cv::ParallelLoopBody {
+        PackBinaryJob(const Mat& src, Mat& dst, uint8_t thresh)
+            : mSrc(src.data()),
+              mDst(dst.data()),
+              mSrcSkip(src.skip()),
+              mDstSkip(dst.skip()),
+              mWidth(src.dims().width),
+              mThresh(thresh),
+              mKernel(selectPackBinaryRow()) {}
+
+        virtual void operator()(const cv::Range& rows) const override {
+            for (int row = rows.start; row < rows.end; row++) {
+                const uint8_t* src = mSrc + size_t(row) * mSrcSkip;
+                uint64_t* dst = (uint64_t*)(mDst + size_t(row) * mDstSkip);
+                mKernel(src, dst, mWidth, mThresh);
+            }
+        }
+
+    private:
+        const uint8_t* const mSrc;
+        uint8_t* const mDst;
+        const size_t mSrcSkip;
+        const size_t mDstSkip;
+        const int mWidth;
+        const uint8_t mThresh;
+        const packBinaryRow_t mKernel;
+    };
+
+    void greater_than_binary(const Mat& src, Mat& dst, uint8_t value) {
+        if (src.format() != Format::GRAY) {
+            throw std::runtime_error("greater_than_binary: input must be GRAY");
+        }
+
+        dst.resize(Format::BINARY, src.dims());
+        PackBinaryJob job{src, dst, value};
+        cv::parallel_for_(cv::Range{0, src.dims().height}, job, cv::getNumThreads());
+    }
+
+    void unpackBinary(const Mat& src, Mat& dst) {
+        const Dims dims = src.dims();
+        dst.resize(Format::GRAY, dims);
+
+        for (int row = 0; row < dims.height; row++) {
+            const uint64_t* words = (const uint64_t*)(src.data() + size_t(row) * src.skip());
+            uint8_t* out = dst.data() + size_t(row) * dst.skip();
+            for (int x = 0; x < dims.width; x++) {
+                bool set = ((words[x / 64] >> (x % 64)) & 1) != 0;
+                out[x] = set ? uint8_t(0xFF) : uint8_t(0);
+            }
+        }
+    }
+
+    namespace {
+        template <typename Op>
+        void bitwiseImpl(const Mat& src1, const Mat& src2, Mat& dst, const char* name, Op op) {
+            const Format format = src1.format();
+            const Dims dims = src1.dims();
+
+            if (format != src2.format() || dims != src2.dims()) {
+                throw std::runtime_error(std::string(name) + ": format/dimensions mismatch");
+            }
+            if (format != Format::GRAY && format != Format::BINARY) {
+                throw std::runtime_error(std::string(name) + ": input must be GRAY or BINARY");
+            }
+
+            // both formats are combined byte by byte, the padding of BINARY rows stays zero
+            dst.resize(format, dims);
+            cv::Mat dstMat = dst.wrap();
+            op(src1.wrap(), src2.wrap(), dstMat);
+            FMO_ASSERT(dstMat.data == dst.data(), "bitwise: dst buffer reallocated");
+        }
+    }
+
+    void bitwise_or(const Mat& src1, const Mat& src2, Mat& dst) {
+        bitwiseImpl(src1, src2, dst, "bitwise_or", [](const cv::Mat& a, const cv::Mat& b,
+                                                      cv::Mat& c) { cv::bitwise_or(a, b, c); });
+    }
+
+    void bitwise_and(const Mat& src1, const Mat& src2, Mat& dst) {
+        bitwiseImpl(src1, src2, dst, "bitwise_and", [](const cv::Mat& a, const cv::Mat& b,
+                                                       cv::Mat& c) { cv::bitwise_and(a, b, c); });
+    }
+}
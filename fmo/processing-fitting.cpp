@@ -1,23 +1,25 @@
 #include "image-util.hpp"
+#include "include-simd.hpp"
 #include <fmo/assert.hpp>
 #include <fmo/processing.hpp>
 #include <fmo/region.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 
 namespace fmo {
-//////////////////////////////////// CIRCLE ////////////////////////////////////////////////////////////////////
-
-    float verifyCircle(const std::vector<cv::Point2f>& pixels, const cv::Point2f &center,
-                       const float radius, const float inlierT) {
-        int score = 0;
-        for (auto &p : pixels) {
-            float dist = abs(cv::norm(p - center) - radius);
-            if (dist <= inlierT) 
-                score += 1 - (dist/inlierT);
+    namespace {
+        /// Wraps the points in a Mat so that they can be passed to OpenCV functions.
+        cv::Mat pointMat(PointSpan pixels) {
+            return cv::Mat(int(pixels.size()), 1, CV_32FC2, (void*)pixels.data());
         }
-        return score;
     }
 
+//////////////////////////////////// CIRCLE ////////////////////////////////////////////////////////////////////
+
     inline void getCircle(const cv::Point2f& p1, const cv::Point2f& p2, const cv::Point2f& p3,
                           cv::Point2f& center, float& radius) {
         float x1 = p1.x;
@@ -53,53 +55,254 @@ namespace fmo {
         return pointPositions;
     }
 
-    float findcircle(const std::vector<cv::Point2f>& pixels, const float fmoRadius, SCircle &circle) {
-        cv::Point2f bestCircleCenter;
-        float bestCircleRadius = -1;
-        float inlierT = std::max(1.f,0.1f*fmoRadius);
-        float bestScore = 0;
+    namespace {
+        /// Small deterministic random number generator. Each fit seeds its own instance, so the
+        /// results are reproducible and the fitting can run in several threads at once.
+        struct XorShift32 {
+            XorShift32(uint32_t seed) : mState(seed != 0 ? seed : 0x9E3779B9u) {}
+
+            uint32_t operator()() {
+                mState ^= mState << 13;
+                mState ^= mState >> 17;
+                mState ^= mState << 5;
+                return mState;
+            }
+
+            /// Provides a number in range [0, n).
+            uint32_t below(uint32_t n) { return uint32_t((uint64_t((*this)()) * n) >> 32); }
+
+        private:
+            uint32_t mState;
+        };
+
+#if defined(FMO_HAVE_AVX2)
+        using vfloat = __m256;
+        enum : int { LANES = 8 };
+        inline vfloat vset(float v) { return _mm256_set1_ps(v); }
+        inline vfloat vload(const float* p) { return _mm256_load_ps(p); }
+        inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+        inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+        inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+        inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+        inline vfloat vsqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+        inline vfloat vabs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+        inline vfloat vle1(vfloat a, vfloat b) {
+            return _mm256_and_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ), _mm256_set1_ps(1.f));
+        }
+        inline void vstore(float* p, vfloat a) { _mm256_storeu_ps(p, a); }
+#elif defined(FMO_HAVE_SSE2)
+        using vfloat = __m128;
+        enum : int { LANES = 4 };
+        inline vfloat vset(float v) { return _mm_set1_ps(v); }
+        inline vfloat vload(const float* p) { return _mm_load_ps(p); }
+        inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+        inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+        inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+        inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+        inline vfloat vsqrt(vfloat a) { return _mm_sqrt_ps(a); }
+        inline vfloat vabs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+        inline vfloat vle1(vfloat a, vfloat b) {
+            return _mm_and_ps(_mm_cmple_ps(a, b), _mm_set1_ps(1.f));
+        }
+        inline void vstore(float* p, vfloat a) { _mm_storeu_ps(p, a); }
+#elif defined(FMO_HAVE_NEON) && defined(__aarch64__)
+        using vfloat = float32x4_t;
+        enum : int { LANES = 4 };
+        inline vfloat vset(float v) { return vdupq_n_f32(v); }
+        inline vfloat vload(const float* p) { return vld1q_f32(p); }
+        inline vfloat vadd(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+        inline vfloat vsub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+        inline vfloat vmul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+        inline vfloat vmax(vfloat a, vfloat b) { return vmaxq_f32(a, b); }
+        inline vfloat vsqrt(vfloat a) { return vsqrtq_f32(a); }
+        inline vfloat vabs(vfloat a) { return vabsq_f32(a); }
+        inline vfloat vle1(vfloat a, vfloat b) {
+            return vreinterpretq_f32_u32(
+                vandq_u32(vcleq_f32(a, b), vreinterpretq_u32_f32(vdupq_n_f32(1.f))));
+        }
+        inline void vstore(float* p, vfloat a) { vst1q_f32(p, a); }
+#else
+        using vfloat = float;
+        enum : int { LANES = 1 };
+        inline vfloat vset(float v) { return v; }
+        inline vfloat vload(const float* p) { return *p; }
+        inline vfloat vadd(vfloat a, vfloat b) { return a + b; }
+        inline vfloat vsub(vfloat a, vfloat b) { return a - b; }
+        inline vfloat vmul(vfloat a, vfloat b) { return a * b; }
+        inline vfloat vmax(vfloat a, vfloat b) { return std::max(a, b); }
+        inline vfloat vsqrt(vfloat a) { return std::sqrt(a); }
+        inline vfloat vabs(vfloat a) { return std::abs(a); }
+        inline vfloat vle1(vfloat a, vfloat b) { return (a <= b) ? 1.f : 0.f; }
+        inline void vstore(float* p, vfloat a) { *p = a; }
+#endif
+
+        inline float vsum(vfloat a) {
+            alignas(32) float lanes[LANES];
+            vstore(lanes, a);
+            float sum = 0;
+            for (int i = 0; i < LANES; i++) { sum += lanes[i]; }
+            return sum;
+        }
+
+        /// Point coordinates stored in separate arrays and padded to a whole number of SIMD
+        /// batches. The padding points lie far away, so they never contribute to a score.
+        struct PointsSoA {
+            void assign(PointSpan pixels) {
+                size = pixels.size();
+                padded = (size + LANES - 1) / LANES * LANES;
+                x.resize(padded + LANES);
+                y.resize(padded + LANES);
+                px = align(x);
+                py = align(y);
+                for (size_t i = 0; i < size; i++) {
+                    px[i] = pixels[i].x;
+                    py[i] = pixels[i].y;
+                }
+                for (size_t i = size; i < padded; i++) {
+                    px[i] = 1e6f;
+                    py[i] = 1e6f;
+                }
+            }
+
+            size_t size = 0;
+            size_t padded = 0;
+            float* px = nullptr;
+            float* py = nullptr;
 
-        int maxNrOfIterations = 2*pixels.size();   // TODO: adjust this parameter or include some real ransac criteria with inlier/outlier percentages to decide when to stop
-        maxNrOfIterations = 4*fmoRadius;
-        for(int its=0; its< maxNrOfIterations; ++its) {
-            //RANSAC: randomly choose 3 point and create a circle:
-            //TODO: choose randomly but more intelligent,
-            //so that it is more likely to choose three points of a circle.
-            //For example if there are many small circles, it is unlikely to randomly choose 3 points of the same circle.
-            unsigned int idx1 = rand()%pixels.size();
-            unsigned int idx2 = rand()%pixels.size();
-            unsigned int idx3 = rand()%pixels.size();
-
-            // we need 3 different samples:
-            if(idx1 == idx2) continue;
-            if(idx1 == idx3) continue;
-            if(idx3 == idx2) continue;
-
-            // create circle from 3 points:
-            cv::Point2f center{0.f,0.f};
-            float radius(0.f);
-            getCircle(pixels[idx1],pixels[idx2],pixels[idx3],center,radius);
-            if (radius < 2*fmoRadius || radius == std::numeric_limits<float>::infinity()) continue;
-
-            //verify or falsify the circle by inlier counting:
-            float score = verifyCircle(pixels,center,radius,inlierT);
-
-            // update best circle information if necessary
-            if(score > bestScore)
-            {
-                bestScore = score;
-                bestCircleRadius = radius;
-                bestCircleCenter = center;
+        private:
+            static float* align(std::vector<float>& vec) {
+                auto addr = reinterpret_cast<uintptr_t>(vec.data());
+                size_t mis = (addr / sizeof(float)) % LANES;
+                return vec.data() + (mis == 0 ? 0 : LANES - mis);
             }
 
+            std::vector<float> x, y;
+        };
+
+        /// Circle hypothesis made from three points.
+        struct Hypothesis {
+            float x, y, radius;
+        };
+
+        enum : int {
+            BATCH = 8, ///< the number of hypotheses evaluated in a single pass over the points
+        };
+
+        /// Evaluates several circle hypotheses at once. Each point contributes to the score of a
+        /// hypothesis with 1 - dist / inlierT if its distance from the circle is at most
+        /// inlierT. The number of such points is also provided.
+        void scoreCircles(const PointsSoA& pts, const Hypothesis* hyps, int count,
+                          float inlierT, float* scores, float* inliers) {
+            vfloat cx[BATCH], cy[BATCH], r[BATCH], score[BATCH], inl[BATCH];
+            for (int h = 0; h < count; h++) {
+                cx[h] = vset(hyps[h].x);
+                cy[h] = vset(hyps[h].y);
+                r[h] = vset(hyps[h].radius);
+                score[h] = vset(0.f);
+                inl[h] = vset(0.f);
+            }
+
+            const vfloat thresh = vset(inlierT);
+            const vfloat invThresh = vset(1.f / inlierT);
+            const vfloat one = vset(1.f);
+            const vfloat zero = vset(0.f);
+            for (size_t i = 0; i < pts.padded; i += LANES) {
+                vfloat px = vload(pts.px + i);
+                vfloat py = vload(pts.py + i);
+                for (int h = 0; h < count; h++) {
+                    vfloat dx = vsub(px, cx[h]);
+                    vfloat dy = vsub(py, cy[h]);
+                    vfloat dist = vsqrt(vadd(vmul(dx, dx), vmul(dy, dy)));
+                    dist = vabs(vsub(dist, r[h]));
+                    // the weight is positive exactly when dist < inlierT
+                    score[h] = vadd(score[h], vmax(zero, vsub(one, vmul(dist, invThresh))));
+                    inl[h] = vadd(inl[h], vle1(dist, thresh));
+                }
+            }
+
+            for (int h = 0; h < count; h++) {
+                scores[h] = vsum(score[h]);
+                inliers[h] = vsum(inl[h]);
+            }
+        }
+
+        /// Makes a circle that passes through three points. Returns false if the points are
+        /// (nearly) collinear.
+        bool makeHypothesis(const cv::Point2f& p1, const cv::Point2f& p2, const cv::Point2f& p3,
+                            Hypothesis& out) {
+            float det = 2 * (p1.x * (p2.y - p3.y) - p1.y * (p2.x - p3.x) + p2.x * p3.y -
+                             p3.x * p2.y);
+            if (std::abs(det) < 1e-3f) return false;
+            cv::Point2f center;
+            getCircle(p1, p2, p3, center, out.radius);
+            out.x = center.x;
+            out.y = center.y;
+            return true;
         }
-        circle.radius = bestCircleRadius;
-        circle.x = bestCircleCenter.x;
-        circle.y = bestCircleCenter.y;
+    }
+
+    float findcircle(PointSpan pixels, const float fmoRadius, SCircle &circle) {
+        const float inlierT = std::max(1.f, 0.1f * fmoRadius);
+        const int maxIterations = int(4 * fmoRadius);
+        const uint32_t n = uint32_t(pixels.size());
+        float bestScore = 0;
+        float bestInliers = 0;
+        Hypothesis best{0.f, 0.f, -1.f};
+
+        if (n >= 3) {
+            // scratch space is kept per thread, so it is only allocated during the first fits
+            thread_local PointsSoA pts;
+            pts.assign(pixels);
+
+            // seed with the input, so that the same points always give the same circle
+            XorShift32 rng{n * 0x9E3779B1u ^ uint32_t(fmoRadius * 256.f)};
+            Hypothesis hyps[BATCH];
+            float scores[BATCH], inliers[BATCH];
+            int iterations = 0;
+            double required = maxIterations;
+
+            while (iterations < maxIterations && iterations < required) {
+                // generate a batch of hypotheses from random triplets of distinct points
+                int count = 0;
+                while (count < BATCH && iterations < maxIterations) {
+                    iterations++;
+                    uint32_t i1 = rng.below(n);
+                    uint32_t i2 = rng.below(n - 1);
+                    uint32_t i3 = rng.below(n - 2);
+                    if (i2 >= i1) i2++;
+                    if (i3 >= std::min(i1, i2)) i3++;
+                    if (i3 >= std::max(i1, i2)) i3++;
+                    Hypothesis& h = hyps[count];
+                    if (!makeHypothesis(pixels[i1], pixels[i2], pixels[i3], h)) continue;
+                    if (h.radius < 2 * fmoRadius) continue;
+                    count++;
+                }
+                if (count == 0) continue;
+
+                scoreCircles(pts, hyps, count, inlierT, scores, inliers);
+                for (int h = 0; h < count; h++) {
+                    if (scores[h] > bestScore) {
+                        bestScore = scores[h];
+                        bestInliers = inliers[h];
+                        best = hyps[h];
+                    }
+                }
+
+                // stop once a better circle is unlikely to be found (99% confidence)
+                double ratio = double(bestInliers) / n;
+                if (ratio >= 1) break;
+                double miss = std::log(1 - ratio * ratio * ratio);
+                if (miss < 0) { required = std::log(0.01) / miss; }
+            }
+        }
+
+        circle.radius = best.radius;
+        circle.x = best.x;
+        circle.y = best.y;
         return bestScore;
     }
 
-    float fitcircle(const std::vector<cv::Point2f>& pixels, const float fmoRadius, SCircle &circle) {
+    float fitcircle(PointSpan pixels, const float fmoRadius, SCircle &circle) {
         float bestScore = findcircle(pixels,fmoRadius,circle);
 
         double startDegree2 = 0;
@@ -151,44 +354,67 @@ namespace fmo {
         return bestScore;
     }
 
-    float fitcircle(const std::vector<cv::Point2f>& pixels, const float fmoRadius, SCircle &circle,
-                    const cv::Vec2f &c1, const cv::Vec2f &c2) {
-        float bestScore = findcircle(pixels,fmoRadius,circle);
+    namespace {
+        /// Sets the arc of the circle so that it goes from c1 to c2. Returns the arc size in
+        /// degrees.
+        double setArc(SCircle &circle, const cv::Vec2f &c1, const cv::Vec2f &c2) {
+            double angle = atan2(c1[1] - circle.y, c1[0] - circle.x) * (180.0/M_PI);
+            double angle2 = atan2(c2[1] - circle.y, c2[0] - circle.x) * (180.0/M_PI);
 
-        double angle = atan2(c1[1] - circle.y, c1[0] - circle.x) * (180.0/M_PI);
-        double angle2 = atan2(c2[1] - circle.y, c2[0] - circle.x) * (180.0/M_PI);
+            double sz = std::abs(angle2 - angle);
 
-        double sz = std::abs(angle2 - angle);
+            if(sz < 180) {
+                circle.startDegree = angle;
+                circle.endDegree = angle2;
+            } else {
+                circle.startDegree = angle2;
+                circle.endDegree = angle;
+                if(circle.startDegree < 0) circle.startDegree += 360;
+                if(circle.endDegree < 0) circle.endDegree += 360;
+                sz = 360 - sz;
+            }
 
-        if(sz < 180) {
-            circle.startDegree = angle;
-            circle.endDegree = angle2;
-        } else {
-            circle.startDegree = angle2;
-            circle.endDegree = angle;
-            if(circle.startDegree < 0) circle.startDegree += 360;
-            if(circle.endDegree < 0) circle.endDegree += 360;
-            sz = 360 - sz;
-        }
+            circle.startDegreeSmooth = circle.startDegree;
+            circle.endDegreeSmooth = circle.endDegree;
+            circle.length = circle.radius*sz*M_PI/180.0f;
 
-        circle.startDegreeSmooth = circle.startDegree;
-        circle.endDegreeSmooth = circle.endDegree;
-        circle.length = circle.radius*sz*M_PI/180.0f;
+            circle.size = sz;
+            return sz;
+        }
+    }
 
-        circle.size = sz;
+    float fitcircle(PointSpan pixels, const float fmoRadius, SCircle &circle,
+                    const cv::Vec2f &c1, const cv::Vec2f &c2) {
+        float bestScore = findcircle(pixels,fmoRadius,circle);
+        double sz = setArc(circle, c1, c2);
         if (circle.radius == 0 || sz > 130) bestScore = 0;
         return bestScore;
     }
 
+    float fitcircle(const FitAccumulator &acc, const float fmoRadius, SCircle &circle,
+                    const cv::Vec2f &c1, const cv::Vec2f &c2) {
+        float inlierT = std::max(1.f, 0.1f * fmoRadius);
+        float rms = acc.circle(circle.x, circle.y, circle.radius);
+        if (circle.radius < 2 * fmoRadius) {
+            circle.radius = 0;
+            circle.size = 0;
+            return 0;
+        }
+        float bestScore = float(acc.count()) * std::max(0.f, 1 - rms / inlierT);
+        double sz = setArc(circle, c1, c2);
+        if (sz > 130) bestScore = 0;
+        return bestScore;
+    }
+
 //////////////////////////////// LINE ////////////////////////////////////////////////////////////////////
     float distanceToLineVec(const cv::Vec2f &start, const cv::Vec2f &normal, const cv::Vec2f &point) {
         float tt = (start - point).dot(normal);
         return norm((start - point) - tt*normal);
     }
     
-    float fitline(const std::vector<cv::Point2f>& pixels, const float radius, SLine &line) {
+    float fitline(PointSpan pixels, const float radius, SLine &line) {
         float inlierT = std::max(1.f,0.2f*radius);
-        cv::fitLine(pixels, line.params, CV_DIST_L2, 0, 0.1, 0.1);
+        cv::fitLine(pointMat(pixels), line.params, CV_DIST_L2, 0, 0.1, 0.1);
         line.normal.x = line.params[0];
         line.normal.y = line.params[1];
         line.normal = line.normal / norm(line.normal);
@@ -230,10 +456,26 @@ namespace fmo {
         return score;
     }
 
-    float fitline(const std::vector<cv::Point2f>& pixels, const float radius, SLine &line,
+    namespace {
+        /// Sets the end points of the line to the projections of c1 and c2.
+        void setEnds(SLine &line, const cv::Vec2f &c1, const cv::Vec2f &c2) {
+            float e = distanceToLineVec(line.start,line.normal,c1);
+            line.start = cv::Point2f{c1} + e*line.perp;
+
+            e = distanceToLineVec(line.start,line.normal,c2);
+            line.end = cv::Point2f{c2} + e*line.perp;
+
+            line.length = cv::norm(line.start - line.end);
+            line.startSmooth = line.start;
+            line.endSmooth = line.end;
+            line.center = (line.start + line.end)/2;
+        }
+    }
+
+    float fitline(PointSpan pixels, const float radius, SLine &line,
                     const cv::Vec2f &c1, const cv::Vec2f &c2) {
         float inlierT = std::max(1.f,0.2f*radius);
-        cv::fitLine(pixels, line.params, CV_DIST_L2, 0, 0.1, 0.1);
+        cv::fitLine(pointMat(pixels), line.params, CV_DIST_L2, 0, 0.1, 0.1);
         line.normal.x = line.params[0];
         line.normal.y = line.params[1];
         line.normal = line.normal / norm(line.normal);
@@ -253,22 +495,24 @@ namespace fmo {
                 score += 1 - (e/inlierT);
         }
 
-        float e = distanceToLineVec(line.start,line.normal,c1);
-        line.start = cv::Point2f{c1} + e*line.perp;
-
-        e = distanceToLineVec(line.start,line.normal,c2);
-        line.end = cv::Point2f{c2} + e*line.perp;
+        setEnds(line, c1, c2);
+        return score;
+    }
 
-        line.length = cv::norm(line.start - line.end);
-        line.startSmooth = line.start;
-        line.endSmooth = line.end;
-        line.center = (line.start + line.end)/2;
+    float fitline(const FitAccumulator &acc, const float radius, SLine &line,
+                  const cv::Vec2f &c1, const cv::Vec2f &c2) {
+        float inlierT = std::max(1.f,0.2f*radius);
+        float rms = acc.line(line.start, line.normal);
+        line.perp.x = line.normal.y;
+        line.perp.y = -line.normal.x;
+        line.params = {line.normal.x, line.normal.y, line.start.x, line.start.y};
 
-        return score;
+        setEnds(line, c1, c2);
+        return float(acc.count()) * std::max(0.f, 1 - rms / inlierT);
     }
 
     //////////////////////// Curve ////////////////////////////////////////
-    float fitcurve2(const std::vector<cv::Point2f>& pixels, float fmoRadius, SCurve *&curve,
+    float fitcurve2(PointSpan pixels, float fmoRadius, Curve &curve,
                    SCircle &circle, SLine &line) {
 
         float scoreLine = 1.5f*fmo::fitline(pixels, fmoRadius, line);
@@ -277,55 +521,417 @@ namespace fmo {
         float score;
         if (scoreCircle > scoreLine) {
             score = scoreCircle;
-            curve = &circle;
+            curve = circle;
             if (circle.radius < fmoRadius) {
                 score = 0;
             }
         } else {
             score = scoreLine;
-            curve = &line;
+            curve = line;
         }
 
         return score;
     }
 
-    float fitcurve(const std::vector<cv::Point2f>& pixels, float fmoRadius, SCurve *&curve,
+    float fitcurve(PointSpan pixels, float fmoRadius, Curve &curve,
                    SCircle &circle, SLine &line) {
 
         float score = fmo::fitcircle(pixels, fmoRadius, circle);
 
         if (circle.size > 10) {
-            curve = &circle;
+            curve = circle;
             if (circle.radius < fmoRadius) {
                 score = 0;
             }
         } else {
             score = 1.5f*fmo::fitline(pixels, fmoRadius, line);
-            curve = &line;
+            curve = line;
         }
 
         return score;
     }
 
-    float fitcurve(const std::vector<cv::Point2f>& pixels, float fmoRadius, SCurve *&curve,
+    float fitcurve(PointSpan pixels, float fmoRadius, Curve &curve,
                    SCircle &circle, SLine &line, const cv::Vec2f &c1, const cv::Vec2f &c2) {
 
         float score = fmo::fitcircle(pixels, fmoRadius, circle, c1, c2);
 
         if (circle.size > 10) {
-            curve = &circle;
+            curve = circle;
             if (circle.radius < fmoRadius) {
                 score = 0;
             }
         } else {
             score = 1.5f*fmo::fitline(pixels, fmoRadius, line, c1, c2);
-            curve = &line;
+            curve = line;
         }
 
         return score;
     }
 
 
+    float fitcurve(const FitAccumulator &acc, float fmoRadius, Curve &curve,
+                   SCircle &circle, SLine &line, const cv::Vec2f &c1, const cv::Vec2f &c2) {
+
+        float score = fmo::fitcircle(acc, fmoRadius, circle, c1, c2);
+
+        if (circle.size > 10) {
+            curve = circle;
+            if (circle.radius < fmoRadius) {
+                score = 0;
+            }
+        } else {
+            score = 1.5f*fmo::fitline(acc, fmoRadius, line, c1, c2);
+            curve = line;
+        }
+
+        return score;
+    }
+
+    //////////////////////// Accumulator ////////////////////////////////////
+    void FitAccumulator::add(const cv::Point2f& p) {
+        double x = p.x, y = p.y;
+        double xi = 1;
+        for (int i = 0; i <= 4; i++, xi *= x) {
+            double xiyj = xi;
+            for (int j = 0; i + j <= 4; j++, xiyj *= y) { mMoments[i][j] += xiyj; }
+        }
+    }
+
+    void FitAccumulator::add(PointSpan pixels) {
+        for (auto& p : pixels) { add(p); }
+    }
+
+    FitAccumulator& FitAccumulator::operator+=(const FitAccumulator& other) {
+        for (int i = 0; i <= 4; i++) {
+            for (int j = 0; i + j <= 4; j++) { mMoments[i][j] += other.mMoments[i][j]; }
+        }
+        return *this;
+    }
+
+    double FitAccumulator::central(int i, int j, double a, double b) const {
+        // binomial expansion of sum (x - a)^i (y - b)^j
+        static const double binom[5][5] = {
+            {1, 0, 0, 0, 0}, {1, 1, 0, 0, 0}, {1, 2, 1, 0, 0}, {1, 3, 3, 1, 0}, {1, 4, 6, 4, 1}};
+        double result = 0;
+        double pa = 1;
+        for (int k = i; k >= 0; k--, pa *= -a) {
+            double pb = 1;
+            for (int l = j; l >= 0; l--, pb *= -b) {
+                result += binom[i][k] * binom[j][l] * pa * pb * mMoments[k][l];
+            }
+        }
+        return result;
+    }
+
+    float FitAccumulator::circle(float& cx, float& cy, float& radius) const {
+        double n = count();
+        cx = cy = radius = 0;
+        if (n < 3) return 0;
+
+        // algebraic (Kasa) fit, solved around the centroid for better conditioning
+        double mx = mMoments[1][0] / n;
+        double my = mMoments[0][1] / n;
+        double suu = central(2, 0, mx, my);
+        double suv = central(1, 1, mx, my);
+        double svv = central(0, 2, mx, my);
+        double ru = 0.5 * (central(3, 0, mx, my) + central(1, 2, mx, my));
+        double rv = 0.5 * (central(0, 3, mx, my) + central(2, 1, mx, my));
+        double det = suu * svv - suv * suv;
+        if (std::abs(det) <= 1e-9 * (suu * svv + suv * suv)) return 0;
+        double a = (ru * svv - rv * suv) / det;
+        double b = (rv * suu - ru * suv) / det;
+        double r2 = a * a + b * b + (suu + svv) / n;
+
+        // sum of (d^2 - r^2)^2, where d is the distance from the center
+        double ccx = mx + a;
+        double ccy = my + b;
+        double res = central(4, 0, ccx, ccy) + 2 * central(2, 2, ccx, ccy) +
+                     central(0, 4, ccx, ccy) -
+                     2 * r2 * (central(2, 0, ccx, ccy) + central(0, 2, ccx, ccy)) + n * r2 * r2;
+
+        cx = float(ccx);
+        cy = float(ccy);
+        radius = float(std::sqrt(r2));
+        // near the circle, d^2 - r^2 is approximately 2 r (d - r)
+        return float(std::sqrt(std::max(0., res) / n) / (2 * radius));
+    }
+
+    float FitAccumulator::line(cv::Point2f& point, cv::Point2f& direction) const {
+        double n = count();
+        point = {0, 0};
+        direction = {1, 0};
+        if (n < 2) return 0;
+
+        double mx = mMoments[1][0] / n;
+        double my = mMoments[0][1] / n;
+        double suu = central(2, 0, mx, my);
+        double suv = central(1, 1, mx, my);
+        double svv = central(0, 2, mx, my);
+
+        // principal axis of the covariance matrix, the smaller eigenvalue is the residual
+        double angle = 0.5 * std::atan2(2 * suv, suu - svv);
+        double half = 0.5 * (suu + svv);
+        double dev = std::sqrt(0.25 * (suu - svv) * (suu - svv) + suv * suv);
+        point = {float(mx), float(my)};
+        direction = {float(std::cos(angle)), float(std::sin(angle))};
+        return float(std::sqrt(std::max(0., half - dev) / n));
+    }
+
+    /////////////////////////// IoU //////////////////////////////////
+    namespace {
+        /// Horizontal interval of real x coordinates, including both ends.
+        struct Span {
+            float x0;
+            float x1;
+        };
+
+        /// Restricts a span to the x coordinates for which a * (x - origin) + b lies in the range
+        /// lo to hi. Returns false if nothing remains.
+        bool restrict(Span& span, float origin, float a, float b, float lo, float hi) {
+            if (a == 0) return b >= lo && b <= hi;
+            float t0 = (lo - b) / a, t1 = (hi - b) / a;
+            if (a < 0) std::swap(t0, t1);
+            span.x0 = std::max(span.x0, origin + t0);
+            span.x1 = std::min(span.x1, origin + t1);
+            return span.x0 <= span.x1;
+        }
+
+        /// Area covered by a curve drawn with a given thickness: a capsule around a line segment,
+        /// or an annulus sector with round caps around an arc. The area is provided as spans of
+        /// each row, a pixel is covered if its center lies in the area.
+        struct CurveCoverage {
+            enum : int {
+                MAX_SPANS = 6, ///< the maximum number of spans in a row
+            };
+
+            CurveCoverage(const Curve& curve, float halfWidth)
+                : mHalfWidth(halfWidth), mR2(halfWidth * halfWidth) {
+                const float scale = float(curve.common().scale);
+                if (curve.type() == Curve::Type::LINE) {
+                    const SLine& line = curve.line();
+                    if (std::abs(line.start.x) + std::abs(line.start.y) == 0) return;
+                    mType = Curve::Type::LINE;
+                    mP0 = line.start / scale;
+                    mDir = line.end / scale - mP0;
+                    mLen2 = mDir.dot(mDir);
+                    mE0 = mP0;
+                    mE1 = mP0 + mDir;
+                    setBounds(std::min(mE0.x, mE1.x), std::min(mE0.y, mE1.y),
+                              std::max(mE0.x, mE1.x), std::max(mE0.y, mE1.y));
+                } else if (curve.type() == Curve::Type::CIRCLE) {
+                    const SCircle& circle = curve.circle();
+                    if (circle.radius <= 0) return;
+                    mType = Curve::Type::CIRCLE;
+                    mCenter = cv::Point2f{circle.x, circle.y} / scale;
+                    mRadius = circle.radius / scale;
+
+                    // the arc goes from the smaller angle to the larger one, like in cv::ellipse()
+                    double a0 = std::min(circle.startDegree, circle.endDegree);
+                    double a1 = std::max(circle.startDegree, circle.endDegree);
+                    mFull = a1 - a0 >= 360;
+                    mWide = a1 - a0 > 180;
+                    a0 *= M_PI / 180;
+                    a1 *= M_PI / 180;
+                    mU0 = {float(std::cos(a0)), float(std::sin(a0))};
+                    mU1 = {float(std::cos(a1)), float(std::sin(a1))};
+                    mE0 = mCenter + mRadius * mU0;
+                    mE1 = mCenter + mRadius * mU1;
+                    setBounds(mCenter.x - mRadius, mCenter.y - mRadius, mCenter.x + mRadius,
+                              mCenter.y + mRadius);
+                }
+            }
+
+            /// Tests whether a point lies in the area.
+            bool operator()(float x, float y) const {
+                cv::Point2f p{x, y};
+                if (mType == Curve::Type::LINE) {
+                    cv::Point2f v = p - mP0;
+                    float t = (mLen2 > 0) ? v.dot(mDir) / mLen2 : 0.f;
+                    t = std::min(1.f, std::max(0.f, t));
+                    cv::Point2f d = v - t * mDir;
+                    return d.dot(d) <= mR2;
+                }
+                if (mType == Curve::Type::CIRCLE) {
+                    cv::Point2f v = p - mCenter;
+                    if (inSector(v)) {
+                        float dist = std::sqrt(v.dot(v)) - mRadius;
+                        return dist * dist <= mR2;
+                    }
+                    cv::Point2f d0 = p - mE0, d1 = p - mE1;
+                    return d0.dot(d0) <= mR2 || d1.dot(d1) <= mR2;
+                }
+                return false;
+            }
+
+            /// Finds the parts of a row that lie in the area, limited to the columns x0 to x1. The
+            /// spans may overlap. Returns the number of spans written to out, at most MAX_SPANS.
+            int row(float y, float x0, float x1, Span* out) const {
+                int n = 0;
+                if (mType == Curve::Type::NONE) return n;
+
+                if (mType == Curve::Type::LINE) {
+                    // the slab along the segment: the projection onto the segment lies between
+                    // the end points and the distance from its line is at most the half-width
+                    if (mLen2 > 0) {
+                        const float vy = y - mP0.y;
+                        const float limit = mHalfWidth * std::sqrt(mLen2);
+                        Span s{x0, x1};
+                        if (restrict(s, mP0.x, mDir.x, vy * mDir.y, 0, mLen2) &&
+                            restrict(s, mP0.x, mDir.y, -vy * mDir.x, -limit, limit)) {
+                            out[n++] = s;
+                        }
+                    }
+                } else {
+                    // the annulus, clipped to the sector
+                    Span ring[2], sector[2];
+                    const int numRing = annulus(y, x0, x1, ring);
+                    const int numSector = mFull ? 1 : this->sector(y, x0, x1, sector);
+                    if (mFull) sector[0] = {x0, x1};
+                    for (int i = 0; i < numRing; i++) {
+                        for (int j = 0; j < numSector; j++) {
+                            Span s{std::max(ring[i].x0, sector[j].x0),
+                                   std::min(ring[i].x1, sector[j].x1)};
+                            if (s.x0 <= s.x1) out[n++] = s;
+                        }
+                    }
+                    if (mFull) return n;
+                }
+
+                // the round caps
+                n += disc(mE0, y, x0, x1, out + n);
+                n += disc(mE1, y, x0, x1, out + n);
+                return n;
+            }
+
+            Pos min = {0, 0};   ///< top-left corner of the covered area
+            Pos max = {-1, -1}; ///< bottom-right corner of the covered area
+
+        private:
+            static float cross(const cv::Point2f& a, const cv::Point2f& b) {
+                return a.x * b.y - a.y * b.x;
+            }
+
+            /// Tests whether a vector points in a direction between the start and the end angle.
+            bool inSector(const cv::Point2f& v) const {
+                if (mFull) return true;
+                if (mWide) return !(cross(mU1, v) > 0 && cross(v, mU0) > 0);
+                return cross(mU0, v) >= 0 && cross(v, mU1) >= 0;
+            }
+
+            /// Finds the part of a row inside a disc with the radius of the half-width.
+            int disc(const cv::Point2f& c, float y, float x0, float x1, Span* out) const {
+                const float dy = y - c.y;
+                const float h2 = mR2 - dy * dy;
+                if (h2 < 0) return 0;
+                const float h = std::sqrt(h2);
+                Span s{std::max(x0, c.x - h), std::min(x1, c.x + h)};
+                if (s.x0 > s.x1) return 0;
+                *out = s;
+                return 1;
+            }
+
+            /// Finds the parts of a row between the inner and the outer circle.
+            int annulus(float y, float x0, float x1, Span* out) const {
+                const float dy = y - mCenter.y;
+                const float outer = mRadius + mHalfWidth;
+                const float inner = mRadius - mHalfWidth;
+                const float ho2 = outer * outer - dy * dy;
+                if (ho2 < 0) return 0;
+                const float ho = std::sqrt(ho2);
+                const float hi2 = (inner > 0) ? inner * inner - dy * dy : -1.f;
+                const float hi = (hi2 > 0) ? std::sqrt(hi2) : 0.f;
+
+                int n = 0;
+                Span left{std::max(x0, mCenter.x - ho), std::min(x1, mCenter.x - hi)};
+                Span right{std::max(x0, mCenter.x + hi), std::min(x1, mCenter.x + ho)};
+                if (hi2 <= 0) left.x1 = std::min(x1, mCenter.x + ho);
+                if (left.x0 <= left.x1) out[n++] = left;
+                if (hi2 > 0 && right.x0 <= right.x1) out[n++] = right;
+                return n;
+            }
+
+            /// Finds the parts of a row whose direction from the center lies in the sector.
+            int sector(float y, float x0, float x1, Span* out) const {
+                // the row meets the cone between two directions in a single span
+                const float vy = y - mCenter.y;
+                auto cone = [&](const cv::Point2f& ua, const cv::Point2f& ub, Span& s) {
+                    s = {x0, x1};
+                    return restrict(s, mCenter.x, -ua.y, ua.x * vy, 0, FLT_MAX) &&
+                           restrict(s, mCenter.x, ub.y, -vy * ub.x, 0, FLT_MAX);
+                };
+
+                if (!mWide) return cone(mU0, mU1, out[0]) ? 1 : 0;
+
+                // a wide sector is the complement of the cone from the end to the start
+                Span gap;
+                if (!cone(mU1, mU0, gap)) {
+                    out[0] = {x0, x1};
+                    return 1;
+                }
+                int n = 0;
+                if (gap.x0 > x0) out[n++] = {x0, gap.x0};
+                if (gap.x1 < x1) out[n++] = {gap.x1, x1};
+                return n;
+            }
+
+            void setBounds(float x0, float y0, float x1, float y1) {
+                min = {int(std::floor(x0 - mHalfWidth)), int(std::floor(y0 - mHalfWidth))};
+                max = {int(std::ceil(x1 + mHalfWidth)), int(std::ceil(y1 + mHalfWidth))};
+            }
+
+            Curve::Type mType = Curve::Type::NONE;
+            float mHalfWidth;      ///< half of the thickness
+            float mR2;             ///< squared half-width
+            cv::Point2f mP0, mDir; ///< line segment start and direction
+            float mLen2 = 0;       ///< squared length of the segment
+            cv::Point2f mCenter;   ///< circle center
+            float mRadius = 0;     ///< circle radius
+            cv::Point2f mU0, mU1;  ///< unit vectors towards the ends of the arc
+            cv::Point2f mE0, mE1;  ///< ends of the segment or of the arc
+            bool mFull = false;    ///< the arc is a full circle
+            bool mWide = false;    ///< the arc spans more than a half-circle
+        };
+
+        /// Counts the integer x coordinates that lie in at least one of the spans.
+        int countCovered(Span* spans, int n) {
+            std::sort(spans, spans + n, [](const Span& l, const Span& r) { return l.x0 < r.x0; });
+            int count = 0;
+            int next = INT_MIN; // the first column that has not been counted yet
+            for (int i = 0; i < n; i++) {
+                int first = std::max(next, int(std::ceil(spans[i].x0)));
+                int last = int(std::floor(spans[i].x1));
+                if (last < first) continue;
+                count += last - first + 1;
+                next = last + 1;
+            }
+            return count;
+        }
+    }
+
+    float curveIoU(const Curve& curve, float thickness, PointSpan pixels, const Bounds& box) {
+        CurveCoverage covers{curve, thickness / 2.f};
+
+        int inters = 0;
+        for (auto& pix : pixels) {
+            if (covers(pix.x, pix.y)) inters++;
+        }
+
+        // area of the curve inside the box, one row at a time
+        const int y0 = std::max(box.min.y, covers.min.y);
+        const int y1 = std::min(box.max.y, covers.max.y);
+        const float x0 = float(std::max(box.min.x, covers.min.x));
+        const float x1 = float(std::min(box.max.x, covers.max.x));
+        Span spans[CurveCoverage::MAX_SPANS];
+        int area = 0;
+        for (int y = y0; y <= y1 && x0 <= x1; y++) {
+            area += countCovered(spans, covers.row(float(y), x0, x1, spans));
+        }
+
+        int unio = int(pixels.size()) + area - inters;
+        return (unio > 0) ? float(inters) / float(unio) : 0.f;
+    }
+
     /////////////////////////// Drawing //////////////////////////////////
     // line
 
@@ -343,7 +949,7 @@ namespace fmo {
         }
     }
 
-    float SLine::maxDist(const std::vector<cv::Point2f>& pixels) const {
+    float SLine::maxDist(PointSpan pixels) const {
         float maxDist = 0;
         for (auto &p : pixels) {
             float normalLength = hypot(end.x - start.x, end.y - start.y);
@@ -376,7 +982,7 @@ namespace fmo {
         }
     }
 
-    float SCircle::maxDist(const std::vector<cv::Point2f>& pixels) const {
+    float SCircle::maxDist(PointSpan pixels) const {
         float maxDist = 0;
         cv::Point2f cnt{this->x, this->y};
         for (auto &p : pixels) {
@@ -1,14 +1,46 @@
 #include "image-util.hpp"
 #include "include-simd.hpp"
+#include <fmo/isa.hpp>
 #include <fmo/processing.hpp>
 
 namespace fmo {
-    struct Median3Job : public cv::ParallelLoopBody {
-#if defined(FMO_HAVE_AVX2)
-        using batch_t = __m256i;
+    namespace {
+        using median3_t = void (*)(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                                   uint8_t* dst, size_t iEnd);
+
+        void median3Scalar(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                           uint8_t* dst, size_t iEnd) {
+            for (size_t i = 0; i < iEnd; i++) {
+                uint8_t t = std::max(src1[i], src2[i]);
+                uint8_t s = std::min(src1[i], src2[i]);
+                t = std::min(t, src3[i]);
+                dst[i] = std::max(s, t);
+            }
+        }
+
+#if defined(FMO_HAVE_SSE2)
+        void median3Sse2(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                         uint8_t* dst, size_t iEnd) {
+            using batch_t = __m128i;
+            for (size_t i = 0; i < iEnd; i += sizeof(batch_t)) {
+                batch_t a = _mm_load_si128((const batch_t*)(src1 + i));
+                batch_t b = _mm_load_si128((const batch_t*)(src2 + i));
+                batch_t t = _mm_max_epu8(a, b);
+                b = _mm_min_epu8(a, b);
+                t = _mm_min_epu8(t, _mm_load_si128((const batch_t*)(src3 + i)));
+                t = _mm_max_epu8(b, t);
+                _mm_stream_si128((batch_t*)(dst + i), t);
+            }
+        }
+#endif
 
-        void impl(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3, uint8_t* dst,
-                  size_t iEnd) const {
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+#   if defined(FMO_HAVE_X86_DISPATCH)
+        FMO_TARGET_AVX2
+#   endif
+        void median3Avx2(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                         uint8_t* dst, size_t iEnd) {
+            using batch_t = __m256i;
             for (size_t i = 0; i < iEnd; i += sizeof(batch_t)) {
                 batch_t a = _mm256_load_si256((const batch_t*)(src1 + i));
                 batch_t b = _mm256_load_si256((const batch_t*)(src2 + i));
@@ -19,26 +51,30 @@ namespace fmo {
                 _mm256_stream_si256((batch_t*)(dst + i), t);
             }
         }
-#elif defined(FMO_HAVE_SSE2)
-        using batch_t = __m128i;
+#endif
 
-        void impl(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3, uint8_t* dst,
-                  size_t iEnd) const {
+#if defined(FMO_HAVE_X86_DISPATCH)
+        // image data is only guaranteed to be 32-byte aligned, hence the unaligned access
+        FMO_TARGET_AVX512BW
+        void median3Avx512(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                           uint8_t* dst, size_t iEnd) {
+            using batch_t = __m512i;
             for (size_t i = 0; i < iEnd; i += sizeof(batch_t)) {
-                batch_t a = _mm_load_si128((const batch_t*)(src1 + i));
-                batch_t b = _mm_load_si128((const batch_t*)(src2 + i));
-                batch_t t = _mm_max_epu8(a, b);
-                b = _mm_min_epu8(a, b);
-                t = _mm_min_epu8(t, _mm_load_si128((const batch_t*)(src3 + i)));
-                t = _mm_max_epu8(b, t);
-                _mm_stream_si128((batch_t*)(dst + i), t);
+                batch_t a = _mm512_loadu_si512((const void*)(src1 + i));
+                batch_t b = _mm512_loadu_si512((const void*)(src2 + i));
+                batch_t t = _mm512_max_epu8(a, b);
+                b = _mm512_min_epu8(a, b);
+                t = _mm512_min_epu8(t, _mm512_loadu_si512((const void*)(src3 + i)));
+                t = _mm512_max_epu8(b, t);
+                _mm512_storeu_si512((void*)(dst + i), t);
             }
         }
-#elif defined(FMO_HAVE_NEON)
-        using batch_t = uint8x16_t;
+#endif
 
-        void impl(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3, uint8_t* dst,
-                  size_t iEnd) const {
+#if defined(FMO_HAVE_NEON)
+        void median3Neon(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                         uint8_t* dst, size_t iEnd) {
+            using batch_t = uint8x16_t;
             for (size_t i = 0; i < iEnd; i += sizeof(batch_t)) {
                 batch_t a = vld1q_u8(src1 + i);
                 batch_t b = vld1q_u8(src2 + i);
@@ -49,32 +85,54 @@ namespace fmo {
                 vst1q_u8(dst + i, t);
             }
         }
-#else
-        using batch_t = uint8_t;
+#endif
 
-        void impl(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3, uint8_t* dst,
-                  size_t iEnd) const {
-            for (size_t i = 0; i < iEnd; i++) {
-                uint8_t t = std::max(src1[i], src2[i]);
-                uint8_t s = std::min(src1[i], src2[i]);
-                t = std::min(t, src3[i]);
-                dst[i] = std::max(s, t);
+        /// Picks the kernel variant for the active instruction set.
+        median3_t selectMedian3() {
+            switch (activeIsa()) {
+#if defined(FMO_HAVE_X86_DISPATCH)
+            case Isa::AVX512BW:
+                return median3Avx512;
+#endif
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+            case Isa::AVX2:
+                return median3Avx2;
+#endif
+#if defined(FMO_HAVE_SSE2)
+            case Isa::SSE2:
+                return median3Sse2;
+#endif
+#if defined(FMO_HAVE_NEON)
+            case Isa::NEON:
+                return median3Neon;
+#endif
+            default:
+                return median3Scalar;
             }
         }
-#endif
+    }
+
+    struct Median3Job : public cv::ParallelLoopBody {
+        enum : size_t {
+            BATCH_SIZE = 64, ///< bytes in a piece of work, a multiple of the widest vector
+        };
 
         Median3Job(const Mat& src1, const Mat& src2, const Mat& src3, Mat& dst)
-            : mSrc1(src1.data()), mSrc2(src2.data()), mSrc3(src3.data()), mDst(dst.data()) {}
+            : mSrc1(src1.data()),
+              mSrc2(src2.data()),
+              mSrc3(src3.data()),
+              mDst(dst.data()),
+              mKernel(selectMedian3()) {}
 
         virtual void operator()(const cv::Range& pieces) const override {
-            size_t first = size_t(pieces.start) * sizeof(batch_t);
-            size_t last = size_t(pieces.end) * sizeof(batch_t);
+            size_t first = size_t(pieces.start) * BATCH_SIZE;
+            size_t last = size_t(pieces.end) * BATCH_SIZE;
             const uint8_t* const src1 = mSrc1 + first;
             const uint8_t* const src2 = mSrc2 + first;
             const uint8_t* const src3 = mSrc3 + first;
             uint8_t* const dst = mDst + first;
             const size_t iEnd = last - first;
-            impl(src1, src2, src3, dst, iEnd);
+            mKernel(src1, src2, src3, dst, iEnd);
         }
 
     private:
@@ -82,6 +140,7 @@ namespace fmo {
         const uint8_t* const mSrc2;
         const uint8_t* const mSrc3;
         uint8_t* const mDst;
+        const median3_t mKernel;
     };
 
     void median3(const Image& src1, const Image& src2, const Image& src3, Image& dst) {
@@ -89,7 +148,7 @@ namespace fmo {
         const Dims dims = src1.dims();
         const cv::Size size = getCvSize(format, dims);
         const size_t bytes = size_t(size.width) * size_t(size.height) * getPixelStep(format);
-        const size_t pieces = bytes / sizeof(Median3Job::batch_t);
+        const size_t pieces = bytes / Median3Job::BATCH_SIZE;
 
         if (format != src2.format() || dims != src2.dims() || format != src3.format() ||
             dims != src3.dims()) {
@@ -102,7 +161,7 @@ namespace fmo {
         cv::parallel_for_(cv::Range{0, int(pieces)}, job, cv::getNumThreads());
 
         // process the last few bytes inidividually
-        for (size_t i = pieces * sizeof(Median3Job::batch_t); i < bytes; i++) {
+        for (size_t i = pieces * Median3Job::BATCH_SIZE; i < bytes; i++) {
             uint8_t t = std::max(src1.data()[i], src2.data()[i]);
             uint8_t s = std::min(src1.data()[i], src2.data()[i]);
             t = std::min(t, src3.data()[i]);
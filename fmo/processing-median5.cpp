@@ -1,16 +1,72 @@
 #include "image-util.hpp"
 #include "include-simd.hpp"
+#include <fmo/isa.hpp>
 #include <fmo/processing.hpp>
 #include <iostream>
 
 namespace fmo {
-    struct Median5Job : public cv::ParallelLoopBody {
-#if defined(FMO_HAVE_AVX2)
-        using batch_t = __m256i;
+    namespace {
+        inline uint8_t median5Scalar(uint8_t a1, uint8_t a2, uint8_t a3, uint8_t a4, uint8_t a5) {
+            uint8_t max1 = std::max(a1, a2);
+            uint8_t min1 = std::min(a1, a2);
+            uint8_t max2 = std::max(a3, a4);
+            uint8_t min2 = std::min(a3, a4);
+            min1 = std::max(min1, min2);
+            max1 = std::min(max1, max2);
+
+            min2 = std::max(min1, max1);
+            max2 = std::min(min1, max1);
+            min2 = std::min(min2, a5);
+            return std::max(max2, min2);
+        }
+    }
+
+    namespace {
+        using median5_t = void (*)(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                                   const uint8_t* src4, const uint8_t* src5, uint8_t* dst,
+                                   size_t iEnd);
+
+        void median5Scalar(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                           const uint8_t* src4, const uint8_t* src5, uint8_t* dst, size_t iEnd) {
+            for (size_t i = 0; i < iEnd; i++) {
+                dst[i] = median5Scalar(src1[i], src2[i], src3[i], src4[i], src5[i]);
+            }
+        }
+
+#if defined(FMO_HAVE_SSE2)
+        void median5Sse2(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                         const uint8_t* src4, const uint8_t* src5, uint8_t* dst, size_t iEnd) {
+            using batch_t = __m128i;
+            for (size_t i = 0; i < iEnd; i += sizeof(batch_t)) {
+                batch_t a1 = _mm_load_si128((const batch_t*)(src1 + i));
+                batch_t a2 = _mm_load_si128((const batch_t*)(src2 + i));
+                batch_t a3 = _mm_load_si128((const batch_t*)(src3 + i));
+                batch_t a4 = _mm_load_si128((const batch_t*)(src4 + i));
+                batch_t a5 = _mm_load_si128((const batch_t*)(src5 + i));
+
+                batch_t max1 = _mm_max_epu8(a1, a2);
+                batch_t min1 = _mm_min_epu8(a1, a2);
+                batch_t max2 = _mm_max_epu8(a3, a4);
+                batch_t min2 = _mm_min_epu8(a3, a4);
+                min1 = _mm_max_epu8(min1,min2);
+                max1 = _mm_min_epu8(max1,max2);
+
+                min2 = _mm_max_epu8(min1, max1);
+                max2 = _mm_min_epu8(min1, max1);
+                min2 = _mm_min_epu8(min2, a5);
+                max2 = _mm_max_epu8(max2, min2);
+                _mm_stream_si128((batch_t*)(dst + i), max2);
+            }
+        }
+#endif
 
-        void impl(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3, 
-                  const uint8_t* src4, const uint8_t* src5, uint8_t* dst,
-                  size_t iEnd) const {
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+#   if defined(FMO_HAVE_X86_DISPATCH)
+        FMO_TARGET_AVX2
+#   endif
+        void median5Avx2(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                         const uint8_t* src4, const uint8_t* src5, uint8_t* dst, size_t iEnd) {
+            using batch_t = __m256i;
             for (size_t i = 0; i < iEnd; i += sizeof(batch_t)) {
                 batch_t a1 = _mm256_load_si256((const batch_t*)(src1 + i));
                 batch_t a2 = _mm256_load_si256((const batch_t*)(src2 + i));
@@ -32,39 +88,41 @@ namespace fmo {
                 _mm256_stream_si256((batch_t*)(dst + i), max2);
             }
         }
-#elif defined(FMO_HAVE_SSE2)
-        using batch_t = __m128i;
+#endif
 
-        void impl(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3, 
-                  const uint8_t* src4, const uint8_t* src5, uint8_t* dst,
-                  size_t iEnd) const {
+#if defined(FMO_HAVE_X86_DISPATCH)
+        // image data is only guaranteed to be 32-byte aligned, hence the unaligned access
+        FMO_TARGET_AVX512BW
+        void median5Avx512(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                           const uint8_t* src4, const uint8_t* src5, uint8_t* dst, size_t iEnd) {
+            using batch_t = __m512i;
             for (size_t i = 0; i < iEnd; i += sizeof(batch_t)) {
-                batch_t a1 = _mm_load_si128((const batch_t*)(src1 + i));
-                batch_t a2 = _mm_load_si128((const batch_t*)(src2 + i));
-                batch_t a3 = _mm_load_si128((const batch_t*)(src3 + i));
-                batch_t a4 = _mm_load_si128((const batch_t*)(src4 + i));
-                batch_t a5 = _mm_load_si128((const batch_t*)(src5 + i));
+                batch_t a1 = _mm512_loadu_si512((const void*)(src1 + i));
+                batch_t a2 = _mm512_loadu_si512((const void*)(src2 + i));
+                batch_t a3 = _mm512_loadu_si512((const void*)(src3 + i));
+                batch_t a4 = _mm512_loadu_si512((const void*)(src4 + i));
+                batch_t a5 = _mm512_loadu_si512((const void*)(src5 + i));
 
-                batch_t max1 = _mm_max_epu8(a1, a2);
-                batch_t min1 = _mm_min_epu8(a1, a2);
-                batch_t max2 = _mm_max_epu8(a3, a4);
-                batch_t min2 = _mm_min_epu8(a3, a4);
-                min1 = _mm_max_epu8(min1,min2);
-                max1 = _mm_min_epu8(max1,max2);
+                batch_t max1 = _mm512_max_epu8(a1, a2);
+                batch_t min1 = _mm512_min_epu8(a1, a2);
+                batch_t max2 = _mm512_max_epu8(a3, a4);
+                batch_t min2 = _mm512_min_epu8(a3, a4);
+                min1 = _mm512_max_epu8(min1,min2);
+                max1 = _mm512_min_epu8(max1,max2);
 
-                min2 = _mm_max_epu8(min1, max1);
-                max2 = _mm_min_epu8(min1, max1);
-                min2 = _mm_min_epu8(min2, a5);
-                max2 = _mm_max_epu8(max2, min2);
-                _mm_stream_si128((batch_t*)(dst + i), max2);
+                min2 = _mm512_max_epu8(min1, max1);
+                max2 = _mm512_min_epu8(min1, max1);
+                min2 = _mm512_min_epu8(min2, a5);
+                max2 = _mm512_max_epu8(max2, min2);
+                _mm512_storeu_si512((void*)(dst + i), max2);
             }
         }
-#elif defined(FMO_HAVE_NEON)
-        using batch_t = uint8x16_t;
+#endif
 
-        void impl(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3, 
-                  const uint8_t* src4, const uint8_t* src5, uint8_t* dst,
-                  size_t iEnd) const {
+#if defined(FMO_HAVE_NEON)
+        void median5Neon(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3,
+                         const uint8_t* src4, const uint8_t* src5, uint8_t* dst, size_t iEnd) {
+            using batch_t = uint8x16_t;
             for (size_t i = 0; i < iEnd; i += sizeof(batch_t)) {
                 batch_t a1 = vld1q_u8(src1 + i);
                 batch_t a2 = vld1q_u8(src2 + i);
@@ -86,36 +144,47 @@ namespace fmo {
                 vst1q_u8(dst + i, max2);
             }
         }
-#else
-        using batch_t = uint8_t;
+#endif
 
-        void impl(const uint8_t* src1, const uint8_t* src2, const uint8_t* src3, 
-                  const uint8_t* src4, const uint8_t* src5, uint8_t* dst,
-                  size_t iEnd) const {
-            for (size_t i = 0; i < iEnd; i++) {
-                uint8_t max1 = std::max(src1[i], src2[i]);
-                uint8_t min1 = std::min(src1[i], src2[i]);
-                uint8_t max2 = std::max(src3[i], src4[i]);
-                uint8_t min2 = std::min(src3[i], src4[i]);
-                min1 = std::max(min1,min2);
-                max1 = std::min(max1,max2);
-
-                min2 = std::max(min1, max1);
-                max2 = std::min(min1, max1);
-                min2 = std::min(min2, src5[i]);
-                dst[i] = std::max(max2, min2);
+        /// Picks the kernel variant for the active instruction set.
+        median5_t selectMedian5() {
+            switch (activeIsa()) {
+#if defined(FMO_HAVE_X86_DISPATCH)
+            case Isa::AVX512BW:
+                return median5Avx512;
+#endif
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+            case Isa::AVX2:
+                return median5Avx2;
+#endif
+#if defined(FMO_HAVE_SSE2)
+            case Isa::SSE2:
+                return median5Sse2;
+#endif
+#if defined(FMO_HAVE_NEON)
+            case Isa::NEON:
+                return median5Neon;
+#endif
+            default:
+                return median5Scalar;
             }
         }
-#endif
+    }
+
+    struct Median5Job : public cv::ParallelLoopBody {
+        enum : size_t {
+            BATCH_SIZE = 64, ///< bytes in a piece of work, a multiple of the widest vector
+        };
 
         Median5Job(const Mat& src1, const Mat& src2, const Mat& src3, 
                   const Mat& src4, const Mat& src5, Mat& dst)
             : mSrc1(src1.data()), mSrc2(src2.data()), mSrc3(src3.data()), 
-              mSrc4(src4.data()), mSrc5(src5.data()), mDst(dst.data()) {}
+              mSrc4(src4.data()), mSrc5(src5.data()), mDst(dst.data()),
+              mKernel(selectMedian5()) {}
 
         virtual void operator()(const cv::Range& pieces) const override {
-            size_t first = size_t(pieces.start) * sizeof(batch_t);
-            size_t last = size_t(pieces.end) * sizeof(batch_t);
+            size_t first = size_t(pieces.start) * BATCH_SIZE;
+            size_t last = size_t(pieces.end) * BATCH_SIZE;
             const uint8_t* const src1 = mSrc1 + first;
             const uint8_t* const src2 = mSrc2 + first;
             const uint8_t* const src3 = mSrc3 + first;
@@ -123,7 +192,7 @@ namespace fmo {
             const uint8_t* const src5 = mSrc5 + first;
             uint8_t* const dst = mDst + first;
             const size_t iEnd = last - first;
-            impl(src1, src2, src3, src4, src5, dst, iEnd);
+            mKernel(src1, src2, src3, src4, src5, dst, iEnd);
         }
 
     private:
@@ -133,6 +202,7 @@ namespace fmo {
         const uint8_t* const mSrc4;
         const uint8_t* const mSrc5;
         uint8_t* const mDst;
+        const median5_t mKernel;
     };
 
     void median5(const Image& src1, const Image& src2, const Image& src3, 
@@ -141,7 +211,7 @@ namespace fmo {
         const Dims dims = src1.dims();
         const cv::Size size = getCvSize(format, dims);
         const size_t bytes = size_t(size.width) * size_t(size.height) * getPixelStep(format);
-        const size_t pieces = bytes / sizeof(Median5Job::batch_t);
+        const size_t pieces = bytes / Median5Job::BATCH_SIZE;
 
         if (format != src2.format() || dims != src2.dims() 
          || format != src3.format() || dims != src3.dims()
@@ -156,11 +226,274 @@ namespace fmo {
         cv::parallel_for_(cv::Range{0, int(pieces)}, job, cv::getNumThreads());
 
         // process the last few bytes inidividually
-        for (size_t i = pieces * sizeof(Median5Job::batch_t); i < bytes; i++) {
-            uint8_t t = std::max(src1.data()[i], src2.data()[i]);
-            uint8_t s = std::min(src1.data()[i], src2.data()[i]);
-            t = std::min(t, src3.data()[i]);
-            dst.data()[i] = std::max(s, t);
+        for (size_t i = pieces * Median5Job::BATCH_SIZE; i < bytes; i++) {
+            dst.data()[i] = median5Scalar(src1.data()[i], src2.data()[i], src3.data()[i],
+                                          src4.data()[i], src5.data()[i]);
+        }
+    }
+
+    struct Median5DiffJob : public cv::ParallelLoopBody {
+#if defined(FMO_HAVE_AVX2)
+        using batch_t = __m256i;
+
+        static batch_t load(const uint8_t* src) {
+            return _mm256_loadu_si256((const batch_t*)src);
+        }
+        static void store(uint8_t* dst, batch_t v) { _mm256_storeu_si256((batch_t*)dst, v); }
+        static batch_t broadcast(uint8_t v) { return _mm256_set1_epi8(char(v)); }
+
+        static batch_t median(batch_t a1, batch_t a2, batch_t a3, batch_t a4, batch_t a5) {
+            batch_t max1 = _mm256_max_epu8(a1, a2);
+            batch_t min1 = _mm256_min_epu8(a1, a2);
+            batch_t max2 = _mm256_max_epu8(a3, a4);
+            batch_t min2 = _mm256_min_epu8(a3, a4);
+            min1 = _mm256_max_epu8(min1, min2);
+            max1 = _mm256_min_epu8(max1, max2);
+
+            min2 = _mm256_max_epu8(min1, max1);
+            max2 = _mm256_min_epu8(min1, max1);
+            min2 = _mm256_min_epu8(min2, a5);
+            return _mm256_max_epu8(max2, min2);
+        }
+
+        static batch_t absdiff(batch_t a, batch_t b) {
+            return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
         }
+
+        /// Yields 0xFF where a > thresh, 0x00 elsewhere.
+        static batch_t greater(batch_t a, batch_t thresh) {
+            batch_t zero = _mm256_setzero_si256();
+            batch_t notGreater = _mm256_cmpeq_epi8(_mm256_subs_epu8(a, thresh), zero);
+            return _mm256_xor_si256(notGreater, _mm256_set1_epi8(char(0xFF)));
+        }
+#elif defined(FMO_HAVE_SSE2)
+        using batch_t = __m128i;
+
+        static batch_t load(const uint8_t* src) { return _mm_loadu_si128((const batch_t*)src); }
+        static void store(uint8_t* dst, batch_t v) { _mm_storeu_si128((batch_t*)dst, v); }
+        static batch_t broadcast(uint8_t v) { return _mm_set1_epi8(char(v)); }
+
+        static batch_t median(batch_t a1, batch_t a2, batch_t a3, batch_t a4, batch_t a5) {
+            batch_t max1 = _mm_max_epu8(a1, a2);
+            batch_t min1 = _mm_min_epu8(a1, a2);
+            batch_t max2 = _mm_max_epu8(a3, a4);
+            batch_t min2 = _mm_min_epu8(a3, a4);
+            min1 = _mm_max_epu8(min1, min2);
+            max1 = _mm_min_epu8(max1, max2);
+
+            min2 = _mm_max_epu8(min1, max1);
+            max2 = _mm_min_epu8(min1, max1);
+            min2 = _mm_min_epu8(min2, a5);
+            return _mm_max_epu8(max2, min2);
+        }
+
+        static batch_t absdiff(batch_t a, batch_t b) {
+            return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+        }
+
+        /// Yields 0xFF where a > thresh, 0x00 elsewhere.
+        static batch_t greater(batch_t a, batch_t thresh) {
+            batch_t zero = _mm_setzero_si128();
+            batch_t notGreater = _mm_cmpeq_epi8(_mm_subs_epu8(a, thresh), zero);
+            return _mm_xor_si128(notGreater, _mm_set1_epi8(char(0xFF)));
+        }
+#elif defined(FMO_HAVE_NEON)
+        using batch_t = uint8x16_t;
+
+        static batch_t load(const uint8_t* src) { return vld1q_u8(src); }
+        static void store(uint8_t* dst, batch_t v) { vst1q_u8(dst, v); }
+        static batch_t broadcast(uint8_t v) { return vdupq_n_u8(v); }
+
+        static batch_t median(batch_t a1, batch_t a2, batch_t a3, batch_t a4, batch_t a5) {
+            batch_t max1 = vmaxq_u8(a1, a2);
+            batch_t min1 = vminq_u8(a1, a2);
+            batch_t max2 = vmaxq_u8(a3, a4);
+            batch_t min2 = vminq_u8(a3, a4);
+            min1 = vmaxq_u8(min1, min2);
+            max1 = vminq_u8(max1, max2);
+
+            min2 = vmaxq_u8(min1, max1);
+            max2 = vminq_u8(min1, max1);
+            min2 = vminq_u8(min2, a5);
+            return vmaxq_u8(max2, min2);
+        }
+
+        static batch_t absdiff(batch_t a, batch_t b) { return vabdq_u8(a, b); }
+
+        /// Yields 0xFF where a > thresh, 0x00 elsewhere.
+        static batch_t greater(batch_t a, batch_t thresh) { return vcgtq_u8(a, thresh); }
+#else
+        using batch_t = uint8_t;
+
+        static batch_t load(const uint8_t* src) { return *src; }
+        static void store(uint8_t* dst, batch_t v) { *dst = v; }
+        static batch_t broadcast(uint8_t v) { return v; }
+
+        static batch_t median(batch_t a1, batch_t a2, batch_t a3, batch_t a4, batch_t a5) {
+            return median5Scalar(a1, a2, a3, a4, a5);
+        }
+
+        static batch_t absdiff(batch_t a, batch_t b) { return (a > b) ? (a - b) : (b - a); }
+
+        /// Yields 0xFF where a > thresh, 0x00 elsewhere.
+        static batch_t greater(batch_t a, batch_t thresh) {
+            return (a > thresh) ? uint8_t(0xFF) : uint8_t(0);
+        }
+#endif
+
+        enum : size_t {
+            PIXEL_BATCH_SIZE = sizeof(batch_t),
+        };
+
+        /// Single-channel images: both the median and the difference are computed in registers.
+        void implGray(size_t first, size_t last) const {
+            const batch_t thresh = broadcast(mThresh);
+
+            for (size_t i = first; i < last; i += sizeof(batch_t)) {
+                batch_t a1 = load(mSrc1 + i);
+                batch_t med = median(a1, load(mSrc2 + i), load(mSrc3 + i), load(mSrc4 + i),
+                                     load(mSrc5 + i));
+                if (mMedian != nullptr) store(mMedian + i, med);
+                store(mDst + i, greater(absdiff(a1, med), thresh));
+            }
+        }
+
+#if defined(FMO_HAVE_NEON)
+        /// Three-channel images: channels are de-interleaved upon load, so that the sum of
+        /// absolute differences can be computed in registers.
+        void implColor(size_t first, size_t last) const {
+            const batch_t thresh = broadcast(mThresh);
+
+            for (size_t p = first; p < last; p += PIXEL_BATCH_SIZE) {
+                size_t i = 3 * p;
+                uint8x16x3_t a1 = vld3q_u8(mSrc1 + i);
+                uint8x16x3_t a2 = vld3q_u8(mSrc2 + i);
+                uint8x16x3_t a3 = vld3q_u8(mSrc3 + i);
+                uint8x16x3_t a4 = vld3q_u8(mSrc4 + i);
+                uint8x16x3_t a5 = vld3q_u8(mSrc5 + i);
+                uint8x16x3_t med;
+                batch_t sum = vdupq_n_u8(0);
+
+                for (int c = 0; c < 3; c++) {
+                    med.val[c] = median(a1.val[c], a2.val[c], a3.val[c], a4.val[c], a5.val[c]);
+                    sum = vqaddq_u8(sum, absdiff(a1.val[c], med.val[c]));
+                }
+
+                if (mMedian != nullptr) vst3q_u8(mMedian + i, med);
+                store(mDst + p, greater(sum, thresh));
+            }
+        }
+#else
+        /// Three-channel images: the median and the absolute differences are computed in
+        /// registers; the differences of a single batch of pixels are then summed per pixel from a
+        /// small buffer that never leaves L1.
+        void implColor(size_t first, size_t last) const {
+            alignas(32) uint8_t diff[3 * sizeof(batch_t)];
+            const int thresh = int(mThresh);
+
+            for (size_t p = first; p < last; p += PIXEL_BATCH_SIZE) {
+                for (size_t k = 0; k < 3; k++) {
+                    size_t i = 3 * p + k * sizeof(batch_t);
+                    batch_t a1 = load(mSrc1 + i);
+                    batch_t med = median(a1, load(mSrc2 + i), load(mSrc3 + i),
+                                         load(mSrc4 + i), load(mSrc5 + i));
+                    if (mMedian != nullptr) store(mMedian + i, med);
+                    store(diff + k * sizeof(batch_t), absdiff(a1, med));
+                }
+
+                const uint8_t* d = diff;
+                for (size_t j = 0; j < PIXEL_BATCH_SIZE; j++, d += 3) {
+                    mDst[p + j] = ((d[0] + d[1] + d[2]) > thresh) ? uint8_t(0xFF) : uint8_t(0);
+                }
+            }
+        }
+#endif
+
+        Median5DiffJob(const Mat& src1, const Mat& src2, const Mat& src3, const Mat& src4,
+                       const Mat& src5, Mat* median, Mat& dst, int channels, uint8_t thresh)
+            : mSrc1(src1.data()), mSrc2(src2.data()), mSrc3(src3.data()), mSrc4(src4.data()),
+              mSrc5(src5.data()), mMedian(median != nullptr ? median->data() : nullptr),
+              mDst(dst.data()), mChannels(channels), mThresh(thresh) {}
+
+        virtual void operator()(const cv::Range& pieces) const override {
+            size_t first = size_t(pieces.start) * PIXEL_BATCH_SIZE;
+            size_t last = size_t(pieces.end) * PIXEL_BATCH_SIZE;
+
+            if (mChannels == 1) {
+                implGray(first, last);
+            } else {
+                implColor(first, last);
+            }
+        }
+
+        /// Processes the pixels that do not fill a whole batch.
+        void tail(size_t first, size_t last) const {
+            const int thresh = int(mThresh);
+
+            for (size_t p = first; p < last; p++) {
+                int sum = 0;
+                for (int c = 0; c < mChannels; c++) {
+                    size_t i = p * size_t(mChannels) + size_t(c);
+                    uint8_t med = median5Scalar(mSrc1[i], mSrc2[i], mSrc3[i], mSrc4[i], mSrc5[i]);
+                    if (mMedian != nullptr) mMedian[i] = med;
+                    sum += std::abs(int(mSrc1[i]) - int(med));
+                }
+                mDst[p] = (sum > thresh) ? uint8_t(0xFF) : uint8_t(0);
+            }
+        }
+
+    private:
+        const uint8_t* const mSrc1;
+        const uint8_t* const mSrc2;
+        const uint8_t* const mSrc3;
+        const uint8_t* const mSrc4;
+        const uint8_t* const mSrc5;
+        uint8_t* const mMedian;
+        uint8_t* const mDst;
+        const int mChannels;
+        const uint8_t mThresh;
+    };
+
+    namespace {
+        void median5DiffImpl(const Image& src1, const Image& src2, const Image& src3,
+                             const Image& src4, const Image& src5, Image* median, Image& dst,
+                             uint8_t thresh) {
+            const Format format = src1.format();
+            const Dims dims = src1.dims();
+
+            if (format != src2.format() || dims != src2.dims() 
+             || format != src3.format() || dims != src3.dims()
+             || format != src4.format() || dims != src4.dims()
+             || format != src5.format() || dims != src5.dims()) {
+                throw std::runtime_error("median5_diff: format/dimensions mismatch of inputs");
+            }
+
+            if (format != Format::GRAY && format != Format::BGR && format != Format::YUV) {
+                throw std::runtime_error("median5_diff: unsupported format");
+            }
+
+            const int channels = int(getPixelStep(format));
+            const size_t pixels = size_t(dims.width) * size_t(dims.height);
+            const size_t pieces = pixels / Median5DiffJob::PIXEL_BATCH_SIZE;
+
+            // run the job in parallel
+            if (median != nullptr) median->resize(format, dims);
+            dst.resize(Format::GRAY, dims);
+            Median5DiffJob job{src1, src2, src3, src4, src5, median, dst, channels, thresh};
+            cv::parallel_for_(cv::Range{0, int(pieces)}, job, cv::getNumThreads());
+
+            // process the last few pixels individually
+            job.tail(pieces * Median5DiffJob::PIXEL_BATCH_SIZE, pixels);
+        }
+    }
+
+    void median5_diff(const Image& src1, const Image& src2, const Image& src3, const Image& src4,
+                      const Image& src5, Image& median, Image& dst, uint8_t thresh) {
+        median5DiffImpl(src1, src2, src3, src4, src5, &median, dst, thresh);
+    }
+
+    void median5_diff(const Image& src1, const Image& src2, const Image& src3, const Image& src4,
+                      const Image& src5, Image& dst, uint8_t thresh) {
+        median5DiffImpl(src1, src2, src3, src4, src5, nullptr, dst, thresh);
     }
 }
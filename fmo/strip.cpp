@@ -1,173 +1,316 @@
 #include "include-opencv.hpp"
+#include "include-simd.hpp"
 #include <algorithm>
 #include <cstdint>
-#include <fmo/assert.hpp>
+#include <cstring>
 #include <fmo/common.hpp>
+#include <fmo/isa.hpp>
 #include <fmo/strip.hpp>
-#include <mutex>
 #include <vector>
 
 namespace fmo {
-    struct StripGenImpl : public cv::ParallelLoopBody {
-        using batch_t = uint64_t;
-        using rle_t = int16_t;
+    namespace {
+        using mask_t = uint64_t;
 
-        enum {
-            WIDTH = sizeof(batch_t),
+        /// Scans a batch of columns from top to bottom. For each row, a mask of the columns that
+        /// have changed with respect to the row above is stored into masks. The row above the
+        /// first row is considered to be black.
+        using scan_t = void (*)(const uint8_t* data, int skip, int height, mask_t* masks);
+
+        enum : int {
+            NARROW_WIDTH = 8, ///< columns scanned by scanNarrow()
+            MAX_WIDTH = 64,   ///< columns scanned by the widest kernel
         };
 
+        void scanNarrow(const uint8_t* data, int skip, int height, mask_t* masks) {
+            uint64_t prev = 0;
+            for (int row = 0; row < height; row++, data += skip) {
+                uint64_t cur;
+                std::memcpy(&cur, data, sizeof(cur));
+                mask_t mask = 0;
+                if (cur != prev) {
+                    uint64_t diff = cur ^ prev;
+                    for (int w = 0; w < NARROW_WIDTH; w++) {
+                        if (((const uint8_t*)(&diff))[w] != 0) { mask |= mask_t(1) << w; }
+                    }
+                }
+                masks[row] = mask;
+                prev = cur;
+            }
+        }
+
+#if defined(FMO_HAVE_SSE2)
+        void scanSse2(const uint8_t* data, int skip, int height, mask_t* masks) {
+            __m128i prev = _mm_setzero_si128();
+            for (int row = 0; row < height; row++, data += skip) {
+                __m128i cur = _mm_loadu_si128((const __m128i*)data);
+                masks[row] = mask_t(_mm_movemask_epi8(_mm_cmpeq_epi8(cur, prev)) ^ 0xFFFF);
+                prev = cur;
+            }
+        }
+#endif
+
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+#   if defined(FMO_HAVE_X86_DISPATCH)
+        FMO_TARGET_AVX2
+#   endif
+        void scanAvx2(const uint8_t* data, int skip, int height, mask_t* masks) {
+            __m256i prev = _mm256_setzero_si256();
+            for (int row = 0; row < height; row++, data += skip) {
+                __m256i cur = _mm256_loadu_si256((const __m256i*)data);
+                uint32_t same = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, prev)));
+                masks[row] = mask_t(~same);
+                prev = cur;
+            }
+        }
+#endif
+
+#if defined(FMO_HAVE_X86_DISPATCH)
+        FMO_TARGET_AVX512BW
+        void scanAvx512(const uint8_t* data, int skip, int height, mask_t* masks) {
+            __m512i prev = _mm512_setzero_si512();
+            for (int row = 0; row < height; row++, data += skip) {
+                __m512i cur = _mm512_loadu_si512((const void*)data);
+                masks[row] = mask_t(_mm512_cmpneq_epu8_mask(cur, prev));
+                prev = cur;
+            }
+        }
+#endif
+
+        /// Scans 64 columns of a BINARY image, i.e. a single word per row.
+        void scanBinary(const uint8_t* data, int skip, int height, mask_t* masks) {
+            uint64_t prev = 0;
+            for (int row = 0; row < height; row++, data += skip) {
+                uint64_t cur;
+                std::memcpy(&cur, data, sizeof(cur));
+                masks[row] = mask_t(cur ^ prev);
+                prev = cur;
+            }
+        }
+
+        /// Picks the widest kernel for the active instruction set and provides its width.
+        scan_t selectScan(int& width) {
+            switch (activeIsa()) {
+#if defined(FMO_HAVE_X86_DISPATCH)
+            case Isa::AVX512BW:
+                width = 64;
+                return scanAvx512;
+#endif
+#if defined(FMO_HAVE_X86_DISPATCH) || defined(FMO_HAVE_AVX2)
+            case Isa::AVX2:
+                width = 32;
+                return scanAvx2;
+#endif
+#if defined(FMO_HAVE_SSE2)
+            case Isa::SSE2:
+                width = 16;
+                return scanSse2;
+#endif
+            default:
+                width = NARROW_WIDTH;
+                return scanNarrow;
+            }
+        }
+
+        /// Provides the index of the lowest set bit. The mask must not be zero.
+        inline int lowestBit(mask_t mask) {
+#if defined(__GNUC__)
+            return __builtin_ctzll(mask);
+#else
+            int result = 0;
+            while ((mask & 1) == 0) {
+                mask >>= 1;
+                result++;
+            }
+            return result;
+#endif
+        }
+    }
+
+    struct StripGenImpl : public cv::ParallelLoopBody {
+        using rle_t = int16_t;
+
         StripGenImpl(const fmo::Mat& img, int minHeight, int minGap, int step,
-                     std::vector<rle_t>& rle, std::vector<Strip>& temp, std::vector<Strip>& out,
-                     int& noiseOut, int numThreads)
+                     std::vector<rle_t>& rle, std::vector<mask_t>& masks,
+                     std::vector<std::vector<Strip>>& segments, std::vector<int>& noise,
+                     int numThreads)
             : mDims(img.dims()),
               mRleStep(mDims.height + 4),
-              mRleSz(mRleStep * WIDTH),
-              mTempSz((mRleSz + 1) / 2),
-              mSkip(int(img.skip()) / WIDTH),
+              mRleSz(mRleStep * MAX_WIDTH),
+              mSkip(int(img.skip())),
               mStep(step),
               mMinHeight(minHeight),
               mMinGap(minGap),
-              mData((const batch_t*)(img.data())),
+              mData(img.data()),
               mRle(&rle),
-              mTemp(&temp),
-              mOut(&out),
-              mNoiseOut(&noiseOut),
+              mMasks(&masks),
+              mSegments(&segments),
+              mNoise(&noise),
               mNumThreads(numThreads) {
-            FMO_ASSERT(int(img.skip()) % WIDTH == 0, "StripGen::operator(): bad skip");
+            if (img.format() == Format::BINARY) {
+                // all columns of a word are scanned at once, the padding is masked out
+                mUnit = MAX_WIDTH;
+                mNumUnits = (mDims.width + MAX_WIDTH - 1) / MAX_WIDTH;
+                mColShift = 3;
+                mWidth = MAX_WIDTH;
+                mScan = scanBinary;
+                mScanUnit = scanBinary;
+            } else {
+                mUnit = NARROW_WIDTH;
+                mNumUnits = mDims.width / NARROW_WIDTH;
+                mColShift = 0;
+                mScan = selectScan(mWidth);
+                mScanUnit = scanNarrow;
+            }
             mRle->resize(mRleSz * mNumThreads);
-            mTemp->resize(mTempSz * mNumThreads);
-            mOut->clear();
-            *mNoiseOut = 0;
+            mMasks->resize(size_t(mDims.height) * size_t(mNumThreads));
+            mSegments->resize(mNumThreads);
+            mNoise->assign(mNumThreads, 0);
         }
 
         virtual void operator()(const cv::Range& r) const override {
-            const int threadNum = r.start;
+            for (int threadNum = r.start; threadNum < r.end; threadNum++) { process(threadNum); }
+        }
+
+    private:
+        /// Finds strips in a contiguous range of columns, storing them into the segment of the
+        /// output that belongs to the range. The strips are sorted by x, then by y. Columns are
+        /// scanned in batches as wide as the widest kernel allows; the remaining columns are
+        /// scanned in narrow batches. In a BINARY image, the last unit may be narrower than the
+        /// others.
+        void process(int threadNum) const {
+            std::vector<Strip>& segment = (*mSegments)[threadNum];
+            const int unitFirst = (threadNum * mNumUnits) / mNumThreads;
+            const int unitLast = ((threadNum + 1) * mNumUnits) / mNumThreads;
+            const int colLast = std::min(unitLast * mUnit, mDims.width);
+            segment.clear();
+            int noise = 0;
+
+            for (int col = unitFirst * mUnit; col < colLast;) {
+                bool wide = (colLast - col) >= mWidth;
+                int width = wide ? mWidth : std::min(int(mUnit), colLast - col);
+                scan_t scan = wide ? mScan : mScanUnit;
+                processBatch(threadNum, col, width, scan, segment, noise);
+                col += width;
+            }
+
+            (*mNoise)[threadNum] = noise;
+        }
+
+        /// Finds strips in a batch of columns, starting at the column col.
+        void processBatch(int threadNum, int col, int width, scan_t scan,
+                          std::vector<Strip>& segment, int& noise) const {
             rle_t* const rle = mRle->data() + (mRleSz * threadNum);
-            Strip* const temp = mTemp->data() + (mTempSz * threadNum);
+            mask_t* const masks = mMasks->data() + (size_t(mDims.height) * size_t(threadNum));
             const int16_t step = int16_t(mStep);
             const int16_t halfStep = int16_t(mStep / 2);
             const int pad = std::max(0, std::max(mMinHeight, mMinGap));
-            const int numBatches = mDims.width / WIDTH;
-            const int batchFirst = (threadNum * numBatches) / mNumThreads;
-            const int batchLast = ((threadNum + 1) * numBatches) / mNumThreads;
-            const int colFirst = batchFirst * WIDTH;
-            const int colLast = batchLast * WIDTH;
-            const int skip = mSkip;
             const int minHeight = mMinHeight;
             const Dims dims = mDims;
             const int minGap = mMinGap;
-            Strip* tempEnd = temp;
-
-            int16_t origX = int16_t(halfStep + (colFirst * step));
-            int noise = 0;
-            rle_t* front[WIDTH];
-            const batch_t* colData = mData + batchFirst;
 
-            for (int w = 0; w < WIDTH; w++) { front[w] = rle + (w * mRleStep); }
+            int16_t origX = int16_t(halfStep + (col * step));
+            rle_t* front[MAX_WIDTH];
+            rle_t* back[MAX_WIDTH];
+            int n[MAX_WIDTH];
 
-            for (int col = colFirst; col < colLast; col += WIDTH, colData++) {
-                const batch_t* data = colData;
-                rle_t* back[WIDTH];
-                int n[WIDTH];
+            for (int w = 0; w < width; w++) {
+                front[w] = rle + (w * mRleStep);
+                back[w] = front[w];
 
-                for (int w = 0; w < WIDTH; w++) {
-                    back[w] = front[w];
+                // add top of image
+                *back[w] = rle_t(-pad);
+                n[w] = 1;
+            }
 
-                    // add top of image
-                    *back[w] = rle_t(-pad);
-                    n[w] = 1;
-                }
+            scan(mData + (col >> mColShift), mSkip, dims.height, masks);
+            if (width < mUnit) {
+                // the last word of a BINARY image continues past the right edge of the image
+                const mask_t valid = (mask_t(1) << width) - 1;
+                for (int row = 0; row < dims.height; row++) { masks[row] &= valid; }
+            }
 
-                // must start with a black segment
-                if (*data != 0) {
-                    for (int w = 0; w < WIDTH; w++) {
-                        if (((const uint8_t*)(data))[w] != 0) {
-                            *++(back[w]) = rle_t(0);
-                            n[w]++;
-                        }
-                    }
-                }
-                data += skip;
-
-                // store indices of changes
-                for (int row = 1; row < dims.height; row++, data += skip) {
-                    const batch_t* prev = data - skip;
-                    if (*data != *prev) {
-                        for (int w = 0; w < WIDTH; w++) {
-                            if (((const uint8_t*)(data))[w] != ((const uint8_t*)(prev))[w]) {
-                                if ((row - *(back[w])) < minHeight) {
-                                    // remove noise
-                                    back[w]--;
-                                    n[w]--;
-                                    noise++;
-                                } else {
-                                    *++(back[w]) = rle_t(row);
-                                    n[w]++;
-                                }
-                            }
-                        }
-                    }
-                }
+            // must start with a black segment
+            for (mask_t mask = masks[0]; mask != 0; mask &= mask - 1) {
+                int w = lowestBit(mask);
+                *++(back[w]) = rle_t(0);
+                n[w]++;
+            }
 
-                for (int w = 0; w < WIDTH; w++, origX += int16_t(step)) {
-                    // must end with a black segment
-                    if ((n[w] & 1) == 0) {
-                        *++(back[w]) = rle_t(dims.height);
+            // store indices of changes
+            for (int row = 1; row < dims.height; row++) {
+                for (mask_t mask = masks[row]; mask != 0; mask &= mask - 1) {
+                    int w = lowestBit(mask);
+                    if ((row - *(back[w])) < minHeight) {
+                        // remove noise
+                        back[w]--;
+                        n[w]--;
+                        noise++;
+                    } else {
+                        *++(back[w]) = rle_t(row);
                         n[w]++;
                     }
+                }
+            }
 
-                    // add bottom of image
-                    *++(back[w]) = rle_t(dims.height + pad);
+            for (int w = 0; w < width; w++, origX += int16_t(step)) {
+                // must end with a black segment
+                if ((n[w] & 1) == 0) {
+                    *++(back[w]) = rle_t(dims.height);
                     n[w]++;
-
-                    // report white segments as strips if all conditions are met
-                    rle_t* lastWhite = back[w] - 1;
-                    for (rle_t* i = front[w]; i < lastWhite; i += 2) {
-                        if (*(i + 1) - *(i + 0) >= minGap && *(i + 3) - *(i + 2) >= minGap) {
-                            int halfHeight = (*(i + 2) - *(i + 1)) * halfStep;
-                            int origY = (*(i + 2) + *(i + 1)) * halfStep;
-                            tempEnd->pos = {int16_t(origX), int16_t(origY)};
-                            tempEnd->halfDims = {int16_t(halfStep), int16_t(halfHeight)};
-                            tempEnd++;
-                        }
-                    }
                 }
 
-                // move data outside
-                {
-                    std::lock_guard<std::mutex> lock(mMutex);
+                // add bottom of image
+                *++(back[w]) = rle_t(dims.height + pad);
+                n[w]++;
 
-                    mOut->insert(mOut->end(), temp, tempEnd);
-                    tempEnd = temp;
-
-                    *mNoiseOut += noise;
-                    noise = 0;
+                // report white segments as strips if all conditions are met
+                rle_t* lastWhite = back[w] - 1;
+                for (rle_t* i = front[w]; i < lastWhite; i += 2) {
+                    if (*(i + 1) - *(i + 0) >= minGap && *(i + 3) - *(i + 2) >= minGap) {
+                        int halfHeight = (*(i + 2) - *(i + 1)) * halfStep;
+                        int origY = (*(i + 2) + *(i + 1)) * halfStep;
+                        segment.emplace_back(Pos16{int16_t(origX), int16_t(origY)},
+                                             Dims16{int16_t(halfStep), int16_t(halfHeight)});
+                    }
                 }
             }
         }
 
-    private:
         const Dims mDims;
         const int mRleStep;
         const int mRleSz;
-        const int mTempSz;
         const int mSkip;
         const int mStep;
         const int mMinHeight;
         const int mMinGap;
-        const batch_t* const mData;
+        const uint8_t* const mData;
         std::vector<rle_t>* const mRle;
-        std::vector<Strip>* const mTemp;
-        std::vector<Strip>* const mOut;
-        int* const mNoiseOut;
+        std::vector<mask_t>* const mMasks;
+        std::vector<std::vector<Strip>>* const mSegments;
+        std::vector<int>* const mNoise;
         const int mNumThreads;
-        mutable std::mutex mMutex;
+        int mUnit;        ///< columns are divided between threads in units of this many columns
+        int mNumUnits;    ///< the number of units in the image
+        int mColShift;    ///< converts a column to a byte offset in a row
+        int mWidth;       ///< number of columns scanned by mScan
+        scan_t mScan;     ///< the widest kernel available
+        scan_t mScanUnit; ///< the kernel that scans a single unit
     };
 
     void StripGen::operator()(const fmo::Mat& img, int minHeight, int minGap, int step,
                               std::vector<Strip>& out, int& outNoise) {
         int numThreads = cv::getNumThreads();
-        StripGenImpl job{img, minHeight, minGap, step, mRle, mTemp, out, outNoise, numThreads};
+        StripGenImpl job{img, minHeight, minGap, step, mRle, mMasks, mSegments, mNoise,
+                         numThreads};
         cv::parallel_for_(cv::Range{0, numThreads}, job);
+
+        // concatenate the segments in the order of columns
+        out.clear();
+        outNoise = 0;
+        for (int i = 0; i < numThreads; i++) {
+            out.insert(out.end(), mSegments[i].begin(), mSegments[i].end());
+            outNoise += mNoise[i];
+        }
     }
 }
@@ -1,6 +1,8 @@
 #include "image-util.hpp"
 #include <fmo/subsampler.hpp>
+#include <cmath>
 #include <fmo/processing.hpp>
+#include <stdexcept>
 
 namespace fmo {
     void Subsampler::operator()(const Mat& src, Mat& dst) {
@@ -32,6 +34,43 @@ namespace fmo {
         cv::merge(cvDst, 3, dst.wrap());
     }
 
+    void Subsampler::resize(const Mat& src, Mat& dst, float scale) {
+        if (src.format() != Format::YUV420SP) {
+            subsample_resize(src, dst, scale);
+            return;
+        }
+
+        // prepare output buffers
+        Dims srcDims = src.dims();
+        Dims dstDims = {int(std::round(srcDims.width * scale)),
+                        int(std::round(srcDims.height * scale))};
+
+        if (dstDims.width == 0 || dstDims.height == 0) {
+            throw std::runtime_error("Subsampler: source is too small");
+        }
+
+        cv::Size cvSrcSize{srcDims.width, srcDims.height};
+        cv::Size cvSrcUVSize{srcDims.width / 2, srcDims.height / 2};
+        cv::Size cvDstSize{dstDims.width, dstDims.height};
+        dst.resize(Format::YUV, dstDims);
+        y.resize(Format::GRAY, dstDims);
+        uv.resize(Format::GRAY, {2 * dstDims.width, dstDims.height});
+        cv::Mat cvY = y.wrap();
+        cv::Mat cvUV{cvDstSize, CV_8UC2, uv.data()};
+
+        // resize the full-resolution Y plane and the half-resolution UV plane to the same size
+        cv::Mat cvSrcY{cvSrcSize, CV_8UC1, const_cast<uint8_t*>(src.data())};
+        cv::resize(cvSrcY, cvY, cvDstSize, 0, 0, cv::INTER_LINEAR);
+        cv::Mat cvSrcUV{cvSrcUVSize, CV_8UC2, const_cast<uint8_t*>(src.uvData())};
+        cv::resize(cvSrcUV, cvUV, cvDstSize, 0, 0, cv::INTER_LINEAR);
+
+        // interleave the planes
+        cv::Mat cvDst = dst.wrap();
+        cv::Mat planes[2] = {cvY, cvUV};
+        const int fromTo[6] = {0, 0, 1, 1, 2, 2};
+        cv::mixChannels(planes, 2, &cvDst, 1, fromTo, 3);
+    }
+
     Dims Subsampler::nextDims(Dims dims) {
         dims.width /= 2;
         dims.height /= 2;
@@ -1,10 +1,52 @@
 #include "algorithm-taxonomy.hpp"
 #include "../include-opencv.hpp"
 #include <fmo/processing.hpp>
+#include <fmo/region.hpp>
 #include <iostream>
 #include <fmo/assert.hpp>
 
 namespace fmo {
+    namespace {
+        /// Creates a mask of the pixels to process, with the specified processing dimensions.
+        /// Provides an empty image if all pixels are to be processed.
+        Image makeRoiMask(const Algorithm::Config& cfg, Dims dims, Dims newDims) {
+            Image mask;
+            if (!cfg.haveRoi()) return mask;
+
+            mask.resize(Format::GRAY, newDims);
+            cv::Mat cvMask = mask.wrap();
+            if (cfg.roi.empty()) {
+                cvMask.setTo(0xFF);
+            } else {
+                cvMask.setTo(0);
+                const float sx = float(newDims.width) / dims.width;
+                const float sy = float(newDims.height) / dims.height;
+                for (auto& b : cfg.roi) {
+                    int x0 = std::max(0, int(std::floor(b.min.x * sx)));
+                    int y0 = std::max(0, int(std::floor(b.min.y * sy)));
+                    int x1 = std::min(newDims.width, int(std::ceil((b.max.x + 1) * sx)));
+                    int y1 = std::min(newDims.height, int(std::ceil((b.max.y + 1) * sy)));
+                    if (x1 <= x0 || y1 <= y0) continue;
+                    cvMask(cv::Rect{x0, y0, x1 - x0, y1 - y0}).setTo(0xFF);
+                }
+            }
+
+            if (cfg.roiMask.size() != 0) {
+                if (cfg.roiMask.format() != Format::GRAY) {
+                    throw std::runtime_error("TaxonomyV1: roiMask must be GRAY");
+                }
+                cv::Mat scaled;
+                cv::resize(cfg.roiMask.wrap(), scaled, {newDims.width, newDims.height}, 0, 0,
+                           cv::INTER_NEAREST);
+                const uint8_t* src = scaled.data;
+                for (auto& value : mask) {
+                    if (*src++ == 0) value = 0;
+                }
+            }
+            return mask;
+        }
+    }
+
     void registerTaxonomyV1() {
         Algorithm::registerFactory(
             "taxonomy-v1", [](const Algorithm::Config& config, Format format, Dims dims) {
@@ -13,7 +55,8 @@ namespace fmo {
     }
 
     TaxonomyV1::TaxonomyV1(const Config& cfg, Format format, Dims dims)
-        : mCfg(cfg), mSourceLevel{{format, dims}, 0}, mDiff(cfg.diff) {
+        : mCfg(cfg), mSourceLevel{{format, dims}, 0}, mBackground(cfg.backgroundWindow),
+          mDiff(cfg.diff) {
             auto& level = mProcessingLevel;
             int w = std::round(dims.width * ((float)mCfg.imageHeight / dims.height));
             level.dims = {dims};
@@ -24,13 +67,12 @@ namespace fmo {
             level.diffAcc.resize(Format::GRAY, level.newDims);
             level.diffAcc.wrap().setTo(0);
 
-            level.diff.resize(Format::BGR, level.newDims);
+            // the difference has the format of the processed images
+            Format processingFormat = mSubsampler.nextFormat(format);
+            if (cfg.grayOnly) processingFormat = Format::GRAY;
+            level.diff.resize(processingFormat, level.newDims);
             level.diff.wrap().setTo(0);
 
-            level.background.resize(Format::BGR, level.newDims);
-            level.background.wrap().setTo(0);
-
-            level.labels.resize(Format::INT32, level.newDims);
             level.distTran.resize(Format::FLOAT, level.newDims);
             level.localMaxima.resize(Format::GRAY, level.newDims);
 
@@ -43,6 +85,8 @@ namespace fmo {
             mCache.ones.resize(Format::GRAY, level.newDims);
             mCache.ones.wrap().setTo(1);
 
+            mTiles.setMask(makeRoiMask(cfg, dims, level.newDims));
+
     }
 
     void TaxonomyV1::setInputSwap(Image& in) {
@@ -66,13 +110,22 @@ namespace fmo {
 
         // resize an image to exact height
         mProcessingLevel.scale = (float) mCfg.imageHeight / in.dims().height; 
-        subsample_resize(mSourceLevel.image, mCache.image, mProcessingLevel.scale);
+        Image& src = mSourceLevel.image;
+        if (mCfg.grayOnly && src.format() == Format::YUV420SP) {
+            // the luma plane is a GRAY image on its own
+            Region luma{Format::GRAY, {0, 0}, src.dims(), src.data(), nullptr,
+                        size_t(src.dims().width)};
+            subsample_resize(luma, mCache.image, mProcessingLevel.scale);
+        } else {
+            mSubsampler.resize(src, mCache.image, mProcessingLevel.scale);
+            if (mCfg.grayOnly && mCache.image.format() != Format::GRAY) {
+                convert(mCache.image, mCache.gray, Format::GRAY);
+                mCache.image.swap(mCache.gray);
+            }
+        }
 
-        // swap the product of decimation into the processing level
-        mProcessingLevel.inputs[3].swap(mProcessingLevel.inputs[2]);
-        mProcessingLevel.inputs[2].swap(mProcessingLevel.inputs[1]);
-        mProcessingLevel.inputs[1].swap(mProcessingLevel.inputs[0]);
-        mProcessingLevel.inputs[0].swap(mCache.image);
+        // swap the product of decimation into the background model
+        mBackground.swapInput(mCache.image);
 
     }
 
@@ -84,12 +137,12 @@ namespace fmo {
             return;
         }
 
-        fmo::median5(level.inputs[0], level.inputs[1], level.inputs[2], 
-            level.inputs[3], level.background, level.background);
-
 //        level.diff.wrap() = abs(level.inputs[0].wrap() - level.background.wrap());
 //        cv::transform(level.diff.wrap(), level.diffAcc.wrap(), cv::Matx13f(1,1,1));
         level.binDiffPrev.swap(level.binDiff);
-        mDiff(level.inputs[0], level.background, level.binDiff);
+
+        // threshold the difference against the background (updating it, if needed)
+        mDiff(mBackground, level.binDiff);
+        mTiles(level.binDiff);
     }
 }
@@ -4,9 +4,14 @@
 #include <fmo/agglomerator.hpp>
 #include <fmo/algebra.hpp>
 #include <fmo/algorithm.hpp>
+#include <fmo/arena.hpp>
+#include <fmo/background.hpp>
+#include <fmo/distance.hpp>
+#include <fmo/labeling.hpp>
 #include <fmo/subsampler.hpp>
 #include <fmo/stats.hpp>
 #include <fmo/strip.hpp>
+#include <fmo/tiles.hpp>
 #include <fmo/processing.hpp>
 #include "../include-opencv.hpp"
 
@@ -63,7 +68,10 @@ namespace fmo {
                 FMO_NOT_CONFIRMED,
             };
 
-            Component() : status(NOT_PROCESSED) {}
+            /// Creates a component whose arrays are stored in the provided arena.
+            Component(Arena& arena)
+                : status(NOT_PROCESSED), pixels(arena), traj(arena), trajFinal(arena),
+                  otherLM(arena), dist(arena) {}
 
             int id = 0;
             int area = 0;
@@ -71,23 +79,26 @@ namespace fmo {
             float iou = 0.f;
             Status status; ///< describes the reason why a component was discarded.
             float radius = 0;
-            std::vector<cv::Point2f> pixels;  
-            std::vector<cv::Point2f> traj;
-            std::vector<cv::Point2f> trajFinal;
-            std::vector<cv::Point2f> otherLM;
-            std::vector<float> dist;
-            SCurve * curve = nullptr;
-            SCurve * curveSmooth = nullptr;
+            ArenaVector<cv::Point2f> pixels;
+            ArenaVector<cv::Point2f> traj;
+            ArenaVector<cv::Point2f> trajFinal;
+            ArenaVector<cv::Point2f> otherLM;
+            ArenaVector<float> dist;
+            Curve curve;
+            Curve curveSmooth;
             SCircle circle;
             SLine line;
+            FitAccumulator fit; ///< statistics of trajFinal for re-fitting
             float maxDist = 0.f;
 
             cv::Vec2d center = {0, 0};
             cv::Point2f start = {0, 0};
             Dims size = {0, 0};
         public:
-            virtual const void draw(cv::Mat& img) const { if(curve != nullptr) curve->draw(img); }
-            virtual const void drawSmooth(cv::Mat& img) const { if(curve != nullptr) curve->drawSmooth(img); }
+            virtual const void draw(cv::Mat& img) const { curve.draw(img); }
+            virtual const void drawSmooth(cv::Mat& img) const { curve.drawSmooth(img); }
+            /// Calculates the IoU of the pixels and the fitted curve drawn with the thickness of
+            /// the object. The coverage is evaluated analytically, without rasterization.
             void calcIoU();
         };
 
@@ -98,8 +109,8 @@ namespace fmo {
             float length = 0;            ///< length in principal direction
             float radius = 0;
             float velocity = 0;             ///< in radii per exposure
-            SCurve * curve = nullptr;
-            SCurve * curveSmooth = nullptr;
+            Curve curve;
+            Curve curveSmooth;
         };
 
         struct MyDetection : public Detection {
@@ -119,16 +130,25 @@ namespace fmo {
         /// subsampled image.
         void swapAndSubsampleInput(Image& in);
 
-        /// Calculates the per-pixel median of the last three frames to obtain the background.
-        /// Creates a binary difference image of background vs. the latest image.
+        /// Creates a binary difference image of the background vs. the latest image. Finds the
+        /// regions of the difference image that contain foreground.
         void computeBinDiff();
 
-        /// Find connected components
+        /// Find connected components, visiting only the regions that contain foreground
         void findComponents();
 
         /// Process components 
         void processComponents();
 
+        /// Estimates the radius of a component, fits a curve and checks that the component looks
+        /// like a fast-moving object. Safe to call for different components in parallel.
+        void processComponent(Component& comp, std::vector<float>& dists);
+
+        /// Looks for a matching component in the previous frame and outputs an object if found.
+        void matchComponent(Component& comp);
+
+        struct ComponentJob;
+
         /// Tests whether a triplet of objects from consecutive frames should be considered as a
         /// detection of a fast-moving object.
         bool selectable(Object& o0, Object& o1, Object& o2) const;
@@ -146,19 +166,13 @@ namespace fmo {
         } mSourceLevel;
 
         struct {
-            Image inputs[4];       ///< input images subsampled to processing resolution, 0 - newest
-            Image background;      ///< median of the last three inputs
             Image diff;
             Image binDiff;         ///< binary difference image, latest image vs. background
             Image diffAcc;
             Image binDiffPrev;
-            Image labels;          ///< label image with connected components
             Image distTran;
             Image localMaxima;
-            cv::Mat stats;
-            cv::Mat centroids;
             int objectCounter = 0; ///< used to generate unique identifiers for detections
-            int objectsNow = 0;
             float scale = 0;
             Dims dims;
             Dims newDims;
@@ -166,6 +180,7 @@ namespace fmo {
 
         struct {
             Image image;                ///< cached decimation step
+            Image gray;                 ///< cached conversion to luminance
             Image visualized;           ///< debug visualization
             Image visualizedFull;       ///< debug visualization full size
             Image pointsRaster;         ///< for rasterization when generating pixel coords
@@ -177,7 +192,15 @@ namespace fmo {
             Image binDiffInv;
         } mCache;
 
+        Subsampler mSubsampler;             ///< for resizing the input to the processing size
+        BackgroundModel mBackground;        ///< subsampled inputs and the background
         Differentiator mDiff;               ///< for creating the binary difference image
+        DistanceTransform mDistTran;        ///< for the distance transform and its local maxima
+        ComponentLabeler mLabeler;          ///< connected components of the binary difference image
+        TileMap mTiles;                     ///< regions of the binary difference image to process
+        Arena mArenas[2];                   ///< per-frame storage for component arrays
+        Arena* mArena = &mArenas[0];        ///< storage for mComponents
+        Arena* mPrevArena = &mArenas[1];    ///< storage for mPrevComponents
         std::vector<Component> mComponents; ///< connected components
         std::vector<Component> mPrevComponents; ///< connected components
         std::vector<Object> mObjects;       ///< objects
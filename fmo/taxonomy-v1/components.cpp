@@ -1,63 +1,69 @@
 #include "algorithm-taxonomy.hpp"
 #include "../image-util.hpp"
 #include <fmo/region.hpp>
-#include <fmo/assert.hpp>
 #include <numeric>
 #include <opencv/cv.hpp>
 
 namespace fmo {
     void TaxonomyV1::findComponents() {
-        // calculate final distance tranform
-        distance_transform(mProcessingLevel.binDiff, mProcessingLevel.distTran);
+        auto& level = mProcessingLevel;
+        const auto& regions = mTiles.regions();
 
-        // local maxima calculation
-        local_maxima(mProcessingLevel.distTran, mProcessingLevel.localMaxima);
-        mProcessingLevel.objectsNow = cv::connectedComponentsWithStats(
-                          mProcessingLevel.binDiff.wrap(),
-                          mProcessingLevel.labels.wrap(),
-                          mProcessingLevel.stats,
-                          mProcessingLevel.centroids, 8);
+        // distance transform and its local maxima, visiting only the occupied tiles
+        mDistTran(level.binDiff, regions, level.distTran, level.localMaxima);
 
+        // connected components of each region, as lists of runs
+        mLabeler(level.binDiff, regions);
     }
 
     void TaxonomyV1::Component::calcIoU() {
-        auto thickness = roundf(2.f * this->radius);
-        Image temp;
-        temp.resize(Format::GRAY, this->size);
-
-        cv::Mat buf = temp.wrap();
-        buf.setTo(uint8_t(0));
-        
-        this->curve->shift = {this->start.x,this->start.y};
-        this->curve->draw(buf, 1, thickness);
-        this->curve->shift = {0,0};
-
-        int inters = 0;
-
-        for(auto &pix : this->pixels) {
-            if (buf.at<int8_t>(pix-start) > 0)
-                inters++;
-        }
+        Bounds box{{int(this->start.x), int(this->start.y)},
+                   {int(this->start.x) + this->size.width - 1,
+                    int(this->start.y) + this->size.height - 1}};
+        this->iou = curveIoU(this->curve, roundf(2.f * this->radius), this->pixels, box);
+    }
 
-        int unio = this->pixels.size() + cv::countNonZero(buf) - inters;
-        this->iou = (float)inters / (float)unio;
+    namespace {
+        /// When set, data needed only for visualization are not collected.
+        const bool realTime = true;
     }
 
-    void TaxonomyV1::processComponents() {
-        bool realTime = true;
+    /// Processes components independently of each other, in several threads. Every thread keeps
+    /// its own scratch space.
+    struct TaxonomyV1::ComponentJob : public cv::ParallelLoopBody {
+        ComponentJob(TaxonomyV1& aMe) : me(aMe) {}
+
+        virtual void operator()(const cv::Range& pieces) const override {
+            thread_local std::vector<float> dists;
+            for (int i = pieces.start; i < pieces.end; i++) {
+                auto& comp = me.mComponents[i];
+                if (comp.status != Component::NOT_PROCESSED) continue;
+                me.processComponent(comp, dists);
+            }
+        }
+
+    private:
+        TaxonomyV1& me;
+    };
 
+    void TaxonomyV1::processComponents() {
     	mObjects.clear();
         mPrevComponents.swap(mComponents);
     	mComponents.clear();
+
+        // components from two frames ago are gone, their storage can be reused
+        std::swap(mArena, mPrevArena);
+        mArena->reset();
     	float w = mProcessingLevel.newDims.width, h = mProcessingLevel.newDims.height;
         float area = w*h;
 
+        const auto& labeled = mLabeler.components();
         int32_t diffArea = 0;
-    	for (int i = 0; i < int(mProcessingLevel.objectsNow-1); ++i) {
-    		mComponents.emplace_back(Component());
+    	for (int i = 0; i < int(labeled.size()); ++i) {
+    		mComponents.emplace_back(*mArena);
             auto& comp = mComponents[i];
             comp.id = i+1;
-            comp.area = mProcessingLevel.stats.at<int>(comp.id,cv::CC_STAT_AREA);
+            comp.area = labeled[i].area;
             if(realTime) diffArea += comp.area;
     		if(comp.area < 10)
                 comp.status = Component::TOO_SMALL;
@@ -72,150 +78,173 @@ namespace fmo {
             return;
         }
 
-        cv::Mat labels = mProcessingLevel.labels.wrap();
+        // visit only the pixels of each component, in the order of rows
         cv::Mat dt = mProcessingLevel.distTran.wrap();
         cv::Mat lm = mProcessingLevel.localMaxima.wrap();
-    	int32_t* p;
-    	float* p2;
-    	uint8_t* p3;
-    	for(int row = 0; row < h; ++row) {
-	        p = labels.ptr<int32_t>(row);
-	        p2 = dt.ptr<float>(row);
-	        p3 = lm.ptr<uint8_t>(row);
-	        for (int column = 0; column < w; ++column) {
-                if(p2[column] < 1.5) continue;
-	        	int ind = p[column];	
-	    		if(ind > 0 && mComponents[ind-1].status == Component::NOT_PROCESSED) {
-                    mComponents[ind-1].pixels.emplace_back(column,row);
-	    			if(p3[column] == 255) {
-	    				mComponents[ind-1].dist.emplace_back(p2[column]);
-	    				mComponents[ind-1].traj.emplace_back(column,row);
-	    			}
-	    		}
-	        }
-	    }
-
-        std::vector<float> dists;
-    	for(auto& comp : mComponents) {
+        const auto& runs = mLabeler.runs();
+        for (int i = 0; i < int(labeled.size()); ++i) {
+            auto& comp = mComponents[i];
+            if (comp.status != Component::NOT_PROCESSED) continue;
+            auto first = runs.begin() + labeled[i].firstRun;
+            for (auto run = first; run != first + labeled[i].numRuns; ++run) {
+                const float* p2 = dt.ptr<float>(run->y);
+                const uint8_t* p3 = lm.ptr<uint8_t>(run->y);
+                for (int column = run->x0; column < run->x1; ++column) {
+                    if(p2[column] < 1.5) continue;
+                    comp.pixels.emplace_back(column,run->y);
+                    if(p3[column] == 255) {
+                        comp.dist.emplace_back(p2[column]);
+                        comp.traj.emplace_back(column,run->y);
+                    }
+                }
+            }
+        }
+
+        // arrays of the components must not grow in the parallel stage, because the arena is
+        // not thread-safe
+        for (auto& comp : mComponents) {
 			if(comp.dist.size() == 0) comp.status = Component::TOO_SMALL;
+			if(comp.status != Component::NOT_PROCESSED) continue;
+            comp.trajFinal.reserve(comp.dist.size());
+            if(!realTime) comp.otherLM.reserve(comp.dist.size());
+        }
 
-			if(comp.status != Component::NOT_PROCESSED) continue; // just to make sure
+        // the cost varies a lot between components, so each one is a separate piece
+        ComponentJob job{*this};
+        cv::parallel_for_(cv::Range{0, int(mComponents.size())}, job, double(mComponents.size()));
 
-			// get radius
-            dists = comp.dist;
-	    	int n = round(2*dists.size()/3);
-	    	std::nth_element(dists.begin(), dists.begin()+n, dists.end());
-	    	comp.radius = dists[n] + 0.5;
-            if(comp.radius < 4) {
-                comp.status = Component::TOO_SMALL;
-                continue;
-            }
+        // matching with previous detections is sequential, so that the output is deterministic
+        for (auto& comp : mComponents) {
+            if(comp.status != Component::FMO_NOT_CONFIRMED) continue;
+            matchComponent(comp);
+        }
+    }
 
-			// get all stats about this component
-    		comp.start.x = mProcessingLevel.stats.at<int>(comp.id,cv::CC_STAT_LEFT);
-    		comp.start.y = mProcessingLevel.stats.at<int>(comp.id,cv::CC_STAT_TOP);
-			comp.size.width = mProcessingLevel.stats.at<int>(comp.id,cv::CC_STAT_WIDTH);
-    		comp.size.height = mProcessingLevel.stats.at<int>(comp.id,cv::CC_STAT_HEIGHT);
-		 	comp.center[0] = mProcessingLevel.centroids.at<double>(comp.id,0);
-		 	comp.center[1] = mProcessingLevel.centroids.at<double>(comp.id,1);
-
-			// get local maxima pixels on trajectory
-    		for (int i = 0; i < int(comp.dist.size()); ++i) {
-                float th = 0.7*comp.radius-1;
-                if(comp.dist[i] > th) {
-    				comp.trajFinal.push_back(comp.traj[i]);
-    			} else if(!realTime) {
-                    comp.otherLM.push_back(comp.traj[i]);
-				}
-    		}
-
-            int np = comp.trajFinal.size();
-			// minimal number of points needed for fitting
-    		if(np <= 3) {
-    			comp.status = Component::TOO_SMALL;
-    			continue;
-    		}
-
-            /// fit curve
-            float score = fmo::fitcurve(comp.trajFinal, comp.radius, comp.curve, comp.circle, comp.line);
-
-			comp.len = comp.curve->length;
-			if(score == 0) { // score threshold
-                comp.status = Component::NOT_STROKE;
-                continue;
-            }
+    void TaxonomyV1::processComponent(Component& comp, std::vector<float>& dists) {
+        // get radius
+        dists.assign(comp.dist.begin(), comp.dist.end());
+        int n = round(2*dists.size()/3);
+        std::nth_element(dists.begin(), dists.begin()+n, dists.end());
+        comp.radius = dists[n] + 0.5;
+        if(comp.radius < 4) {
+            comp.status = Component::TOO_SMALL;
+            return;
+        }
 
-            /// check FMO model (IoU with CC)
-            comp.calcIoU();
-			if(comp.iou < 0.6) {
-				comp.status = Component::NOT_STROKE;
-				continue;
-			}
-            comp.maxDist = comp.curve->maxDist(comp.trajFinal);
-
-    		///////////////////////////////////////////////////////////
-
-    		float count = 0;
-            cv::Mat mat = mProcessingLevel.binDiffPrev.wrap();
-            int edgePixels = 0;
-    		for(auto& pix : comp.pixels) {
-                if (pix.x == 0 || pix.y == 0 || pix.x == (w-1) || pix.y == (h-1)) edgePixels++;
-    			if (mat.at<uchar>(pix.y,pix.x)) count ++;
+        // get all stats about this component
+        const auto& stats = mLabeler.components()[comp.id-1];
+        comp.start.x = stats.bounds.min.x;
+        comp.start.y = stats.bounds.min.y;
+        comp.size.width = stats.bounds.max.x - stats.bounds.min.x + 1;
+        comp.size.height = stats.bounds.max.y - stats.bounds.min.y + 1;
+        comp.center[0] = stats.centerX;
+        comp.center[1] = stats.centerY;
+
+        // get local maxima pixels on trajectory
+        for (int i = 0; i < int(comp.dist.size()); ++i) {
+            float th = 0.7*comp.radius-1;
+            if(comp.dist[i] > th) {
+                comp.trajFinal.push_back(comp.traj[i]);
+            } else if(!realTime) {
+                comp.otherLM.push_back(comp.traj[i]);
             }
+        }
 
-    		if(count/comp.area > 0.4 || edgePixels > 2*comp.radius){
-    			comp.status = Component::LATERAL;
-    			continue;
-    		}
-            
-
-            comp.status = Component::FMO_NOT_CONFIRMED;
-
-            ///////////////// Check with previous detections  /////////////////////////////////////////
-            float maxScore = 0;
-            float maxAllowedExp = 3;
-            int ind = -1;
-            for (unsigned int jj = 0; jj < mPrevComponents.size(); ++jj) {
-                auto& compOld = mPrevComponents[jj];
-                if(compOld.status != Component::FMO && compOld.status != Component::FMO_NOT_CONFIRMED)
-                    continue;
-                float d = cv::norm(comp.center - compOld.center);
-                if(d > maxAllowedExp*comp.len) continue;
-                compOld.trajFinal.insert(compOld.trajFinal.end(), comp.trajFinal.begin(), comp.trajFinal.end());
-
-                float s = fmo::fitcurve(compOld.trajFinal, comp.radius, compOld.curve,
-                                        compOld.circle, compOld.line, compOld.center, comp.center);
-                if(compOld.curve->length > maxAllowedExp*comp.len) s = 0;
-                if(compOld.curve->length < comp.len) s = 0;
-                if(s > maxScore) {
-                    ind = jj;
-                    maxScore = s;
-                }
-            }
+        int np = comp.trajFinal.size();
+        // minimal number of points needed for fitting
+        if(np <= 3) {
+            comp.status = Component::TOO_SMALL;
+            return;
+        }
+
+        /// fit curve
+        comp.fit = FitAccumulator(comp.trajFinal);
+        float score = fmo::fitcurve(comp.trajFinal, comp.radius, comp.curve, comp.circle, comp.line);
+
+        comp.len = comp.curve.length();
+        if(score == 0) { // score threshold
+            comp.status = Component::NOT_STROKE;
+            return;
+        }
+
+        /// check FMO model (IoU with CC)
+        comp.calcIoU();
+        if(comp.iou < 0.6) {
+            comp.status = Component::NOT_STROKE;
+            return;
+        }
+        comp.maxDist = comp.curve.maxDist(comp.trajFinal);
 
-            if (maxScore == 0) continue;
-            comp.curveSmooth = mPrevComponents[ind].curve->clone();
+        ///////////////////////////////////////////////////////////
 
-            float maxDist = mPrevComponents[ind].curve->maxDist(mPrevComponents[ind].trajFinal);
-            if(maxDist > comp.radius) {
+        float count = 0;
+        cv::Mat mat = mProcessingLevel.binDiffPrev.wrap();
+        float w = mProcessingLevel.newDims.width, h = mProcessingLevel.newDims.height;
+        int edgePixels = 0;
+        for(auto& pix : comp.pixels) {
+            if (pix.x == 0 || pix.y == 0 || pix.x == (w-1) || pix.y == (h-1)) edgePixels++;
+            if (mat.at<uchar>(pix.y,pix.x)) count ++;
+        }
+
+        if(count/comp.area > 0.4 || edgePixels > 2*comp.radius){
+            comp.status = Component::LATERAL;
+            return;
+        }
+
+        comp.status = Component::FMO_NOT_CONFIRMED;
+    }
+
+    void TaxonomyV1::matchComponent(Component& comp) {
+        ///////////////// Check with previous detections  /////////////////////////////////////////
+        float maxScore = 0;
+        float maxAllowedExp = 3;
+        int ind = -1;
+        Curve bestCurve;
+        SCircle circle;
+        SLine line;
+        for (unsigned int jj = 0; jj < mPrevComponents.size(); ++jj) {
+            auto& compOld = mPrevComponents[jj];
+            if(compOld.status != Component::FMO && compOld.status != Component::FMO_NOT_CONFIRMED)
                 continue;
+            float d = cv::norm(comp.center - compOld.center);
+            if(d > maxAllowedExp*comp.len) continue;
+
+            // re-fit the union of both trajectories from the accumulated statistics
+            Curve curve;
+            float s = fmo::fitcurve(compOld.fit + comp.fit, comp.radius, curve,
+                                    circle, line, compOld.center, comp.center);
+            if(curve.length() > maxAllowedExp*comp.len) s = 0;
+            if(curve.length() < comp.len) s = 0;
+            if(s > maxScore) {
+                ind = jj;
+                maxScore = s;
+                bestCurve = curve;
             }
+        }
+
+        if (maxScore == 0) return;
+        comp.curveSmooth = bestCurve;
+
+        float maxDist = std::max(bestCurve.maxDist(mPrevComponents[ind].trajFinal),
+                                 bestCurve.maxDist(comp.trajFinal));
+        if(maxDist > comp.radius) {
+            return;
+        }
 
-            comp.len = comp.curveSmooth->length;
-            ///////////////////////////////////////////////////////////////
-            comp.status = Component::FMO;
+        comp.len = comp.curveSmooth.length();
+        ///////////////////////////////////////////////////////////////
+        comp.status = Component::FMO;
 
-            Object o;
+        Object o;
     		o.center = Pos{(int)(comp.center[0]/mProcessingLevel.scale),
     					   (int)(comp.center[1]/mProcessingLevel.scale)};
     		o.direction = NormVector{comp.line.normal.x,comp.line.normal.y};
     		o.length = comp.len/mProcessingLevel.scale; 
     		o.radius = comp.radius/mProcessingLevel.scale;
-            o.curve = comp.curve;
-            o.curveSmooth = comp.curveSmooth;
-            o.velocity = comp.len / (o.radius+1.5); // in radii per exposure
+        o.curve = comp.curve;
+        o.curveSmooth = comp.curveSmooth;
+        o.velocity = comp.len / (o.radius+1.5); // in radii per exposure
 
-            mObjects.push_back(o);
-    	}
+        mObjects.push_back(o);
     }
 }
@@ -30,11 +30,11 @@ namespace fmo {
             detObj.length = 4.f * o.length;
 
             if(smoothTrajecotry) {
-                detObj.curve = o.curveSmooth->clone();
+                detObj.curve = o.curveSmooth;
             } else {
-                detObj.curve = o.curve->clone();
+                detObj.curve = o.curve;
             }
-            detObj.curve->scale = mProcessingLevel.scale;
+            detObj.curve.common().scale = mProcessingLevel.scale;
 
             detObj.scale = mProcessingLevel.scale;
             detObj.radius = o.radius;
@@ -64,9 +64,9 @@ namespace fmo {
         cv::Mat buf = temp.wrap();
         buf.setTo(uint8_t(0x00));
         
-        object.curve->shift = {(float)b.min.x,(float)b.min.y};
-        object.curve->draw(buf, 0xFF, thickness);
-        object.curve->shift = {0,0};
+        Curve curve = object.curve;
+        curve.common().shift = {(float)b.min.x,(float)b.min.y};
+        curve.draw(buf, 0xFF, thickness);
 
         // output non-zero points
         out.clear();
@@ -34,12 +34,13 @@ namespace fmo {
         cv::Mat cvDTBGR = mCache.distTranBGR.wrap();
         cv::Mat cvDT = mProcessingLevel.distTran.wrap();
         if (showIm) {
-            fmo::copy(mProcessingLevel.inputs[0], mCache.visualized);
+            fmo::copy(mBackground.frame(0), mCache.visualized, Format::BGR);
         } else {
             cvVis.setTo(0);
         }
 
         if (add == 1) {
+            cv::Mat im = showIm ? cvVis.clone() : cv::Mat{};
             std::vector<cv::Mat> channels;
             channels.push_back(mProcessingLevel.binDiff.wrap());
             channels.push_back(mProcessingLevel.binDiff.wrap());
@@ -47,10 +48,10 @@ namespace fmo {
             cv::merge(channels, cvVis);
             if (showIm) {
                 cvVis = cvVis / 255;
-                cvVis = cvVis.mul(mProcessingLevel.inputs[0].wrap());
+                cvVis = cvVis.mul(im);
             }
         } else if (add == 2) {
-            fmo::copy(mProcessingLevel.diff, mCache.visualized);
+            fmo::copy(mProcessingLevel.diff, mCache.visualized, Format::BGR);
         } else if (add == 3) {
             double min, max;
             cv::minMaxLoc(cvDT, &min, &max);
@@ -105,12 +106,12 @@ namespace fmo {
                 color = &colorGreen; 
             }
 
-            comp.curve->scale = mProcessingLevel.scale;
+            comp.curve.common().scale = mProcessingLevel.scale;
             if(!cont) {
                 comp.draw(cvVisFull);
-                if(comp.curveSmooth != nullptr) {
-                    comp.curveSmooth->scale = mProcessingLevel.scale;
-                    comp.curveSmooth->drawSmooth(cvVisFull, objColor, 1);
+                if(!comp.curveSmooth.empty()) {
+                    comp.curveSmooth.common().scale = mProcessingLevel.scale;
+                    comp.curveSmooth.drawSmooth(cvVisFull, objColor, 1);
                 }
             }
 
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cstring>
+#include <fmo/common.hpp>
+#include <fmo/processing.hpp>
+#include <fmo/tiles.hpp>
+#include <stdexcept>
+
+namespace fmo {
+    namespace {
+        /// Tests whether any of the bytes is non-zero.
+        bool anyNonZero(const uint8_t* data, int len) {
+            uint64_t acc = 0;
+            int i = 0;
+            for (; i + 8 <= len; i += 8) {
+                uint64_t word;
+                std::memcpy(&word, data + i, 8);
+                acc |= word;
+            }
+            for (; i < len; i++) { acc |= data[i]; }
+            return acc != 0;
+        }
+
+        /// Tests whether two rectangles overlap or are adjacent, including diagonally.
+        bool touch(const Bounds& l, const Bounds& r) {
+            return l.min.x <= r.max.x + 1 && r.min.x <= l.max.x + 1 && l.min.y <= r.max.y + 1 &&
+                   r.min.y <= l.max.y + 1;
+        }
+    }
+
+    void TileMap::setMask(const Mat& mask) {
+        const Dims dims = mask.dims();
+        if (dims.width == 0 || dims.height == 0) {
+            mMask = Image{};
+            mCoverage.clear();
+            return;
+        }
+        if (mask.format() != Format::GRAY) { throw std::runtime_error("TileMap: mask must be GRAY"); }
+
+        copy(mask, mMask);
+        const Dims grid = {(dims.width + TILE_SIZE - 1) / TILE_SIZE,
+                           (dims.height + TILE_SIZE - 1) / TILE_SIZE};
+
+        // count the pixels inside the mask in each tile
+        std::vector<int> counts(size_t(grid.width * grid.height), 0);
+        const uint8_t* data = mMask.data();
+        for (int y = 0; y < dims.height; y++) {
+            int* tiles = counts.data() + (y / TILE_SIZE) * grid.width;
+            for (int x = 0; x < dims.width; x++, data++) {
+                if (*data != 0) tiles[x / TILE_SIZE]++;
+            }
+        }
+
+        mCoverage.resize(counts.size());
+        for (int row = 0; row < grid.height; row++) {
+            for (int col = 0; col < grid.width; col++) {
+                int w = std::min(int(TILE_SIZE), dims.width - col * TILE_SIZE);
+                int h = std::min(int(TILE_SIZE), dims.height - row * TILE_SIZE);
+                int count = counts[row * grid.width + col];
+                mCoverage[row * grid.width + col] =
+                    (count == 0) ? EXCLUDED : (count == w * h) ? INCLUDED : PARTIAL;
+            }
+        }
+    }
+
+    void TileMap::applyMask(Mat& binary, int col, int row) const {
+        const int x = col * TILE_SIZE;
+        const int y = row * TILE_SIZE;
+        const int w = std::min(int(TILE_SIZE), mDims.width - x);
+        const int h = std::min(int(TILE_SIZE), mDims.height - y);
+        const size_t skip = binary.skip();
+        uint8_t* data = binary.data() + y * skip + x;
+        const uint8_t* mask = mMask.data() + y * mDims.width + x;
+
+        for (int i = 0; i < h; i++, data += skip, mask += mDims.width) {
+            for (int j = 0; j < w; j++) {
+                if (mask[j] == 0) data[j] = 0;
+            }
+        }
+    }
+
+    void TileMap::operator()(Mat& binary) {
+        if (binary.format() != Format::GRAY) {
+            throw std::runtime_error("TileMap: input must be GRAY");
+        }
+
+        mDims = binary.dims();
+        mGrid = {(mDims.width + TILE_SIZE - 1) / TILE_SIZE,
+                 (mDims.height + TILE_SIZE - 1) / TILE_SIZE};
+        mOccupied.assign(size_t(mGrid.width * mGrid.height), 0);
+
+        const bool masked = !mCoverage.empty();
+        if (masked) {
+            if (mMask.dims() != mDims) {
+                throw std::runtime_error("TileMap: mask dimensions do not match");
+            }
+
+            // clear the pixels outside the mask in partially covered tiles; tiles outside the
+            // mask are marked as occupied for now so that they are skipped below
+            for (int row = 0; row < mGrid.height; row++) {
+                for (int col = 0; col < mGrid.width; col++) {
+                    uint8_t coverage = mCoverage[row * mGrid.width + col];
+                    if (coverage == PARTIAL) applyMask(binary, col, row);
+                    if (coverage == EXCLUDED) mOccupied[row * mGrid.width + col] = 1;
+                }
+            }
+        }
+
+        // mark the occupied tiles, skipping the tiles already known to be occupied
+        const size_t skip = binary.skip();
+        const uint8_t* data = binary.data();
+        for (int y = 0; y < mDims.height; y++, data += skip) {
+            uint8_t* tiles = mOccupied.data() + (y / TILE_SIZE) * mGrid.width;
+            for (int col = 0; col < mGrid.width; col++) {
+                if (tiles[col]) continue;
+                int x = col * TILE_SIZE;
+                tiles[col] = anyNonZero(data + x, std::min(int(TILE_SIZE), mDims.width - x));
+            }
+        }
+
+        if (masked) {
+            for (size_t i = 0; i < mOccupied.size(); i++) {
+                if (mCoverage[i] == EXCLUDED) mOccupied[i] = 0;
+            }
+        }
+
+        // start with horizontal runs of occupied tiles
+        mRects.clear();
+        for (int row = 0; row < mGrid.height; row++) {
+            for (int col = 0; col < mGrid.width; col++) {
+                if (!occupied(col, row)) continue;
+                int first = col;
+                while (col + 1 < mGrid.width && occupied(col + 1, row)) { col++; }
+                mRects.push_back({{first, row}, {col, row}});
+            }
+        }
+
+        // merge rectangles that touch until all of them are separated by unoccupied tiles
+        for (bool merged = true; merged;) {
+            merged = false;
+            for (size_t i = 0; i < mRects.size(); i++) {
+                for (size_t j = i + 1; j < mRects.size();) {
+                    if (touch(mRects[i], mRects[j])) {
+                        Bounds& l = mRects[i];
+                        const Bounds& r = mRects[j];
+                        l.min.x = std::min(l.min.x, r.min.x);
+                        l.min.y = std::min(l.min.y, r.min.y);
+                        l.max.x = std::max(l.max.x, r.max.x);
+                        l.max.y = std::max(l.max.y, r.max.y);
+                        mRects[j] = mRects.back();
+                        mRects.pop_back();
+                        merged = true;
+                    } else {
+                        j++;
+                    }
+                }
+            }
+        }
+
+        // regions may contain tiles outside the mask that have not been cleared yet
+        if (masked) {
+            for (auto& rect : mRects) {
+                for (int row = rect.min.y; row <= rect.max.y; row++) {
+                    for (int col = rect.min.x; col <= rect.max.x; col++) {
+                        if (mCoverage[row * mGrid.width + col] == EXCLUDED) {
+                            applyMask(binary, col, row);
+                        }
+                    }
+                }
+            }
+        }
+
+        // convert to pixel coordinates
+        mRegions.clear();
+        for (auto& rect : mRects) {
+            Pos min = {rect.min.x * TILE_SIZE, rect.min.y * TILE_SIZE};
+            Pos max = {std::min((rect.max.x + 1) * TILE_SIZE, mDims.width) - 1,
+                       std::min((rect.max.y + 1) * TILE_SIZE, mDims.height) - 1};
+            mRegions.push_back({min, max});
+        }
+    }
+}
@@ -8,15 +8,20 @@ namespace fmo {
     template <typename DistanceFunc, typename MergeFunc>
     void Agglomerator::operator()(DistanceFunc distanceFunc, MergeFunc mergeFunc,
                                   Id_t numClusters) {
-        numClusters = std::min(numClusters, safetyMaxNumClusters);
         mIds.clear();
         mPairs.clear();
+        mSince.assign(std::max(numClusters, Id_t(0)), 0);
+        mSeq = 0;
 
         auto addCluster = [&distanceFunc, this](Id_t i) {
             // calculate distances to all existing clusters
+            mSince[i] = mSeq;
             for (auto j : mIds) {
                 Dist_t d = distanceFunc(i, j);
-                if (d != infDist) { mPairs.emplace_back(d, i, j); }
+                if (d != infDist) {
+                    mPairs.emplace_back(d, i, j, mSeq++);
+                    std::push_heap(begin(mPairs), end(mPairs));
+                }
             }
             // add cluster
             mIds.push_back(i);
@@ -29,31 +34,16 @@ namespace fmo {
                                            [i, j](Id_t id) { return id == i || id == j; });
                 mIds.erase(last, end(mIds));
             }
-            // remove i, j from mPairs
-            {
-                auto last = std::remove_if(begin(mPairs), end(mPairs), [i, j](const Pair& r) {
-                    return r.i == i || r.i == j || r.j == j || r.j == i;
-                });
-                mPairs.erase(last, end(mPairs));
-            }
+            // pairs with j are never valid again, pairs with i are replaced by addCluster()
+            mSince[j] = std::numeric_limits<uint32_t>::max();
             // merge into i
             mergeFunc(i, j);
             // re-insert i
             addCluster(i);
         };
 
-        auto findBestPair = [this]() {
-            Dist_t bestDist = infDist;
-            Pair* bestRel = nullptr;
-
-            for (auto& pair : mPairs) {
-                if (pair.d < bestDist) {
-                    bestDist = pair.d;
-                    bestRel = &pair;
-                }
-            }
-
-            return bestRel;
+        auto outOfDate = [this](const Pair& pair) {
+            return pair.seq < mSince[pair.i] || pair.seq < mSince[pair.j];
         };
 
         // add initial clusters
@@ -61,8 +51,11 @@ namespace fmo {
 
         // merge until there's no viable pairs left
         while (!mPairs.empty()) {
-            auto* pair = findBestPair();
-            mergeClusters(pair->i, pair->j);
+            std::pop_heap(begin(mPairs), end(mPairs));
+            Pair pair = mPairs.back();
+            mPairs.pop_back();
+            if (outOfDate(pair)) continue;
+            mergeClusters(pair.i, pair.j);
         }
     }
 }
@@ -10,17 +10,20 @@ namespace fmo {
         using Id_t = int16_t;
         using Dist_t = float;
 
-        static constexpr Id_t safetyMaxNumClusters = 100;
         static constexpr Dist_t infDist = std::numeric_limits<Dist_t>::max();
 
-        /// Performs agglomerative clustering using a naive algorithm with O(n^3) time complexity
-        /// and O(n^2) storage complexity. Clusters are merged greedily based on the provided
-        /// distance function. Additionally, it is assumed that once a cluster is created by
-        /// merging, the distance to all the other clusters cannot be derived from the previously
-        /// calculated distances. Consequently, the problem is not an instance of single-linkage
-        /// clustering. The merging operation effectively removes two clusters and adds a new one
-        /// instead, therefore it is required that the distance function is cheap to calculate, with
-        /// complexity O(1) even for non-trivial clusters.
+        /// Performs agglomerative clustering. Clusters are merged greedily based on the provided
+        /// distance function, the closest pair first. Additionally, it is assumed that once a
+        /// cluster is created by merging, the distance to all the other clusters cannot be derived
+        /// from the previously calculated distances. Consequently, the problem is not an instance
+        /// of single-linkage clustering. The merging operation effectively removes two clusters
+        /// and adds a new one instead, therefore it is required that the distance function is
+        /// cheap to calculate, with complexity O(1) even for non-trivial clusters.
+        ///
+        /// The distances are kept in a binary heap. Pairs that refer to a merged cluster are not
+        /// removed from the heap, they are skipped once they reach the top. This gives O(n^2 log n)
+        /// time complexity and O(n^2) storage complexity. When several pairs have the same
+        /// distance, the pair that has been evaluated first is merged first.
         ///
         /// @param distanceFunc A funtion with signature Dist_t(Id_t i, Id_t j) or compatible that
         /// provides the distance between clusters i, j with time complexity O(1). Return infDist
@@ -38,12 +41,20 @@ namespace fmo {
             Dist_t d;
             Id_t i;
             Id_t j;
+            uint32_t seq; ///< order in which the distances have been evaluated
+
+            Pair(Dist_t aD, Id_t aI, Id_t aJ, uint32_t aSeq) : d(aD), i(aI), j(aJ), seq(aSeq) {}
 
-            Pair(Dist_t aD, Id_t aI, Id_t aJ) : d(aD), i(aI), j(aJ) {}
+            /// Ordering of the heap: the pair at the top has the smallest distance.
+            friend bool operator<(const Pair& l, const Pair& r) {
+                return l.d > r.d || (l.d == r.d && l.seq > r.seq);
+            }
         };
 
-        std::vector<Id_t> mIds;
-        std::vector<Pair> mPairs;
+        std::vector<Id_t> mIds;       ///< valid clusters
+        std::vector<uint32_t> mSince; ///< pairs evaluated before this are out of date
+        std::vector<Pair> mPairs;     ///< heap of distances between clusters
+        uint32_t mSeq = 0;            ///< sequence number of the next pair
     };
 }
 
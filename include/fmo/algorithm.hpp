@@ -7,6 +7,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 #include <fmo/processing.hpp>
 
 namespace fmo {
@@ -34,6 +35,10 @@ namespace fmo {
             std::string name;
             /// Configuration regarding creation of difference images.
             Differentiator::Config diff;
+            /// The number of recent frames the background is a per-pixel median of. Must be odd,
+            /// at most 63. Zero selects the running median of the four latest frames and the
+            /// previous background.
+            int backgroundWindow;
             /// Minimum IOU to accept a detection as TP during evaluation.
             float iouThreshold;
             /// Strips that are close to each other will be considered as part of the same connected
@@ -102,6 +107,20 @@ namespace fmo {
             /// Exact image height for processing. The input image will be downscaled by a factor
             /// of 2 until its height is less or equal to the specified value.
             int imageHeight;
+            /// Processes only the luminance of the input. The background model, the difference
+            /// image and everything derived from them have a single channel, regardless of the
+            /// input format.
+            bool grayOnly;
+            /// Rectangles, in input frame pixels, that objects are detected in. Everything outside
+            /// the rectangles is ignored. The whole frame is processed if there are no rectangles.
+            /// Supported by TaxonomyV1 only; the other algorithms throw if it is set. TaxonomyV1
+            /// uses a fixed difference threshold, so pixels outside the region never affect it.
+            std::vector<Bounds> roi;
+            /// GRAY image; objects are detected only where its pixels are non-zero. The image is
+            /// scaled to the dimensions of the input frame. Combined with roi, only pixels that
+            /// are both inside a rectangle and non-zero in the mask are processed. Supported by
+            /// TaxonomyV1 only, as above.
+            Image roiMask;
 
             // legacy parameters
 
@@ -146,12 +165,18 @@ namespace fmo {
             /// Maximum distance that an object may travel in a single frame. This value is relative
             /// to the length of the path travelled in three frames.
             float maxMotion;
+            /// Makes "explorer-v3" use GRAY difference images, one byte per pixel, instead of
+            /// bit-packed BINARY ones. The other algorithms always use GRAY difference images.
+            bool grayDiff;
             /// When outputting object point set, specifies what resolution should be used. When
             /// using source resolution, additional heavy-weight calculations need to be performed.
             bool pointSetSourceResolution;
 
             /// Creates a new config instance with default settings.
             Config();
+
+            /// Tests whether detection is restricted by roi or roiMask.
+            bool haveRoi() const { return !roi.empty() || roiMask.size() != 0; }
         };
 
         /// A structure that contains all relevant information about a detected object. The user of
@@ -168,7 +193,7 @@ namespace fmo {
                 float length = -1.f;             ///< length of the object in input frame pixels
                 float radius = -1.f;             ///< radius of the object in input frame pixels
                 float velocity = -1.f;           ///< velocity in input frame pixels per frame
-                SCurve * curve = nullptr;
+                Curve curve;                     ///< fitted trajectory, empty if unknown
                 float scale = 1;
 
                 bool haveId() const { return id != -1; }
@@ -226,6 +251,20 @@ namespace fmo {
         /// the contents of the provided input image with an internal buffer.
         virtual void setInputSwap(Image& input) = 0;
 
+        /// Lends out an image that is to be filled with the next input frame, allowing the caller
+        /// to decode or copy the frame straight into it instead of preparing a separate image for
+        /// setInputSwap(). The image has the format and dimensions specified in make(). The image
+        /// must be filled and passed on by calling commitInput() before it is requested again.
+        Image& acquireInputBuffer() {
+            mInputBuffer.resize(mInputFormat, mInputDims);
+            return mInputBuffer;
+        }
+
+        /// To be called every frame after filling the image obtained by acquireInputBuffer(). Has
+        /// the same effect as calling setInputSwap() with the image. The image that is swapped out
+        /// is recycled as the next input buffer.
+        void commitInput() { setInputSwap(mInputBuffer); }
+
         /// To be called every frame, obtaining a list of fast-moving objects that have been
         /// detected this frame. The returned objects (i.e. instances of class Detection) may be
         /// used only before the next call to setInputSwap().
@@ -244,6 +283,10 @@ namespace fmo {
             return getDebugImage();
         }
 
+    private:
+        Image mInputBuffer;                    ///< image lent out by acquireInputBuffer()
+        Format mInputFormat = Format::UNKNOWN; ///< input format specified in make()
+        Dims mInputDims = {0, 0};              ///< input dimensions specified in make()
     };
 }
 
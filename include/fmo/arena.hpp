@@ -0,0 +1,111 @@
+#ifndef FMO_ARENA_HPP
+#define FMO_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fmo {
+    /// Bump allocator for short-lived data. Memory is taken from large blocks and it is released
+    /// all at once by calling reset(). The blocks are kept for reuse, so after a few frames of
+    /// operation, no more memory is requested from the system.
+    struct Arena {
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        /// Creates an empty arena. Blocks of the specified size are allocated when needed.
+        Arena(size_t blockSize = 64 * 1024) : mBlockSize(blockSize) {}
+
+        /// Provides a piece of memory of the specified size. The memory is valid until reset() is
+        /// called or until the arena is destroyed.
+        void* allocate(size_t bytes, size_t align) {
+            if (mBlock < mBlocks.size()) {
+                size_t offset = (mOffset + align - 1) & ~(align - 1);
+                if (offset + bytes <= mBlocks[mBlock].size) {
+                    mOffset = offset + bytes;
+                    return mBlocks[mBlock].data.get() + offset;
+                }
+            }
+            return allocateSlow(bytes, align);
+        }
+
+        /// Makes all memory available again. Pointers obtained by allocate() become invalid.
+        void reset() {
+            mBlock = 0;
+            mOffset = 0;
+        }
+
+    private:
+        struct Block {
+            std::unique_ptr<uint8_t[]> data;
+            size_t size;
+        };
+
+        /// Moves to the next block that is large enough, allocating a new one if necessary.
+        void* allocateSlow(size_t bytes, size_t align) {
+            const size_t required = bytes + align;
+            size_t next = (mBlock < mBlocks.size()) ? mBlock + 1 : mBlock;
+            while (next < mBlocks.size() && mBlocks[next].size < required) { next++; }
+
+            if (next == mBlocks.size()) {
+                size_t size = std::max(mBlockSize, required);
+                mBlocks.push_back(Block{std::unique_ptr<uint8_t[]>(new uint8_t[size]), size});
+            }
+
+            // blocks come from operator new[], so they are aligned to at least alignof(max_align_t)
+            mBlock = next;
+            mOffset = 0;
+            return allocate(bytes, align);
+        }
+
+        const size_t mBlockSize;    ///< default size of a block
+        std::vector<Block> mBlocks; ///< all blocks, used ones first
+        size_t mBlock = 0;          ///< index of the block being used
+        size_t mOffset = 0;         ///< the number of bytes used in the current block
+    };
+
+    /// Standard library allocator that takes memory from an Arena. Deallocation does nothing; the
+    /// memory is recycled when the arena is reset. Containers using this allocator must be
+    /// destroyed or cleared before the arena is reset.
+    template <typename T>
+    struct ArenaAllocator {
+        using value_type = T;
+
+        ArenaAllocator(Arena& arena) : mArena(&arena) {}
+
+        template <typename S>
+        ArenaAllocator(const ArenaAllocator<S>& other) : mArena(other.arena()) {}
+
+        T* allocate(size_t count) { return (T*)mArena->allocate(sizeof(T) * count, alignof(T)); }
+
+        void deallocate(T*, size_t) noexcept {}
+
+        Arena* arena() const { return mArena; }
+
+        template <typename S>
+        struct rebind {
+            using other = ArenaAllocator<S>;
+        };
+
+    private:
+        Arena* mArena;
+    };
+
+    template <typename T, typename U>
+    inline bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+        return lhs.arena() == rhs.arena();
+    }
+
+    template <typename T, typename U>
+    inline bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+        return lhs.arena() != rhs.arena();
+    }
+
+    /// Vector with elements stored in an Arena.
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
+
+#endif // FMO_ARENA_HPP
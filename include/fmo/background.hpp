@@ -0,0 +1,71 @@
+#ifndef FMO_BACKGROUND_HPP
+#define FMO_BACKGROUND_HPP
+
+#include <fmo/common.hpp>
+#include <fmo/image.hpp>
+#include <vector>
+
+namespace fmo {
+    /// Keeps the history of recent frames and a per-pixel median of them, to be used as a model
+    /// of the static background. Frames are received by swapping.
+    ///
+    /// With a window of zero, the model behaves as the "median" algorithms always did: the
+    /// background is the median of the last four frames and the previous background, and it is
+    /// updated by Differentiator in the same pass that creates the difference image.
+    ///
+    /// With an odd window of three or more frames, the background is the exact median of the
+    /// most recent frames. Each pixel keeps its window of values sorted; when a frame arrives, the
+    /// value that leaves the window is replaced by the incoming one. The cost of the update is a
+    /// handful of min/max operations per element of the window, so the window can be enlarged
+    /// without sorting anything.
+    struct BackgroundModel {
+        enum : int {
+            MAX_WINDOW = 63, ///< the largest supported window size
+        };
+
+        BackgroundModel(const BackgroundModel&) = delete;
+        BackgroundModel& operator=(const BackgroundModel&) = delete;
+
+        /// Creates a model taking the median over the specified number of frames. The window must
+        /// be zero or an odd number between 3 and MAX_WINDOW.
+        BackgroundModel(int window);
+
+        /// Receives the next frame by swapping the contents of the provided image with an
+        /// internal buffer. The input must have the same format and dimensions each time. The
+        /// first frame fills the whole window. If the model is incremental, the background is
+        /// updated before this method returns.
+        void swapInput(Image& input);
+
+        /// Provides a recent frame; age 0 is the newest one. The age must be less than four or
+        /// the window size, whichever is greater.
+        const Image& frame(int age) const;
+
+        /// Provides the current background. Initially, the background is black.
+        const Image& background() const { return *mBackground; }
+        Image& background() { return *mBackground; }
+
+        /// Whether the background is updated by swapInput(). If not, the caller is expected to
+        /// update the background by calculating the median of frame(0) to frame(3) and the
+        /// background itself.
+        bool incremental() const { return mWindow != 0; }
+
+        /// The number of frames received so far.
+        int numFrames() const { return mNumFrames; }
+
+    private:
+        void init(const Image& first);
+        void update(const Image& leaving, const Image& arriving);
+
+        const int mWindow;                ///< the number of frames the median is taken over
+        const int mHistory;               ///< the number of frames kept
+        int mNewest = 0;                  ///< the index of the newest frame in mFrames
+        int mNumFrames = 0;               ///< the number of frames received so far
+        std::vector<Image> mFrames;       ///< recent frames, a ring buffer
+        std::vector<Image> mPlanes;       ///< sorted per-pixel values of the window, ascending
+        std::vector<uint8_t*> mPlaneData; ///< data pointers of mPlanes
+        Image mLegacy;                    ///< background when the model is not incremental
+        Image* mBackground;               ///< the median plane or mLegacy
+    };
+}
+
+#endif // FMO_BACKGROUND_HPP
@@ -23,6 +23,8 @@ namespace fmo {
         INT32,
         YUV420SP,
         FLOAT,
+        BINARY, ///< 1 bit per pixel: pixel x is bit x % 64 of the uint64_t word x / 64 of its row;
+                ///< rows are padded to whole words, the padding bits are zero
     };
 
     template <typename T> int sgn(T val) {
@@ -5,6 +5,7 @@
 #include <fmo/image.hpp>
 
 namespace fmo {
+    struct BackgroundModel;
 
     /// Computes first-order absolute difference images in various formats.
     struct Differentiator {
@@ -21,6 +22,8 @@ namespace fmo {
             float noiseMax;
             /// The period of adjusting $\Delta$.
             int adjustPeriod;
+            /// Produce BINARY difference images instead of GRAY ones.
+            bool binary;
 
             Config();
         };
@@ -30,16 +33,35 @@ namespace fmo {
         /// Computes first-order absolute difference image in various formats. The inputs must have
         /// the same format and size. The output is resized to match the size of the inputs and its
         /// format is set to GRAY. The output image is binary -- the values are either 0x00 or 0xFF.
+        /// If the binary option is set, the output format is BINARY instead.
         void operator()(const Mat& src1, const Mat& src2, Image& dst);
 
+        /// Computes the per-pixel median of the four inputs and the background, stores it into
+        /// the background and computes a binary difference image between src1 and the updated
+        /// background, all in a single pass over the data. The threshold is adjusted in the same
+        /// way as above. The inputs and the background must have the same format and size.
+        void operator()(const Image& src1, const Image& src2, const Image& src3,
+                        const Image& src4, Image& background, Image& dst);
+
+        /// Computes a binary difference image between the newest frame of the model and its
+        /// background. If the model is not incremental, its background is updated in the same
+        /// pass, as above.
+        void operator()(BackgroundModel& model, Image& dst);
+
         /// Adjusts the threshold. The provided value is weighted by the number of pixels in the
-        /// image to obtain a noise fraction. Threshold is adjusted appropriately in order to keep
-        /// the noise fraction in the range mCfg.noiseMin to mCfg.noiseMax.
+        /// whole image to obtain a noise fraction, so the noise must be counted over the whole
+        /// image as well. Threshold is adjusted appropriately in order to keep the noise fraction
+        /// in the range mCfg.noiseMin to mCfg.noiseMax.
         void reportAmountOfNoise(int noise);
 
     private:
+        /// Adjusts the threshold based on recently reported noise amounts and returns the
+        /// threshold to use with an image of the specified size.
+        uint8_t calibrate(Dims dims);
+
         const Config mCfg;       ///< configuration object, received upon construction
         Image mAbsDiff;          ///< cached absolute difference image
+        Image mGrayDiff;         ///< cached GRAY difference image, used for BINARY output
         uint8_t mThresh;         ///< current threshold
         std::vector<int> mNoise; ///< recent noise amounts
     };
@@ -0,0 +1,56 @@
+#ifndef FMO_DISTANCE_HPP
+#define FMO_DISTANCE_HPP
+
+#include <fmo/common.hpp>
+#include <fmo/image.hpp>
+#include <vector>
+
+namespace fmo {
+    /// Computes the distance transform of a binary image and finds its local maxima in the same
+    /// sweep. The distances are identical to cv::distanceTransform() with DIST_L2 and
+    /// DIST_MASK_3. The maxima are the same as those found by local_maxima(), except that
+    /// background pixels are never marked.
+    ///
+    /// Only the parts of the image that contain foreground are processed. The previous outputs are
+    /// remembered and only the areas written last time are cleared, so the output images should
+    /// be left untouched between calls.
+    struct DistanceTransform {
+        /// Calculates the distance of each non-zero pixel of a GRAY image to the nearest zero
+        /// pixel and stores it into dist (FLOAT). Non-zero pixels that are not smaller than any of
+        /// their eight neighbors are set to 0xFF in maxima (GRAY), other pixels are set to 0x00.
+        /// The outputs are resized to match the size of the input.
+        void operator()(const Mat& src, Image& dist, Image& maxima);
+
+        /// Same as above, but only the specified areas are processed, e.g. the regions of a
+        /// TileMap. The areas must not overlap and every pixel around each of them must be zero,
+        /// unless it lies outside the image. All non-zero pixels must lie inside the areas.
+        void operator()(const Mat& src, const std::vector<Bounds>& boxes, Image& dist,
+                        Image& maxima);
+
+        /// Provides the areas processed in the last call. Every foreground pixel lies inside
+        /// exactly one of the areas.
+        const std::vector<Bounds>& boxes() const { return mBoxes; }
+
+    private:
+        /// Finds bands of consecutive rows that contain foreground and trims them to the columns
+        /// that contain foreground.
+        void findBoxes(const Mat& src);
+
+        /// Sets the areas written in the previous call to zero.
+        void clear(Image& dist, Image& maxima);
+
+        /// Processes the areas in mBoxes.
+        void process(const Mat& src, Image& dist, Image& maxima);
+
+        std::vector<Bounds> mBoxes;   ///< areas to be processed
+        std::vector<Bounds> mDirty;   ///< areas written in the previous call
+        std::vector<size_t> mOffsets; ///< the location of each area in mTemp
+        std::vector<int32_t> mTemp;   ///< fixed-point distances, including a border
+        std::vector<int32_t> mZeros;  ///< a row of zero distances
+        const uint8_t* mDistData = nullptr;   ///< data of the distance image written last time
+        const uint8_t* mMaximaData = nullptr; ///< data of the maxima image written last time
+        Dims mDims = {0, 0};                  ///< dimensions of the images written last time
+    };
+}
+
+#endif // FMO_DISTANCE_HPP
@@ -2,62 +2,177 @@
 #define FMO_EXCHANGE_HPP
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 
 namespace fmo {
-    /// Exchanges date in a multi-threaded scenario between a periodical producer and one or more
-    /// consumers. Payload gets dropped if it's not consumed before next payload arrives. It is
-    /// assumed that the payload is cheap to swap.
+    /// Specifies what happens when a payload is sent to an Exchange that is full.
+    enum class ExchangePolicy {
+        DROP_OLDEST, ///< the oldest unreceived payload is discarded to make space
+        DROP_NEWEST, ///< the payload being sent is discarded
+        BLOCK,       ///< the producer waits until a consumer makes space
+    };
+
+    /// Exchanges data in a multi-threaded scenario between a periodical producer and one or more
+    /// consumers. Payloads are kept in a ring buffer of a fixed capacity; what happens when the
+    /// ring is full is given by the policy. It is assumed that the payload is cheap to swap.
+    ///
+    /// Sending and receiving is lock-free. A mutex is only used to put threads to sleep when
+    /// they have to wait, i.e. when receiving from an empty exchange or when sending to a full
+    /// exchange with the BLOCK policy. Only one thread may send payloads.
     template <typename T>
     struct Exchange {
         Exchange(const Exchange&) = delete;
         Exchange& operator=(const Exchange&) = delete;
 
-        /// Create a new exchange. The constructor arguments are forwarded to the constructor of the
-        /// payload.
+        /// Create a new exchange. The capacity is rounded up to a power of two. The remaining
+        /// constructor arguments are passed to the constructor of each of the stored payloads.
         template <typename... Args>
-        Exchange(Args&&... args) : mPayload(std::forward<Args>(args)...) {}
+        Exchange(ExchangePolicy policy, size_t capacity, const Args&... args)
+            : mPolicy(policy), mScratch(args...) {
+            size_t size = 1;
+            while (size < capacity) { size *= 2; }
+            mMask = size - 1;
+            mSlots.reset(new Slot[size]);
+            for (size_t i = 0; i < size; i++) {
+                mSlots[i].seq.store(i, std::memory_order_relaxed);
+                mSlots[i].payload = T(args...);
+            }
+        }
 
-        /// Sends new data to the consumers. Previous payload is discarded if it hasn't been
-        /// processed yet. Data is stored by swapping.
-        void swapSend(T& payload) {
-            std::lock_guard<std::mutex> lock(mMutex);
+        /// Sends new data to the consumers. Data is stored by swapping. Returns false if the
+        /// payload has been dropped, or if exit() has been called.
+        bool swapSend(T& payload) {
+            while (!tryPush(payload)) {
+                if (mExit.load()) { return false; }
 
-            using std::swap;
-            swap(mPayload, payload);
+                switch (mPolicy) {
+                case ExchangePolicy::DROP_NEWEST:
+                    mDropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                case ExchangePolicy::DROP_OLDEST:
+                    if (tryPop(mScratch)) {
+                        mDropped.fetch_add(1, std::memory_order_relaxed);
+                        wake();
+                    }
+                    break;
+                case ExchangePolicy::BLOCK:
+                    waitFor([this]() { return !full(); });
+                    break;
+                }
+            }
+
+            mAccepted.fetch_add(1, std::memory_order_relaxed);
+            wake();
+            return true;
+        }
 
-            mHave = true;
+        /// Get the oldest payload deposited using swapSend that hasn't been received yet. If there
+        /// is no such payload available, the method will block until there's new data or the
+        /// exit() method is called. Data is received by swapping. Returns false if no data has
+        /// been received because of a call to exit().
+        bool swapReceive(T& payload) {
+            for (;;) {
+                if (mExit.load()) { return false; }
+                if (tryPop(payload)) {
+                    wake();
+                    return true;
+                }
+                waitFor([this]() { return !empty(); });
+            }
+        }
+
+        /// Set the internal exit flag and wake up all waiting threads.
+        void exit() {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mExit.store(true);
             mWait.notify_all();
         }
 
-        /// Get the most recent payload deposited using swapSend. If there is no new, previously
-        /// unreceived payload available, the method will block until there's new data or the exit()
-        /// method is called. Data is received by swapping.
-        void swapReceive(T& payload) {
-            std::unique_lock<std::mutex> lock(mMutex);
-            mWait.wait(lock, [this]() { return mHave || mExit; });
-            if (mExit) { return; }
+        /// Provides the number of payloads that have been accepted by swapSend().
+        uint64_t accepted() const { return mAccepted.load(std::memory_order_relaxed); }
 
+        /// Provides the number of payloads that have been dropped without being received.
+        uint64_t dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+    private:
+        struct Slot {
+            std::atomic<size_t> seq; ///< equals the position when free, position + 1 when full
+            T payload;
+        };
+
+        /// Stores the payload if there is free space.
+        bool tryPush(T& payload) {
+            Slot& slot = mSlots[mTail & mMask];
+            if (slot.seq.load(std::memory_order_acquire) != mTail) { return false; }
             using std::swap;
-            swap(mPayload, payload);
+            swap(slot.payload, payload);
+            slot.seq.store(mTail + 1, std::memory_order_release);
+            mTail++;
+            return true;
+        }
 
-            mHave = false;
+        /// Takes the oldest payload if there is one. May be called from several threads.
+        bool tryPop(T& payload) {
+            size_t pos = mHead.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot& slot = mSlots[pos & mMask];
+                size_t seq = slot.seq.load(std::memory_order_acquire);
+                auto diff = intptr_t(seq) - intptr_t(pos + 1);
+                if (diff < 0) { return false; }
+                if (diff > 0) {
+                    pos = mHead.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    using std::swap;
+                    swap(slot.payload, payload);
+                    slot.seq.store(pos + mMask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
         }
 
-        /// Set the internal exit flag and wake up all waiting threads.
-        void exit() {
+        bool empty() const {
+            size_t pos = mHead.load(std::memory_order_acquire);
+            return mSlots[pos & mMask].seq.load(std::memory_order_acquire) != pos + 1;
+        }
+
+        bool full() const { return mSlots[mTail & mMask].seq.load(std::memory_order_acquire) != mTail; }
+
+        /// Sleeps until the condition holds or exit() is called.
+        template <typename Ready>
+        void waitFor(Ready ready) {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWaiters.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            mWait.wait(lock, [&]() { return ready() || mExit.load(); });
+            mWaiters.fetch_sub(1);
+        }
+
+        /// Wakes up sleeping threads, if there are any, after the state has changed.
+        void wake() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (mWaiters.load() == 0) { return; }
             std::lock_guard<std::mutex> lock(mMutex);
-            mExit = true;
             mWait.notify_all();
         }
 
-    private:
-        T mPayload;
+        const ExchangePolicy mPolicy;
+        std::unique_ptr<Slot[]> mSlots;
+        size_t mMask;
+        size_t mTail = 0;              ///< next position to write, used by the producer only
+        T mScratch;                    ///< receives payloads dropped by the producer
+        std::atomic<size_t> mHead{0};  ///< next position to read
+        std::atomic<int> mWaiters{0};  ///< the number of sleeping threads
+        std::atomic<bool> mExit{false};
+        std::atomic<uint64_t> mAccepted{0};
+        std::atomic<uint64_t> mDropped{0};
         std::mutex mMutex;
         std::condition_variable mWait;
-        bool mHave = false;
-        bool mExit = false;
     };
 }
 
@@ -95,7 +95,7 @@ namespace fmo {
         virtual Region region(Pos pos, Dims dims) override;
 
         /// The number of bytes to advance if one needs to access the next row.
-        virtual size_t skip() const override { return mDims.width; }
+        virtual size_t skip() const override;
 
         /// Provides access to image data.
         virtual uint8_t* data() override { return mData.data(); }
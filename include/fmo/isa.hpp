@@ -0,0 +1,33 @@
+#ifndef FMO_ISA_HPP
+#define FMO_ISA_HPP
+
+namespace fmo {
+    /// Instruction set used by the kernels that are compiled in several variants.
+    enum class Isa {
+        SCALAR,   ///< plain C++, always available
+        SSE2,     ///< x86 SSE2, 16-byte vectors
+        AVX2,     ///< x86 AVX2, 32-byte vectors
+        AVX512BW, ///< x86 AVX-512 with byte and word instructions, 64-byte vectors
+        NEON,     ///< ARM NEON, 16-byte vectors
+    };
+
+    /// Checks whether kernels for the instruction set have been compiled in and whether the CPU
+    /// is able to execute them.
+    bool isaSupported(Isa isa);
+
+    /// Provides the instruction set that the kernels are currently using. On the first call, the
+    /// best supported instruction set is selected, unless the environment variable FMO_ISA names
+    /// another supported one (scalar, sse2, avx2, avx512bw, neon).
+    Isa activeIsa();
+
+    /// Makes the kernels use the specified instruction set. Throws if it's not supported.
+    void setIsa(Isa isa);
+
+    /// Provides the lower-case name of the instruction set, as accepted in FMO_ISA.
+    const char* isaName(Isa isa);
+
+    /// Finds the instruction set by its name. Throws if there's no such instruction set.
+    Isa isaFromName(const char* name);
+}
+
+#endif // FMO_ISA_HPP
@@ -0,0 +1,73 @@
+#ifndef FMO_LABELING_HPP
+#define FMO_LABELING_HPP
+
+#include <fmo/common.hpp>
+#include <vector>
+
+namespace fmo {
+    /// Finds 8-connected components of a binary image without creating a label image. Foreground
+    /// pixels of each row are run-length encoded and the runs are merged using union-find, so the
+    /// cost depends on the number of runs rather than on the number of pixels. For each component,
+    /// the statistics and the list of its runs are provided.
+    struct ComponentLabeler {
+        /// Horizontal sequence of foreground pixels in a single row.
+        struct Run {
+            int y;  ///< row
+            int x0; ///< first column (inclusive)
+            int x1; ///< last column (exclusive)
+        };
+
+        /// Statistics of a connected component, equivalent to cv::connectedComponentsWithStats().
+        struct Component {
+            Bounds bounds;  ///< bounding box in pixel coordinates
+            int area;       ///< the number of pixels
+            double centerX; ///< mean x coordinate of the pixels
+            double centerY; ///< mean y coordinate of the pixels
+            int firstRun;   ///< index of the first run of the component in runs()
+            int numRuns;    ///< the number of runs of the component
+        };
+
+        /// Finds the connected components of the non-zero pixels of a GRAY or BINARY image.
+        void operator()(const Mat& img);
+
+        /// Same as above, but only the specified areas are processed, e.g. the regions of a
+        /// TileMap. Every pixel around each of the areas must be zero, unless it lies outside the
+        /// image, so that no component spans several areas.
+        void operator()(const Mat& img, const std::vector<Bounds>& boxes);
+
+        /// Finds the connected components of runs that have been obtained elsewhere, e.g. of the
+        /// strips produced by StripGen, with the roles of rows and columns exchanged. The runs must
+        /// be sorted by row, then by column, and they must not overlap. Runs in neighboring rows
+        /// are connected if they overlap or touch diagonally.
+        void operator()(const std::vector<Run>& runs);
+
+        /// Provides the components found by the last call, ordered by the position of their first
+        /// pixel: by area (in the order of the boxes), then by row, then by column.
+        const std::vector<Component>& components() const { return mComponents; }
+
+        /// Provides the runs of all components. The runs of each component are stored
+        /// consecutively, sorted by row, then by column.
+        const std::vector<Run>& runs() const { return mSorted; }
+
+    private:
+        /// Adds the runs of a rectangular area of a GRAY or BINARY image to mRuns.
+        void encode(const Mat& img, const Bounds& box);
+
+        /// Merges the runs in mRuns, starting at index first, and appends the components.
+        void label(int first);
+
+        /// Stores the runs of each component consecutively into mSorted.
+        void group();
+
+        /// Finds the representative of a run, compressing the path.
+        int find(int i);
+
+        std::vector<Run> mRuns;             ///< runs in the order of rows
+        std::vector<int> mParent;           ///< union-find forest over mRuns
+        std::vector<int> mLabel;            ///< component index of each run in mRuns
+        std::vector<Run> mSorted;           ///< runs grouped by component
+        std::vector<Component> mComponents; ///< components found by the last call
+    };
+}
+
+#endif // FMO_LABELING_HPP
@@ -4,6 +4,8 @@
 #include <fmo/image.hpp>
 #include <opencv2/core.hpp>
 #include <iostream>
+#include <new>
+#include <type_traits>
 
 namespace cv {
     template<typename _Tp> class Point_;
@@ -12,31 +14,39 @@ namespace cv {
 }
 
 namespace fmo {
-     /// Fitting curve
-    struct SCurve  
-    {  
-        SCurve() {}
-        virtual ~SCurve() {}
+    /// A read-only view of a contiguous array of points, used to pass points to the fitting
+    /// functions regardless of how the points are stored.
+    struct PointSpan {
+        PointSpan(const cv::Point2f* data, size_t size) : mData(data), mSize(size) {}
+
+        template <typename Alloc>
+        PointSpan(const std::vector<cv::Point2f, Alloc>& vec)
+            : mData(vec.data()), mSize(vec.size()) {}
+
+        const cv::Point2f* data() const { return mData; }
+        size_t size() const { return mSize; }
+        bool empty() const { return mSize == 0; }
+        const cv::Point2f& operator[](size_t i) const { return mData[i]; }
+        const cv::Point2f* begin() const { return mData; }
+        const cv::Point2f* end() const { return mData + mSize; }
+
+    private:
+        const cv::Point2f* mData;
+        size_t mSize;
+    };
 
-    public:
+    /// Parameters shared by all fitted curves.
+    struct SCurve {
         double scale = 1;
         cv::Point2f shift{0,0};
         float length = 0;
         cv::Point2f start{0, 0};
         cv::Point2f end{0, 0};
         cv::Point2f center{0, 0};
-
-        virtual void draw(cv::Mat& cvVis, cv::Scalar clr = cv::Scalar{0,0,0}, float thickness = 1) const { };
-        virtual void drawSmooth(cv::Mat& cvVis, cv::Scalar clr = cv::Scalar{0,0,0}, float thickness = 1) const { };
-        virtual float maxDist(const std::vector<cv::Point2f>& pixels) const { return 0; };
-        virtual SCurve* clone() const {
-            return new SCurve(*this); 
-        };
     };
 
     struct SLine : SCurve 
     {
-        SLine() {}
         cv::Vec4f params{0, 0, 0, 0};
         cv::Point2f normal{0, 0};
         cv::Point2f perp{0,0};
@@ -44,18 +54,13 @@ namespace fmo {
         cv::Point2f startSmooth{0, 0};
         cv::Point2f endSmooth{0, 0};
 
-    public:
-        virtual void draw(cv::Mat& cvVis, cv::Scalar clr, float thickness) const override;
-        virtual void drawSmooth(cv::Mat& cvVis, cv::Scalar clr, float thickness) const override;
-        virtual float maxDist(const std::vector<cv::Point2f>& pixels) const override;
-        virtual SCurve* clone() const override {
-            return new SLine(*this); 
-        }
+        void draw(cv::Mat& cvVis, cv::Scalar clr = cv::Scalar{0,0,0}, float thickness = 1) const;
+        void drawSmooth(cv::Mat& cvVis, cv::Scalar clr = cv::Scalar{0,0,0}, float thickness = 1) const;
+        float maxDist(PointSpan pixels) const;
     };
 
     struct SCircle : SCurve 
     {
-        SCircle() { }
         float radius{0};
         float x{0};
         float y{0};
@@ -67,15 +72,123 @@ namespace fmo {
 
         double size{0};
 
-    public:
-        virtual void draw(cv::Mat& cvVis, cv::Scalar clr, float thickness) const override;
-        virtual void drawSmooth(cv::Mat& cvVis, cv::Scalar clr, float thickness) const override;
-        virtual float maxDist(const std::vector<cv::Point2f>& pixels) const override;
-        virtual SCurve* clone() const override {
-            return new SCircle(*this); 
+        void draw(cv::Mat& cvVis, cv::Scalar clr = cv::Scalar{0,0,0}, float thickness = 1) const;
+        void drawSmooth(cv::Mat& cvVis, cv::Scalar clr = cv::Scalar{0,0,0}, float thickness = 1) const;
+        float maxDist(PointSpan pixels) const;
+    };
+
+    /// Fitted curve: either a line, a circle, or nothing. The curve is stored inline and copied by
+    /// value, so that it can be passed around without tracking ownership.
+    struct Curve {
+        enum class Type { NONE, LINE, CIRCLE };
+
+        Curve() : mType(Type::NONE), mLine() {}
+        Curve(const SLine& line) : mType(Type::LINE), mLine(line) {}
+        Curve(const SCircle& circle) : mType(Type::CIRCLE), mCircle(circle) {}
+        Curve(const Curve& other) : mType(Type::NONE), mLine() { *this = other; }
+
+        Curve& operator=(const Curve& other) {
+            if (this == &other) return *this;
+            mType = other.mType;
+            if (mType == Type::CIRCLE) {
+                new (&mCircle) SCircle(other.mCircle);
+            } else {
+                new (&mLine) SLine(other.mLine);
+            }
+            return *this;
+        }
+
+        Type type() const { return mType; }
+        bool empty() const { return mType == Type::NONE; }
+
+        /// Provides the parameters shared by lines and circles.
+        SCurve& common() { return (mType == Type::CIRCLE) ? (SCurve&)mCircle : (SCurve&)mLine; }
+        const SCurve& common() const { return const_cast<Curve*>(this)->common(); }
+
+        float length() const { return common().length; }
+
+        /// Provides the line. Valid only if the type is LINE.
+        const SLine& line() const { return mLine; }
+
+        /// Provides the circle. Valid only if the type is CIRCLE.
+        const SCircle& circle() const { return mCircle; }
+
+        void draw(cv::Mat& cvVis, cv::Scalar clr = cv::Scalar{0,0,0}, float thickness = 1) const {
+            switch (mType) {
+            case Type::LINE: mLine.draw(cvVis, clr, thickness); break;
+            case Type::CIRCLE: mCircle.draw(cvVis, clr, thickness); break;
+            default: break;
+            }
         }
+
+        void drawSmooth(cv::Mat& cvVis, cv::Scalar clr = cv::Scalar{0,0,0}, float thickness = 1) const {
+            switch (mType) {
+            case Type::LINE: mLine.drawSmooth(cvVis, clr, thickness); break;
+            case Type::CIRCLE: mCircle.drawSmooth(cvVis, clr, thickness); break;
+            default: break;
+            }
+        }
+
+        float maxDist(PointSpan pixels) const {
+            switch (mType) {
+            case Type::LINE: return mLine.maxDist(pixels);
+            case Type::CIRCLE: return mCircle.maxDist(pixels);
+            default: return 0;
+            }
+        }
+
+    private:
+        // both alternatives are trivially destructible, so the union needs no destructor
+        static_assert(std::is_trivially_destructible<SLine>::value &&
+                          std::is_trivially_destructible<SCircle>::value,
+                      "Curve alternatives must be trivially destructible");
+
+        Type mType;
+        union {
+            SLine mLine;
+            SCircle mCircle;
+        };
     };
 
+    /// Calculates the intersection-over-union of a set of pixels and a curve drawn with the given
+    /// thickness, considering only the part of the curve inside the box. The area covered by the
+    /// curve is evaluated analytically, without rasterization: a capsule around a line segment, or
+    /// an annulus sector with round caps around an arc. Each row of the box is intersected with
+    /// this area, and the pixels whose centers lie in the resulting spans are counted.
+    float curveIoU(const Curve& curve, float thickness, PointSpan pixels, const Bounds& box);
+
+    /// Sums of powers of point coordinates, up to the fourth order. These are sufficient
+    /// statistics for least-squares line and circle fits, so two point sets can be joined and
+    /// re-fitted in constant time, without visiting the points again.
+    struct FitAccumulator {
+        FitAccumulator() = default;
+        FitAccumulator(PointSpan pixels) { add(pixels); }
+
+        void add(const cv::Point2f& p);
+        void add(PointSpan pixels);
+        FitAccumulator& operator+=(const FitAccumulator& other);
+
+        friend FitAccumulator operator+(FitAccumulator lhs, const FitAccumulator& rhs) {
+            return lhs += rhs;
+        }
+
+        /// Provides the number of accumulated points.
+        double count() const { return mMoments[0][0]; }
+
+        /// Fits a circle algebraically (Kasa fit). Returns the approximate RMS distance of the
+        /// points from the circle. The radius is set to zero if the points are collinear.
+        float circle(float& cx, float& cy, float& radius) const;
+
+        /// Fits a line by principal component analysis. Provides the centroid and a unit
+        /// direction vector. Returns the RMS distance of the points from the line.
+        float line(cv::Point2f& point, cv::Point2f& direction) const;
+
+    private:
+        /// Calculates sum (x - a)^i (y - b)^j.
+        double central(int i, int j, double a, double b) const;
+
+        double mMoments[5][5] = {}; ///< sum x^i y^j for i + j <= 4
+    };
 
     /// Saves an image to file.
     void save(const Mat& src, const std::string& filename);
@@ -91,7 +204,8 @@ namespace fmo {
     /// Converts the image "src" to a given color format and saves the result to "dst". One could
     /// pass the same object as both "src" and "dst", but doing so is ineffective, unless the
     /// conversion is YUV420SP to GRAY. Only some conversions are supported, namely: GRAY to BGR,
-    /// BGR to GRAY, YUV420SP to BGR, YUV420SP to GRAY.
+    /// BGR to GRAY, YUV420SP to BGR, YUV420SP to GRAY, GRAY to BINARY (non-zero pixels are set),
+    /// BINARY to GRAY (set pixels become 0xFF).
     void convert(const Mat& src, Mat& dst, Format format);
 
     /// Selects pixels that have a value less than the specified value; these are set to 0xFF while
@@ -102,8 +216,24 @@ namespace fmo {
     /// while others are set to 0x00. Input image must be GRAY.
     void greater_than(const Mat& src1, Mat& dst, uint8_t value);
 
+    /// Selects pixels that have a value greater than the specified value; these are set in the
+    /// output BINARY image while others are cleared. Input image must be GRAY.
+    void greater_than_binary(const Mat& src, Mat& dst, uint8_t value);
+
+    /// Calculates the per-pixel bitwise OR of two images. Input images must have the same size
+    /// and they must be either both GRAY or both BINARY.
+    void bitwise_or(const Mat& src1, const Mat& src2, Mat& dst);
+
+    /// Calculates the per-pixel bitwise AND of two images. Input images must have the same size
+    /// and they must be either both GRAY or both BINARY.
+    void bitwise_and(const Mat& src1, const Mat& src2, Mat& dst);
+
+    /// Calculates the distance of each non-zero pixel to the nearest zero pixel. Input image must
+    /// be GRAY, output image is FLOAT. See also DistanceTransform.
     void distance_transform(const Mat& src, Mat& dst);
 
+    /// Selects pixels that are not smaller than any of their eight neighbors; these are set to
+    /// 0xFF while others are set to 0x00. Input image must be FLOAT.
     void local_maxima(const Mat& src, Mat& dst);
     
     void imfill(const Mat& src, Mat& dst);
@@ -128,18 +258,40 @@ namespace fmo {
     /// Calculates the per-pixel median of three images.
     void median5(const Image& src1, const Image& src2, const Image& src3, const Image& src4, const Image& src5, Image& dst);
 
+    /// Calculates the per-pixel median of five images and, in the same pass, a binary difference
+    /// image between the first input and the median. For single-channel images, output pixels
+    /// are set to 0xFF where the absolute difference is greater than thresh; for three-channel
+    /// images, the sum of absolute differences over channels is compared instead. The median is
+    /// stored into the median image, which may be the same image as src5. Inputs must be GRAY,
+    /// BGR or YUV and have the same format and size. The output is resized and set to GRAY.
+    void median5_diff(const Image& src1, const Image& src2, const Image& src3, const Image& src4,
+                      const Image& src5, Image& median, Image& dst, uint8_t thresh);
+
+    /// Like the above, but the median is not stored.
+    void median5_diff(const Image& src1, const Image& src2, const Image& src3, const Image& src4,
+                      const Image& src5, Image& dst, uint8_t thresh);
+
     /// Flips an image in x axis.
     void flip(const Mat& src, Mat& dst);
 
-    float fitline(const std::vector<cv::Point2f>& pixels, float fmoRadius, SLine &line);
-    float fitcircle(const std::vector<cv::Point2f>& pixels, float fmoRadius, SCircle &circle);
-    float fitcurve(const std::vector<cv::Point2f>& pixels, float fmoRadius, SCurve *&curve,
+    float fitline(PointSpan pixels, float fmoRadius, SLine &line);
+    float fitcircle(PointSpan pixels, float fmoRadius, SCircle &circle);
+    float fitcurve(PointSpan pixels, float fmoRadius, Curve &curve,
                    SCircle &circle, SLine &line);
-    float fitcurve(const std::vector<cv::Point2f>& pixels, float fmoRadius, SCurve *&curve,
+    float fitcurve(PointSpan pixels, float fmoRadius, Curve &curve,
                    SCircle &circle, SLine &line, const cv::Vec2f &c1, const cv::Vec2f &c2);
 
-    float fitcircle(const std::vector<cv::Point2f>& pixels, float fmoRadius, SCircle &circle,
+    float fitcircle(PointSpan pixels, float fmoRadius, SCircle &circle,
+                    const cv::Vec2f &c1, const cv::Vec2f &c2);
+
+    /// Like the above, but the fits are calculated from the accumulated statistics instead of
+    /// the points. Used to re-fit the union of two point sets without RANSAC.
+    float fitline(const FitAccumulator &acc, float fmoRadius, SLine &line,
+                  const cv::Vec2f &c1, const cv::Vec2f &c2);
+    float fitcircle(const FitAccumulator &acc, float fmoRadius, SCircle &circle,
                     const cv::Vec2f &c1, const cv::Vec2f &c2);
+    float fitcurve(const FitAccumulator &acc, float fmoRadius, Curve &curve,
+                   SCircle &circle, SLine &line, const cv::Vec2f &c1, const cv::Vec2f &c2);
 
 
     }
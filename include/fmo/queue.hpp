@@ -0,0 +1,62 @@
+#ifndef FMO_QUEUE_HPP
+#define FMO_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace fmo {
+    /// First-in first-out queue with a limited capacity for passing data between threads. The
+    /// producer blocks when the queue is full and the consumer blocks when it is empty, so that
+    /// stages connected by such queues run at the pace of the slowest stage. Payload is moved.
+    template <typename T>
+    struct BoundedQueue {
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        /// Creates an empty queue that holds at most the specified number of items.
+        BoundedQueue(size_t capacity) : mCapacity(capacity) {}
+
+        /// Appends an item to the queue. Blocks while the queue is full. Returns false, without
+        /// moving from the item, if the queue has been closed.
+        bool push(T&& item) {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mNotFull.wait(lock, [this]() { return mItems.size() < mCapacity || mClosed; });
+            if (mClosed) { return false; }
+            mItems.push_back(std::move(item));
+            mNotEmpty.notify_one();
+            return true;
+        }
+
+        /// Removes the oldest item from the queue. Blocks while the queue is empty. Returns false
+        /// if the queue has been closed and there are no more items.
+        bool pop(T& item) {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mNotEmpty.wait(lock, [this]() { return !mItems.empty() || mClosed; });
+            if (mItems.empty()) { return false; }
+            item = std::move(mItems.front());
+            mItems.pop_front();
+            mNotFull.notify_one();
+            return true;
+        }
+
+        /// Stops accepting new items and wakes up all waiting threads. Items that are already in
+        /// the queue can still be received.
+        void close() {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClosed = true;
+            mNotFull.notify_all();
+            mNotEmpty.notify_all();
+        }
+
+    private:
+        const size_t mCapacity;
+        std::deque<T> mItems;
+        std::mutex mMutex;
+        std::condition_variable mNotFull;
+        std::condition_variable mNotEmpty;
+        bool mClosed = false;
+    };
+}
+
+#endif // FMO_QUEUE_HPP
@@ -41,18 +41,20 @@ namespace fmo {
         /// discarded as noise. The vertical gap between two strips (that are not considered noise)
         /// must be at least minGap, otherwise both strips are discarded.
         ///
-        /// @param img image to find strips in
+        /// @param img GRAY or BINARY image to find strips in
         /// @param minHeight minimum height of strip, otherwise the strip is discarded
         /// @param minGap minimum gap between strips
         /// @param step ratio of original-resolution to processing-resolution pixels
-        /// @param out resulting strips, in no particular order
+        /// @param out resulting strips, sorted by x coordinate, then by y coordinate
         /// @param outNoise the number of strips discarded due to minHeight
         void operator()(const fmo::Mat& img, int minHeight, int minGap, int step,
                         std::vector<Strip>& out, int& outNoise);
 
     private:
-        std::vector<int16_t> mRle; ///< cache for run-length encodings
-        std::vector<Strip> mTemp;  ///< cache for strips
+        std::vector<int16_t> mRle;                 ///< cache for run-length encodings
+        std::vector<uint64_t> mMasks;              ///< cache for masks of changed columns
+        std::vector<std::vector<Strip>> mSegments; ///< strips found by each thread
+        std::vector<int> mNoise;                   ///< noise found by each thread
     };
 }
 
@@ -5,13 +5,18 @@
 #include <fmo/image.hpp>
 
 namespace fmo {
-    /// Similar to subsample(), but also allows to subsample YUV420SP images, in which case an YUV
-    /// image is created.
+    /// Similar to subsample() and subsample_resize(), but also allows to subsample YUV420SP images,
+    /// in which case an YUV image is created.
     struct Subsampler {
         /// Performs decimation, as when subsample() is called, but with additional support for
         /// YUV420SP inputs.
         void operator()(const Mat& src, Mat& dst);
 
+        /// Performs resizing, as when subsample_resize() is called, but with additional support
+        /// for YUV420SP inputs. The luma plane and the interleaved chroma plane are resized
+        /// separately and then interleaved into an YUV image, without converting to BGR.
+        void resize(const Mat& src, Mat& dst, float scale);
+
         /// Provides the dimensions of the output, given that the decimation input has dimensions
         /// "dims".
         Dims nextDims(Dims dims);
@@ -25,6 +30,7 @@ namespace fmo {
 
     private:
         Image y, u, v;
+        Image uv; ///< chroma plane resized by resize()
     };
 }
 
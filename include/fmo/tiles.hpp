@@ -0,0 +1,59 @@
+#ifndef FMO_TILES_HPP
+#define FMO_TILES_HPP
+
+#include <fmo/common.hpp>
+#include <fmo/image.hpp>
+#include <vector>
+
+namespace fmo {
+    /// Divides a binary image into square tiles and finds out which of the tiles contain
+    /// foreground. Occupied tiles are grouped into rectangular regions, so that the following
+    /// processing steps can skip the background.
+    struct TileMap {
+        enum : int {
+            TILE_SIZE = 32, ///< width and height of a tile in pixels
+        };
+
+        /// Restricts the following calls to the non-zero pixels of a GRAY mask, which must have
+        /// the same dimensions as the binary images. Tiles that are entirely outside the mask are
+        /// never read. An empty mask removes the restriction.
+        void setMask(const Mat& mask);
+
+        /// Finds the tiles of a GRAY image that contain non-zero pixels and groups them into
+        /// regions. If a mask is set, pixels outside the mask are cleared first, but only in
+        /// tiles that are either partially covered by the mask or inside one of the regions.
+        void operator()(Mat& binary);
+
+        /// Provides rectangular areas, in pixel coordinates, that contain all non-zero pixels of
+        /// the last image. The regions are separated from each other by at least one unoccupied
+        /// tile, so each region is surrounded by a halo of zero pixels (or the image border). This
+        /// makes it possible to process the regions independently, even with 3x3 neighborhoods.
+        const std::vector<Bounds>& regions() const { return mRegions; }
+
+        /// Provides the number of tiles in each direction.
+        Dims grid() const { return mGrid; }
+
+        /// Tests whether a tile contains non-zero pixels.
+        bool occupied(int col, int row) const { return mOccupied[row * mGrid.width + col] != 0; }
+
+    private:
+        enum Coverage : uint8_t {
+            EXCLUDED, ///< the tile is outside the mask
+            PARTIAL,  ///< some pixels of the tile are outside the mask
+            INCLUDED, ///< the tile is inside the mask
+        };
+
+        /// Clears the pixels of a tile that lie outside the mask.
+        void applyMask(Mat& binary, int col, int row) const;
+
+        Image mMask;                    ///< pixels to consider, empty if all of them
+        std::vector<uint8_t> mCoverage; ///< Coverage of each tile by the mask
+        Dims mDims = {0, 0};            ///< dimensions of the last image
+        Dims mGrid = {0, 0};            ///< the number of tiles in each direction
+        std::vector<uint8_t> mOccupied; ///< non-zero for each occupied tile
+        std::vector<Bounds> mRects;     ///< regions in tile coordinates
+        std::vector<Bounds> mRegions;   ///< regions in pixel coordinates
+    };
+}
+
+#endif // FMO_TILES_HPP
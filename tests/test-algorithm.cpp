@@ -0,0 +1,225 @@
+#include "../catch/catch.hpp"
+#include <algorithm>
+#include <fmo/algorithm.hpp>
+#include <fmo/processing.hpp>
+#include <fmo/queue.hpp>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+    // the height matches the default processing height, so that no resizing takes place
+    const fmo::Dims DIMS = {640, 480};
+    // the first few frames only initialize the background, the rest must yield detections
+    const int NUM_FRAMES = 24;
+
+    /// Creates a frame with a bright horizontal streak that moves over a dark background, back and
+    /// forth between the left and the right edge.
+    fmo::Image makeFrame(int frameNum) {
+        const int radius = 8;
+        const int length = 60;
+        const int period = 14;
+        const int step = std::min(frameNum % period, period - frameNum % period);
+        const int x0 = 40 + 70 * step;
+        const int y0 = DIMS.height / 2;
+
+        fmo::Image result{fmo::Format::BGR, DIMS};
+        uint8_t* data = result.data();
+        for (int y = 0; y < DIMS.height; y++) {
+            for (int x = 0; x < DIMS.width; x++, data += 3) {
+                int dx = x - std::min(std::max(x, x0), x0 + length);
+                int dy = y - y0;
+                uint8_t value = (dx * dx + dy * dy <= radius * radius) ? 0xE0 : 0x20;
+                std::fill(data, data + 3, value);
+            }
+        }
+        return result;
+    }
+
+    struct Record {
+        int frameNum;
+        fmo::Pos center;
+        float radius;
+    };
+
+    /// Runs the algorithm on the frames, converting them to the specified format first.
+    std::vector<Record> detect(const fmo::Algorithm::Config& config, fmo::Format format) {
+        auto algorithm = fmo::Algorithm::make(config, format, DIMS);
+        fmo::Algorithm::Output output;
+        std::vector<Record> result;
+
+        for (int i = 0; i < NUM_FRAMES; i++) {
+            fmo::convert(makeFrame(i), algorithm->acquireInputBuffer(), format);
+            algorithm->commitInput();
+            algorithm->getOutput(output, false);
+            for (auto& detection : output.detections) {
+                result.push_back({i, detection->object.center, detection->object.radius});
+            }
+        }
+        return result;
+    }
+
+    /// Runs the algorithm like the pipelined loop of the desktop application: frames are
+    /// converted in one thread, detected in the calling thread and collected in a third thread.
+    /// The threads are connected by bounded queues and the image buffers are recycled.
+    std::vector<Record> detectPipelined(const fmo::Algorithm::Config& config,
+                                        fmo::Format format) {
+        const size_t depth = 2;
+        auto algorithm = fmo::Algorithm::make(config, format, DIMS);
+        fmo::BoundedQueue<fmo::Image> freeImages{depth + 2};
+        fmo::BoundedQueue<fmo::Image> decoded{depth};
+        fmo::BoundedQueue<std::vector<Record>> detected{depth};
+        for (size_t i = 0; i < depth + 1; i++) { freeImages.push(fmo::Image{format, DIMS}); }
+
+        std::thread decoder([&]() {
+            for (int i = 0; i < NUM_FRAMES; i++) {
+                fmo::Image image;
+                if (!freeImages.pop(image)) break;
+                fmo::convert(makeFrame(i), image, format);
+                if (!decoded.push(std::move(image))) break;
+            }
+            decoded.close();
+        });
+
+        std::vector<Record> result;
+        std::thread collector([&]() {
+            std::vector<Record> records;
+            while (detected.pop(records)) {
+                result.insert(result.end(), records.begin(), records.end());
+            }
+        });
+
+        fmo::Algorithm::Output output;
+        fmo::Image image;
+        for (int i = 0; decoded.pop(image); i++) {
+            algorithm->setInputSwap(image);
+            freeImages.push(std::move(image));
+            algorithm->getOutput(output, false);
+            std::vector<Record> records;
+            for (auto& detection : output.detections) {
+                records.push_back({i, detection->object.center, detection->object.radius});
+            }
+            detected.push(std::move(records));
+        }
+
+        freeImages.close();
+        detected.close();
+        decoder.join();
+        collector.join();
+        return result;
+    }
+
+    void requireSame(const std::vector<Record>& lhs, const std::vector<Record>& rhs) {
+        REQUIRE(lhs.size() == rhs.size());
+        for (size_t i = 0; i < lhs.size(); i++) {
+            REQUIRE(lhs[i].frameNum == rhs[i].frameNum);
+            REQUIRE(lhs[i].center.x == rhs[i].center.x);
+            REQUIRE(lhs[i].center.y == rhs[i].center.y);
+            REQUIRE(lhs[i].radius == Approx(rhs[i].radius));
+        }
+    }
+}
+
+SCENARIO("processing only the luminance of the input", "[algorithm]") {
+    GIVEN("detections of a gray object in BGR frames by the default algorithm") {
+        fmo::Algorithm::Config config;
+        auto baseline = detect(config, fmo::Format::BGR);
+        REQUIRE(!baseline.empty());
+
+        WHEN("the gray-only mode is enabled") {
+            config.grayOnly = true;
+            auto gray = detect(config, fmo::Format::BGR);
+            THEN("the detections are the same") { requireSame(gray, baseline); }
+        }
+        WHEN("the frames are provided in GRAY format") {
+            auto gray = detect(config, fmo::Format::GRAY);
+            THEN("the detections are the same") { requireSame(gray, baseline); }
+        }
+    }
+}
+
+SCENARIO("using bit-packed difference images in explorer-v3", "[algorithm]") {
+    GIVEN("detections by explorer-v3 with GRAY difference images") {
+        fmo::Algorithm::Config config;
+        config.name = "explorer-v3";
+        config.grayDiff = true;
+        auto baseline = detect(config, fmo::Format::BGR);
+        REQUIRE(!baseline.empty());
+
+        WHEN("the default BINARY difference images are used") {
+            config.grayDiff = false;
+            auto binary = detect(config, fmo::Format::BGR);
+            THEN("the detections are the same") { requireSame(binary, baseline); }
+        }
+    }
+}
+
+SCENARIO("restricting detection to a region of interest", "[algorithm]") {
+    GIVEN("a configuration with a region of interest") {
+        fmo::Algorithm::Config config;
+        config.roi.push_back({{0, 0}, {DIMS.width / 2 - 1, DIMS.height - 1}});
+
+        WHEN("the algorithm supports it") {
+            THEN("the algorithm is created") {
+                REQUIRE_NOTHROW(fmo::Algorithm::make(config, fmo::Format::BGR, DIMS));
+            }
+        }
+        WHEN("the algorithm does not support it") {
+            THEN("creating the algorithm throws") {
+                for (auto& name : fmo::Algorithm::listFactories()) {
+                    if (name == "taxonomy-v1") continue;
+                    config.name = name;
+                    REQUIRE_THROWS_AS(fmo::Algorithm::make(config, fmo::Format::BGR, DIMS),
+                                      std::runtime_error);
+                }
+            }
+        }
+    }
+    GIVEN("detections by the default algorithm in the whole frame") {
+        fmo::Algorithm::Config config;
+        auto baseline = detect(config, fmo::Format::BGR);
+        REQUIRE(!baseline.empty());
+
+        // the streak moves horizontally along the middle row of the frame
+        const int bandTop = DIMS.height / 2 - 80;
+        const int bandBottom = DIMS.height / 2 + 79;
+
+        WHEN("the region of interest covers the path of the object") {
+            config.roi.push_back({{0, bandTop}, {DIMS.width - 1, bandBottom}});
+            auto inside = detect(config, fmo::Format::BGR);
+            THEN("the detections are the same") { requireSame(inside, baseline); }
+        }
+        WHEN("a smaller ROI mask covers the path of the object") {
+            // the mask is scaled up to the input frame
+            const int scale = 10;
+            config.roiMask.resize(fmo::Format::GRAY, {DIMS.width / scale, DIMS.height / scale});
+            const int maskWidth = config.roiMask.dims().width;
+            for (int y = 0; y < config.roiMask.dims().height; y++) {
+                bool inBand = y >= bandTop / scale && y <= bandBottom / scale;
+                uint8_t* row = config.roiMask.data() + y * maskWidth;
+                std::fill(row, row + maskWidth, inBand ? uint8_t(0xFF) : uint8_t(0));
+            }
+            auto inside = detect(config, fmo::Format::BGR);
+            THEN("the detections are the same") { requireSame(inside, baseline); }
+        }
+        WHEN("the region of interest excludes the path of the object") {
+            config.roi.push_back({{0, 0}, {DIMS.width - 1, bandTop - 1}});
+            config.roi.push_back({{0, bandBottom + 1}, {DIMS.width - 1, DIMS.height - 1}});
+            auto outside = detect(config, fmo::Format::BGR);
+            THEN("there are no detections") { REQUIRE(outside.empty()); }
+        }
+    }
+}
+
+SCENARIO("processing frames in a pipeline", "[algorithm]") {
+    GIVEN("detections by the default algorithm, one frame after another") {
+        fmo::Algorithm::Config config;
+        auto baseline = detect(config, fmo::Format::BGR);
+        REQUIRE(!baseline.empty());
+
+        WHEN("decoding, detection and collection run in separate threads") {
+            auto pipelined = detectPipelined(config, fmo::Format::BGR);
+            THEN("the detections are the same") { requireSame(pipelined, baseline); }
+        }
+    }
+}
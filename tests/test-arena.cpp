@@ -0,0 +1,35 @@
+#include "../catch/catch.hpp"
+#include <fmo/arena.hpp>
+
+TEST_CASE("Arena", "[arena]") {
+    fmo::Arena arena{256};
+
+    SECTION("allocations are aligned and do not overlap") {
+        auto* a = (uint8_t*)arena.allocate(3, 1);
+        auto* b = (uint8_t*)arena.allocate(8, 8);
+        auto* c = (uint8_t*)arena.allocate(1000, 16);
+        REQUIRE(uintptr_t(b) % 8 == 0);
+        REQUIRE(uintptr_t(c) % 16 == 0);
+        REQUIRE((b >= a + 3 || b + 8 <= a));
+        REQUIRE((c >= b + 8 || c + 1000 <= b));
+    }
+
+    SECTION("memory is reused after reset") {
+        void* first = arena.allocate(100, 4);
+        arena.allocate(1000, 4);
+        arena.reset();
+        REQUIRE(arena.allocate(100, 4) == first);
+    }
+
+    SECTION("vectors can grow in the arena") {
+        fmo::ArenaVector<int> vec{arena};
+        for (int i = 0; i < 1000; i++) { vec.push_back(i); }
+        REQUIRE(vec.size() == 1000);
+        REQUIRE(vec.front() == 0);
+        REQUIRE(vec.back() == 999);
+
+        fmo::ArenaVector<int> copy{vec};
+        REQUIRE(copy.get_allocator() == vec.get_allocator());
+        REQUIRE(copy[500] == 500);
+    }
+}
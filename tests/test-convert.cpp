@@ -1,4 +1,5 @@
 #include "../catch/catch.hpp"
+#include <array>
 #include "test-data.hpp"
 #include "test-tools.hpp"
 
@@ -69,4 +70,36 @@ SCENARIO("performing color conversions", "[image][convert]") {
             }
         }
     }
+    GIVEN("a GRAY source image with values 0x00 and 0xFF") {
+        const std::array<uint8_t, 8> gray = {{0xFF, 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00}};
+        fmo::Image src{fmo::Format::GRAY, IM_4x2_DIMS, gray.data()};
+        GIVEN("an empty destination image") {
+            fmo::Image dst{ };
+            WHEN("converting to BINARY") {
+                fmo::convert(src, dst, fmo::Format::BINARY);
+                THEN("result image has correct dimensions") {
+                    REQUIRE(dst.dims() == IM_4x2_DIMS);
+                    AND_THEN("result image has correct format") {
+                        REQUIRE(dst.format() == fmo::Format::BINARY);
+                        AND_THEN("each row is a single padded word of bits") {
+                            REQUIRE(dst.skip() == 8);
+                            REQUIRE(dst.size() == 16);
+                            const uint64_t* words = (const uint64_t*)dst.data();
+                            REQUIRE(words[0] == 0x9);
+                            REQUIRE(words[1] == 0x2);
+                        }
+                    }
+                }
+                AND_WHEN("converting back to GRAY") {
+                    fmo::Image back{ };
+                    fmo::convert(dst, back, fmo::Format::GRAY);
+                    THEN("result image matches the source image") {
+                        REQUIRE(back.format() == fmo::Format::GRAY);
+                        REQUIRE(back.dims() == IM_4x2_DIMS);
+                        REQUIRE(exact_match(back, gray));
+                    }
+                }
+            }
+        }
+    }
 }
@@ -0,0 +1,79 @@
+#include "../catch/catch.hpp"
+#include "../desktop/report.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    const std::vector<std::string> inputNames = {"alpha", "bravo", "charlie", "delta"};
+
+    /// The order in which the inputs finish when processed by several workers.
+    const std::vector<size_t> finishOrder = {2, 0, 3, 1};
+}
+
+SCENARIO("merging results of inputs processed in parallel", "[desktop]") {
+    GIVEN("results of each input, produced in an arbitrary order") {
+        std::vector<Results> results(inputNames.size());
+        for (size_t i : finishOrder) {
+            auto& file = results[i].newFile(inputNames[i]);
+            file.frames.resize(i + 1);
+            file.frames.back()[Event::TP] = int(i);
+            file.iou.push_back(int(10 * i));
+        }
+
+        WHEN("the results are merged in the order of the inputs") {
+            Results merged;
+            for (auto& r : results) { merged.merge(std::move(r)); }
+
+            THEN("the files are listed in the order of the inputs") {
+                REQUIRE(merged.size() == inputNames.size());
+                size_t i = 0;
+                for (auto& file : merged) {
+                    REQUIRE(file.name == inputNames[i]);
+                    REQUIRE(file.frames.size() == i + 1);
+                    REQUIRE(file.frames.back()[Event::TP] == int(i));
+                    REQUIRE(file.iou == std::vector<int>{int(10 * i)});
+                    i++;
+                }
+            }
+
+            THEN("the merged instances are left empty") {
+                for (auto& r : results) { REQUIRE(r.empty()); }
+            }
+        }
+    }
+
+    GIVEN("detection reports of each input, written in an arbitrary order") {
+        std::vector<std::unique_ptr<DetectionReport>> reports(inputNames.size());
+        for (size_t i : finishOrder) {
+            reports[i].reset(new DetectionReport());
+            reports[i]->makeSequence(inputNames[i]);
+        }
+
+        WHEN("the reports are appended to a report file in the order of the inputs") {
+            Date date;
+            const std::string path = "./" + date.fileNameSafeStamp() + ".xml";
+            {
+                DetectionReport rpt{".", date};
+                for (auto& r : reports) { rpt.append(*r); }
+            }
+            std::ifstream file{path};
+            std::stringstream content;
+            content << file.rdbuf();
+            file.close();
+            std::remove(path.c_str());
+
+            THEN("the sequences are listed in the order of the inputs") {
+                const std::string text = content.str();
+                size_t last = 0;
+                for (auto& name : inputNames) {
+                    size_t pos = text.find("<sequence input=\"" + name + "\">");
+                    REQUIRE(pos != std::string::npos);
+                    REQUIRE(pos > last);
+                    last = pos;
+                }
+                REQUIRE(text.find("</run>") > last);
+            }
+        }
+    }
+}
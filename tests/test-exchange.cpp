@@ -0,0 +1,82 @@
+#include "../catch/catch.hpp"
+#include <algorithm>
+#include <fmo/exchange.hpp>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Exchange", "[exchange]") {
+    SECTION("DROP_OLDEST keeps the newest payloads") {
+        fmo::Exchange<int> exchange{fmo::ExchangePolicy::DROP_OLDEST, 2};
+        for (int i = 1; i <= 5; i++) {
+            int value = i;
+            REQUIRE(exchange.swapSend(value));
+        }
+        int value = 0;
+        REQUIRE(exchange.swapReceive(value));
+        REQUIRE(value == 4);
+        REQUIRE(exchange.swapReceive(value));
+        REQUIRE(value == 5);
+        REQUIRE(exchange.accepted() == 5);
+        REQUIRE(exchange.dropped() == 3);
+    }
+
+    SECTION("DROP_NEWEST keeps the oldest payloads") {
+        fmo::Exchange<int> exchange{fmo::ExchangePolicy::DROP_NEWEST, 2};
+        for (int i = 1; i <= 5; i++) {
+            int value = i;
+            REQUIRE(exchange.swapSend(value) == (i <= 2));
+        }
+        int value = 0;
+        REQUIRE(exchange.swapReceive(value));
+        REQUIRE(value == 1);
+        REQUIRE(exchange.swapReceive(value));
+        REQUIRE(value == 2);
+        REQUIRE(exchange.accepted() == 2);
+        REQUIRE(exchange.dropped() == 3);
+    }
+
+    SECTION("exit() wakes up a waiting consumer") {
+        fmo::Exchange<int> exchange{fmo::ExchangePolicy::DROP_OLDEST, 1};
+        bool received = true;
+        std::thread consumer([&]() {
+            int value;
+            received = exchange.swapReceive(value);
+        });
+        exchange.exit();
+        consumer.join();
+        REQUIRE(!received);
+    }
+
+    SECTION("BLOCK delivers every payload to multiple consumers") {
+        const int numValues = 20000;
+        fmo::Exchange<int> exchange{fmo::ExchangePolicy::BLOCK, 4};
+        std::vector<int> counts(numValues, 0);
+        std::vector<std::thread> consumers;
+        std::vector<std::vector<int>> received(3);
+        for (auto& out : received) {
+            consumers.emplace_back([&exchange, &out]() {
+                int value;
+                while (exchange.swapReceive(value) && value >= 0) { out.push_back(value); }
+            });
+        }
+        for (int i = 0; i < numValues; i++) {
+            int value = i;
+            REQUIRE(exchange.swapSend(value));
+        }
+        for (size_t i = 0; i < consumers.size(); i++) {
+            int value = -1;
+            exchange.swapSend(value);
+        }
+        for (auto& thread : consumers) { thread.join(); }
+
+        bool ordered = true;
+        for (auto& out : received) {
+            ordered = ordered && std::is_sorted(begin(out), end(out));
+            for (int value : out) { counts[value]++; }
+        }
+        REQUIRE(ordered);
+        bool allOnce = std::all_of(begin(counts), end(counts), [](int c) { return c == 1; });
+        REQUIRE(allOnce);
+        REQUIRE(exchange.dropped() == 0);
+    }
+}
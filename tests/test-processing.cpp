@@ -1,5 +1,17 @@
 #include "../catch/catch.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fmo/agglomerator-impl.hpp>
+#include <fmo/background.hpp>
+#include <fmo/differentiator.hpp>
+#include <fmo/distance.hpp>
+#include <fmo/isa.hpp>
+#include <fmo/labeling.hpp>
+#include <fmo/region.hpp>
+#include <fmo/strip.hpp>
 #include <fmo/subsampler.hpp>
+#include <fmo/tiles.hpp>
+#include <random>
 #include "test-data.hpp"
 #include "test-tools.hpp"
 
@@ -72,6 +84,15 @@ SCENARIO("performing complex operations", "[image][processing]") {
                     REQUIRE(exact_match(dst, IM_4x2_SUBSAMPLED));
                 }
             }
+            WHEN("Subsampler is used to resize a YUV420SP image") {
+                fmo::Subsampler sub;
+                sub.resize(src, dst, 0.5f);
+                THEN("result is as expected") {
+                    REQUIRE(dst.format() == fmo::Format::YUV);
+                    REQUIRE((dst.dims() == fmo::Dims{2, 1}));
+                    REQUIRE(exact_match(dst, IM_4x2_SUBSAMPLED));
+                }
+            }
         }
         GIVEN("random GRAY source images") {
             fmo::Image src1{fmo::Format::GRAY, IM_4x2_DIMS, IM_4x2_RANDOM_1.data()};
@@ -88,3 +109,867 @@ SCENARIO("performing complex operations", "[image][processing]") {
         }
     }
 }
+
+SCENARIO("computing the median background and the difference in a single pass",
+         "[image][processing]") {
+    std::mt19937 re{5489};
+    std::uniform_int_distribution<int> uniform{0, 255};
+    auto randomImage = [&](fmo::Format format, fmo::Dims dims) {
+        fmo::Image result{format, dims};
+        for (auto& value : result) { value = uint8_t(uniform(re)); }
+        return result;
+    };
+
+    auto check = [&](fmo::Format format) {
+        const fmo::Dims dims{37, 11};
+        fmo::Image src1 = randomImage(format, dims);
+        fmo::Image src2 = randomImage(format, dims);
+        fmo::Image src3 = randomImage(format, dims);
+        fmo::Image src4 = randomImage(format, dims);
+        fmo::Image background = randomImage(format, dims);
+        fmo::Differentiator::Config cfg;
+
+        WHEN("the fused kernel and the separate steps are used") {
+            fmo::Image expectedMedian;
+            fmo::Image expectedDiff;
+            fmo::median5(src1, src2, src3, src4, background, expectedMedian);
+            fmo::Differentiator separate{cfg};
+            separate(src1, expectedMedian, expectedDiff);
+
+            fmo::Image diff;
+            fmo::Differentiator fused{cfg};
+            fused(src1, src2, src3, src4, background, diff);
+
+            THEN("the background is updated in place to the median") {
+                REQUIRE(background.format() == format);
+                REQUIRE(background.dims() == dims);
+                REQUIRE(exact_match(background, expectedMedian));
+            }
+            THEN("the difference images match") {
+                REQUIRE(diff.format() == fmo::Format::GRAY);
+                REQUIRE(diff.dims() == dims);
+                REQUIRE(exact_match(diff, expectedDiff));
+            }
+        }
+    };
+
+    GIVEN("five random GRAY images with dimensions not divisible by the batch size") {
+        check(fmo::Format::GRAY);
+    }
+    GIVEN("five random BGR images with dimensions not divisible by the batch size") {
+        check(fmo::Format::BGR);
+    }
+}
+
+SCENARIO("computing medians with each supported instruction set", "[image][processing]") {
+    std::mt19937 re{5489};
+    std::uniform_int_distribution<int> uniform{0, 255};
+    const fmo::Dims dims{101, 13};
+    std::vector<fmo::Image> src;
+    for (int i = 0; i < 5; i++) {
+        src.emplace_back(fmo::Format::BGR, dims);
+        for (auto& value : src.back()) { value = uint8_t(uniform(re)); }
+    }
+
+    GIVEN("medians computed by the scalar kernels") {
+        const fmo::Isa original = fmo::activeIsa();
+        fmo::Image expected3, expected5;
+        fmo::setIsa(fmo::Isa::SCALAR);
+        fmo::median3(src[0], src[1], src[2], expected3);
+        fmo::median5(src[0], src[1], src[2], src[3], src[4], expected5);
+
+        WHEN("the medians are computed using the other instruction sets") {
+            bool match3 = true;
+            bool match5 = true;
+            for (fmo::Isa isa : {fmo::Isa::SSE2, fmo::Isa::AVX2, fmo::Isa::AVX512BW,
+                                 fmo::Isa::NEON}) {
+                if (!fmo::isaSupported(isa)) continue;
+                fmo::Image median3, median5;
+                fmo::setIsa(isa);
+                fmo::median3(src[0], src[1], src[2], median3);
+                fmo::median5(src[0], src[1], src[2], src[3], src[4], median5);
+                match3 = match3 && exact_match(median3, expected3);
+                match5 = match5 && exact_match(median5, expected5);
+            }
+            fmo::setIsa(original);
+
+            THEN("the results are the same") {
+                REQUIRE(match3);
+                REQUIRE(match5);
+            }
+        }
+    }
+}
+
+SCENARIO("thresholding color differences with each supported instruction set",
+         "[image][processing]") {
+    std::mt19937 re{5489};
+    // small values, so that the sums are close to the threshold
+    std::uniform_int_distribution<int> uniform{0, 31};
+    const fmo::Dims dims{101, 13};
+    fmo::Image src1{fmo::Format::BGR, dims};
+    fmo::Image src2{fmo::Format::BGR, dims};
+    for (auto& value : src1) { value = uint8_t(uniform(re)); }
+    for (auto& value : src2) { value = uint8_t(uniform(re)); }
+
+    GIVEN("the expected binary difference image") {
+        fmo::Differentiator::Config cfg;
+        fmo::Image expected{fmo::Format::GRAY, dims};
+        const uint8_t* data1 = src1.data();
+        const uint8_t* data2 = src2.data();
+        for (auto& value : expected) {
+            int sum = 0;
+            for (int c = 0; c < 3; c++) { sum += std::abs(int(*data1++) - int(*data2++)); }
+            value = (sum > int(cfg.thresh)) ? uint8_t(0xFF) : uint8_t(0);
+        }
+
+        WHEN("Differentiator is used with each instruction set") {
+            const fmo::Isa original = fmo::activeIsa();
+            bool match = true;
+            for (fmo::Isa isa : {fmo::Isa::SCALAR, fmo::Isa::SSE2, fmo::Isa::AVX2,
+                                 fmo::Isa::AVX512BW, fmo::Isa::NEON}) {
+                if (!fmo::isaSupported(isa)) continue;
+                fmo::Image diff;
+                fmo::setIsa(isa);
+                fmo::Differentiator{cfg}(src1, src2, diff);
+                match = match && exact_match(diff, expected);
+            }
+            fmo::setIsa(original);
+
+            THEN("the results are as expected") { REQUIRE(match); }
+        }
+    }
+}
+
+SCENARIO("maintaining a sliding median background incrementally", "[image][processing]") {
+    std::mt19937 re{5489};
+    std::uniform_int_distribution<int> uniform{0, 255};
+    const int window = 7;
+    const fmo::Dims dims{37, 3};
+    fmo::BackgroundModel model{window};
+    std::vector<fmo::Image> history;
+
+    GIVEN("a series of random BGR images") {
+        WHEN("the images are passed to the model one by one") {
+            bool framesMatch = true;
+            bool backgroundsMatch = true;
+
+            for (int f = 0; f < 3 * window; f++) {
+                fmo::Image input{fmo::Format::BGR, dims};
+                for (auto& value : input) { value = uint8_t(uniform(re)); }
+                if (f == 0) { history.assign(window, input); }
+                history.erase(history.begin());
+                history.push_back(input);
+                model.swapInput(input);
+
+                framesMatch &= exact_match(model.frame(0), history.back());
+                fmo::Image expected = history.back();
+                auto* expectedData = expected.data();
+                for (size_t i = 0; i < size_t(expected.end() - expectedData); i++) {
+                    std::vector<uint8_t> values;
+                    for (auto& image : history) { values.push_back(image.data()[i]); }
+                    std::nth_element(values.begin(), values.begin() + window / 2, values.end());
+                    expectedData[i] = values[window / 2];
+                }
+                backgroundsMatch &= exact_match(model.background(), expected);
+            }
+
+            THEN("the newest frame is available") { REQUIRE(framesMatch); }
+            THEN("the background is the median of the window") { REQUIRE(backgroundsMatch); }
+        }
+    }
+}
+
+SCENARIO("finding vertical strips in a binary image", "[image][processing]") {
+    GIVEN("a binary image with white segments in several columns") {
+        fmo::Image src{fmo::Format::GRAY, {64, 32}};
+        std::fill(src.begin(), src.end(), uint8_t(0));
+        auto segment = [&](int x, int yFirst, int yLast) {
+            for (int y = yFirst; y < yLast; y++) { src.data()[y * 64 + x] = 0xFF; }
+        };
+        segment(40, 20, 30);
+        segment(3, 5, 10);
+        segment(40, 2, 4);
+        segment(17, 0, 3);
+
+        WHEN("StripGen is used") {
+            fmo::StripGen gen;
+            std::vector<fmo::Strip> strips;
+            int noise;
+            gen(src, 2, 1, 2, strips, noise);
+
+            THEN("the strips are found in the order of columns, then rows") {
+                REQUIRE(noise == 0);
+                REQUIRE(strips.size() == 4);
+                const int expected[4][3] = {{7, 15, 5}, {35, 3, 3}, {81, 6, 2}, {81, 50, 10}};
+                for (int i = 0; i < 4; i++) {
+                    REQUIRE(strips[i].pos.x == expected[i][0]);
+                    REQUIRE(strips[i].pos.y == expected[i][1]);
+                    REQUIRE(strips[i].halfDims.width == 1);
+                    REQUIRE(strips[i].halfDims.height == expected[i][2]);
+                }
+            }
+        }
+    }
+    GIVEN("a wide random binary image") {
+        std::mt19937 re{5489};
+        std::uniform_int_distribution<int> uniform{0, 99};
+        const fmo::Dims dims{1000, 60};
+        fmo::Image src{fmo::Format::GRAY, dims};
+        std::fill(src.begin(), src.end(), uint8_t(0));
+        for (int x = 0; x < dims.width; x++) {
+            for (int y = 0; y < dims.height; y++) {
+                if (uniform(re) >= 5) continue;
+                for (int k = 0; k < 10 && y + k < dims.height; k++) {
+                    src.data()[(y + k) * dims.width + x] = 0xFF;
+                }
+            }
+        }
+
+        WHEN("StripGen is used with each instruction set") {
+            const fmo::Isa original = fmo::activeIsa();
+            fmo::StripGen gen;
+            std::vector<fmo::Strip> expected;
+            int expectedNoise;
+            fmo::setIsa(fmo::Isa::SCALAR);
+            gen(src, 2, 1, 2, expected, expectedNoise);
+
+            bool match = true;
+            for (fmo::Isa isa : {fmo::Isa::SSE2, fmo::Isa::AVX2, fmo::Isa::AVX512BW,
+                                 fmo::Isa::NEON}) {
+                if (!fmo::isaSupported(isa)) continue;
+                std::vector<fmo::Strip> strips;
+                int noise;
+                fmo::setIsa(isa);
+                gen(src, 2, 1, 2, strips, noise);
+                match = match && noise == expectedNoise && strips.size() == expected.size();
+                for (size_t i = 0; match && i < strips.size(); i++) {
+                    match = strips[i].pos.x == expected[i].pos.x &&
+                            strips[i].pos.y == expected[i].pos.y &&
+                            strips[i].halfDims.height == expected[i].halfDims.height;
+                }
+            }
+            fmo::setIsa(original);
+
+            THEN("the strips are the same") {
+                REQUIRE(!expected.empty());
+                REQUIRE(match);
+            }
+        }
+    }
+}
+
+SCENARIO("processing bit-packed BINARY images", "[image][processing]") {
+    std::mt19937 re{5489};
+    std::uniform_int_distribution<int> uniform{0, 99};
+    const fmo::Dims dims{152, 40};
+    auto randomMask = [&]() {
+        fmo::Image result{fmo::Format::GRAY, dims};
+        for (auto& value : result) { value = (uniform(re) < 20) ? uint8_t(0xFF) : uint8_t(0); }
+        return result;
+    };
+    auto bit = [&](const fmo::Image& binary, int x, int y) {
+        const uint64_t* words = (const uint64_t*)(binary.data() + y * binary.skip());
+        return ((words[x / 64] >> (x % 64)) & 1) != 0;
+    };
+
+    GIVEN("a random GRAY image") {
+        fmo::Image src{fmo::Format::GRAY, dims};
+        for (auto& value : src) { value = uint8_t(uniform(re)); }
+
+        WHEN("greater_than_binary() is called with each instruction set") {
+            const fmo::Isa original = fmo::activeIsa();
+            bool match = true;
+            for (fmo::Isa isa : {fmo::Isa::SCALAR, fmo::Isa::SSE2, fmo::Isa::AVX2,
+                                 fmo::Isa::AVX512BW, fmo::Isa::NEON}) {
+                if (!fmo::isaSupported(isa)) continue;
+                fmo::Image dst;
+                fmo::setIsa(isa);
+                fmo::greater_than_binary(src, dst, 50);
+                match = match && dst.format() == fmo::Format::BINARY && dst.dims() == dims;
+                for (int y = 0; match && y < dims.height; y++) {
+                    for (int x = 0; x < 192; x++) {
+                        bool expected = x < dims.width && src.data()[y * dims.width + x] > 50;
+                        match = match && bit(dst, x, y) == expected;
+                    }
+                }
+            }
+            fmo::setIsa(original);
+
+            THEN("bits are set where the pixels are greater, padding is clear") {
+                REQUIRE(match);
+            }
+        }
+    }
+    GIVEN("two random masks in GRAY and BINARY format") {
+        fmo::Image gray1 = randomMask();
+        fmo::Image gray2 = randomMask();
+        fmo::Image binary1, binary2;
+        fmo::convert(gray1, binary1, fmo::Format::BINARY);
+        fmo::convert(gray2, binary2, fmo::Format::BINARY);
+
+        WHEN("bitwise_or() and bitwise_and() are applied to BINARY images") {
+            fmo::Image orBinary, andBinary, orGray, andGray;
+            fmo::bitwise_or(binary1, binary2, orBinary);
+            fmo::bitwise_and(binary1, binary2, andBinary);
+            fmo::convert(orBinary, orGray, fmo::Format::GRAY);
+            fmo::convert(andBinary, andGray, fmo::Format::GRAY);
+
+            THEN("the results match the per-pixel operations") {
+                bool match = true;
+                for (size_t i = 0; i < gray1.size(); i++) {
+                    match = match && orGray.data()[i] == (gray1.data()[i] | gray2.data()[i]);
+                    match = match && andGray.data()[i] == (gray1.data()[i] & gray2.data()[i]);
+                }
+                REQUIRE(match);
+            }
+        }
+        WHEN("StripGen is used on both formats") {
+            fmo::StripGen gen;
+            std::vector<fmo::Strip> fromGray, fromBinary;
+            int noiseGray, noiseBinary;
+            gen(gray1, 2, 1, 2, fromGray, noiseGray);
+            gen(binary1, 2, 1, 2, fromBinary, noiseBinary);
+
+            THEN("the strips are the same") {
+                REQUIRE(noiseBinary == noiseGray);
+                REQUIRE(fromBinary.size() == fromGray.size());
+                bool match = true;
+                for (size_t i = 0; i < fromGray.size(); i++) {
+                    match = match && fromBinary[i].pos.x == fromGray[i].pos.x &&
+                            fromBinary[i].pos.y == fromGray[i].pos.y &&
+                            fromBinary[i].halfDims.height == fromGray[i].halfDims.height;
+                }
+                REQUIRE(match);
+            }
+        }
+    }
+    GIVEN("a random mask whose width is not a multiple of 8") {
+        const fmo::Dims wide{205, 40};
+        fmo::Image gray{fmo::Format::GRAY, wide};
+        for (auto& value : gray) { value = (uniform(re) < 20) ? uint8_t(0xFF) : uint8_t(0); }
+        for (int y = 10; y < 20; y++) { gray.data()[y * wide.width + wide.width - 1] = 0xFF; }
+        fmo::Image binary;
+        fmo::convert(gray, binary, fmo::Format::BINARY);
+        auto sameStrips = [](const std::vector<fmo::Strip>& l, const std::vector<fmo::Strip>& r) {
+            bool match = l.size() == r.size();
+            for (size_t i = 0; match && i < l.size(); i++) {
+                match = l[i].pos.x == r[i].pos.x && l[i].pos.y == r[i].pos.y &&
+                        l[i].halfDims.height == r[i].halfDims.height;
+            }
+            return match;
+        };
+
+        WHEN("StripGen is used on both formats") {
+            fmo::StripGen gen;
+            std::vector<fmo::Strip> fromGray, fromBinary;
+            int noiseGray, noiseBinary;
+            gen(gray, 2, 1, 2, fromGray, noiseGray);
+            gen(binary, 2, 1, 2, fromBinary, noiseBinary);
+            const int lastGrayX = 1 + 2 * ((wide.width / 8) * 8 - 1);
+            std::vector<fmo::Strip> fromBinaryGrayCols;
+            for (auto& strip : fromBinary) {
+                if (strip.pos.x <= lastGrayX) { fromBinaryGrayCols.push_back(strip); }
+            }
+
+            THEN("GRAY ignores the columns past the last multiple of 8") {
+                REQUIRE(!fromGray.empty());
+                REQUIRE(fromGray.back().pos.x <= lastGrayX);
+            }
+            THEN("BINARY includes the last column") {
+                REQUIRE(!fromBinary.empty());
+                REQUIRE(fromBinary.back().pos.x == 1 + 2 * (wide.width - 1));
+            }
+            THEN("the strips in the columns scanned by both formats are the same") {
+                REQUIRE(sameStrips(fromBinaryGrayCols, fromGray));
+            }
+        }
+        WHEN("StripGen is used on a region of each format") {
+            const fmo::Pos pos{64, 5};
+            const fmo::Dims dims{77, 30};
+            fmo::Region grayRegion = gray.region(pos, dims);
+            fmo::Region binaryRegion = binary.region(pos, dims);
+            fmo::Image expectedGray, expectedBinary;
+            fmo::copy(grayRegion, expectedGray);
+            fmo::convert(expectedGray, expectedBinary, fmo::Format::BINARY);
+            fmo::StripGen gen;
+            std::vector<fmo::Strip> fromExpectedGray, fromExpectedBinary, fromGray, fromBinary;
+            int noiseExpectedGray, noiseExpectedBinary, noiseGray, noiseBinary;
+            gen(expectedGray, 2, 1, 2, fromExpectedGray, noiseExpectedGray);
+            gen(expectedBinary, 2, 1, 2, fromExpectedBinary, noiseExpectedBinary);
+            gen(grayRegion, 2, 1, 2, fromGray, noiseGray);
+            gen(binaryRegion, 2, 1, 2, fromBinary, noiseBinary);
+
+            THEN("only the pixels inside the region are considered") {
+                REQUIRE(noiseGray == noiseExpectedGray);
+                REQUIRE(noiseBinary == noiseExpectedBinary);
+                REQUIRE(sameStrips(fromGray, fromExpectedGray));
+                REQUIRE(sameStrips(fromBinary, fromExpectedBinary));
+            }
+        }
+    }
+    GIVEN("two random BGR images") {
+        fmo::Image src1{fmo::Format::BGR, dims};
+        fmo::Image src2{fmo::Format::BGR, dims};
+        for (auto& value : src1) { value = uint8_t(uniform(re)); }
+        for (auto& value : src2) { value = uint8_t(uniform(re)); }
+
+        WHEN("Differentiator is configured to produce BINARY output") {
+            fmo::Differentiator::Config cfg;
+            fmo::Image gray, binary, unpacked;
+            fmo::Differentiator{cfg}(src1, src2, gray);
+            cfg.binary = true;
+            fmo::Differentiator{cfg}(src1, src2, binary);
+            fmo::convert(binary, unpacked, fmo::Format::GRAY);
+
+            THEN("the result matches the GRAY output") {
+                REQUIRE(binary.format() == fmo::Format::BINARY);
+                REQUIRE(binary.dims() == dims);
+                REQUIRE(exact_match(unpacked, gray));
+            }
+        }
+    }
+}
+
+SCENARIO("computing the distance transform of sparse binary images", "[image][processing]") {
+    std::mt19937 re{5489};
+    const fmo::Dims dims{93, 47};
+    auto randomBlobs = [&]() {
+        fmo::Image result{fmo::Format::GRAY, dims};
+        std::fill(begin(result), end(result), uint8_t(0x00));
+        for (int i = 0; i < 3; i++) {
+            int x0 = int(re() % dims.width), y0 = int(re() % dims.height);
+            int x1 = std::min(dims.width, x0 + 1 + int(re() % 20));
+            int y1 = std::min(dims.height, y0 + 1 + int(re() % 12));
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) {
+                    if (re() % 8 != 0) { result.data()[y * dims.width + x] = 0xFF; }
+                }
+            }
+        }
+        return result;
+    };
+    fmo::DistanceTransform distTran;
+    fmo::Image dist, maxima;
+
+    GIVEN("a series of binary images with a few blobs") {
+        WHEN("DistanceTransform and the OpenCV-based functions are used") {
+            bool distMatch = true;
+            bool maximaMatch = true;
+
+            for (int f = 0; f < 4; f++) {
+                fmo::Image src = randomBlobs();
+                distTran(src, dist, maxima);
+
+                fmo::Image expectedDist, expectedMaxima;
+                fmo::distance_transform(src, expectedDist);
+                fmo::local_maxima(expectedDist, expectedMaxima);
+                for (auto& value : expectedMaxima) {
+                    auto i = &value - expectedMaxima.data();
+                    if (src.data()[i] == 0) { value = 0x00; }
+                }
+
+                distMatch &= exact_match(dist, expectedDist);
+                maximaMatch &= exact_match(maxima, expectedMaxima);
+            }
+
+            THEN("distances match") { REQUIRE(distMatch); }
+            THEN("local maxima of the foreground match") { REQUIRE(maximaMatch); }
+        }
+    }
+}
+
+SCENARIO("finding the regions of a binary image that contain foreground", "[image][processing]") {
+    const fmo::Dims dims{200, 100};
+    fmo::Image src{fmo::Format::GRAY, dims};
+    std::fill(begin(src), end(src), uint8_t(0x00));
+    auto set = [&](int x, int y) { src.data()[y * dims.width + x] = 0xFF; };
+    fmo::TileMap tiles;
+
+    GIVEN("a binary image with a few isolated foreground pixels") {
+        set(0, 0);
+        set(40, 40);
+        set(150, 10);
+        set(199, 99);
+        tiles(src);
+        const auto& regions = tiles.regions();
+
+        THEN("pixels in adjacent tiles form a single region, distant ones are separate") {
+            REQUIRE(tiles.grid() == (fmo::Dims{7, 4}));
+            REQUIRE(regions.size() == 3);
+        }
+        THEN("every foreground pixel lies in exactly one region") {
+            for (auto pos : {fmo::Pos{0, 0}, fmo::Pos{40, 40}, fmo::Pos{150, 10},
+                             fmo::Pos{199, 99}}) {
+                int count = 0;
+                for (auto& r : regions) {
+                    if (pos.x >= r.min.x && pos.x <= r.max.x && pos.y >= r.min.y &&
+                        pos.y <= r.max.y) {
+                        count++;
+                    }
+                }
+                REQUIRE(count == 1);
+            }
+        }
+        WHEN("the distance transform is restricted to the regions") {
+            fmo::DistanceTransform distTran;
+            fmo::Image dist, maxima, expectedDist, expectedMaxima;
+            distTran(src, regions, dist, maxima);
+            distTran(src, expectedDist, expectedMaxima);
+
+            THEN("the result is the same as for the whole image") {
+                REQUIRE(exact_match(dist, expectedDist));
+                REQUIRE(exact_match(maxima, expectedMaxima));
+            }
+        }
+    }
+    GIVEN("a mask that excludes the left half of the image except for a few pixels") {
+        fmo::Image mask{fmo::Format::GRAY, dims};
+        std::fill(begin(mask), end(mask), uint8_t(0x00));
+        for (int y = 0; y < dims.height; y++) {
+            std::fill(mask.data() + y * dims.width + 100, mask.data() + (y + 1) * dims.width,
+                      uint8_t(0xFF));
+        }
+        mask.data()[40 * dims.width + 41] = 0xFF;
+        tiles.setMask(mask);
+
+        WHEN("foreground pixels lie on both sides of the mask boundary") {
+            set(40, 40);
+            set(41, 40);
+            set(80, 10);
+            set(99, 50);
+            set(100, 50);
+            set(150, 10);
+            tiles(src);
+            const auto& regions = tiles.regions();
+
+            THEN("only the pixels inside the mask remain in the regions") {
+                int count = 0;
+                for (auto& r : regions) {
+                    for (int y = r.min.y; y <= r.max.y; y++) {
+                        const uint8_t* row = src.data() + y * dims.width;
+                        count += int(std::count(row + r.min.x, row + r.max.x + 1, uint8_t(0xFF)));
+                    }
+                }
+                REQUIRE(count == 3);
+                REQUIRE(src.data()[40 * dims.width + 41] == 0xFF);
+                REQUIRE(src.data()[50 * dims.width + 100] == 0xFF);
+                REQUIRE(src.data()[10 * dims.width + 150] == 0xFF);
+            }
+            THEN("regions cover only tiles that intersect the mask") {
+                REQUIRE(regions.size() == 2);
+                for (auto& r : regions) { REQUIRE(r.max.x >= 32); }
+            }
+        }
+    }
+}
+
+SCENARIO("labeling connected components of a binary image", "[image][processing]") {
+    std::mt19937 re{5489};
+    std::uniform_int_distribution<int> uniform{0, 99};
+    const fmo::Dims dims{150, 70};
+    fmo::Image src{fmo::Format::GRAY, dims};
+    for (auto& value : src) { value = (uniform(re) < 40) ? uint8_t(0xFF) : uint8_t(0); }
+
+    // reference labeling by flood fill, components numbered in the order of their first pixel
+    std::vector<int> labels(src.size(), -1);
+    std::vector<int> areas;
+    for (int i = 0; i < int(src.size()); i++) {
+        if (src.data()[i] == 0 || labels[i] >= 0) continue;
+        std::vector<int> stack{i};
+        labels[i] = int(areas.size());
+        areas.push_back(0);
+        while (!stack.empty()) {
+            int j = stack.back();
+            stack.pop_back();
+            areas.back()++;
+            int x = j % dims.width, y = j / dims.width;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int nx = x + dx, ny = y + dy;
+                    if (nx < 0 || ny < 0 || nx >= dims.width || ny >= dims.height) continue;
+                    int k = ny * dims.width + nx;
+                    if (src.data()[k] == 0 || labels[k] >= 0) continue;
+                    labels[k] = labels[i];
+                    stack.push_back(k);
+                }
+            }
+        }
+    }
+    auto matchesReference = [&](const fmo::ComponentLabeler& labeler) {
+        const auto& comps = labeler.components();
+        const auto& runs = labeler.runs();
+        bool match = comps.size() == areas.size();
+        int covered = 0;
+        for (int c = 0; match && c < int(comps.size()); c++) {
+            match = comps[c].area == areas[c];
+            for (int r = comps[c].firstRun; r < comps[c].firstRun + comps[c].numRuns; r++) {
+                for (int x = runs[r].x0; x < runs[r].x1; x++) {
+                    match = match && labels[runs[r].y * dims.width + x] == c;
+                    covered++;
+                }
+            }
+        }
+        int foreground = int(std::count_if(src.begin(), src.end(), [](uint8_t v) { return v; }));
+        return match && covered == foreground;
+    };
+
+    GIVEN("a random GRAY image") {
+        WHEN("the whole image is labeled") {
+            fmo::ComponentLabeler labeler;
+            labeler(src);
+
+            THEN("the components match the flood fill") { REQUIRE(matchesReference(labeler)); }
+            THEN("the statistics describe the pixels of each component") {
+                const auto& comps = labeler.components();
+                bool match = true;
+                for (int c = 0; c < int(comps.size()); c++) {
+                    fmo::Bounds bounds{{dims.width, dims.height}, {-1, -1}};
+                    double sumX = 0, sumY = 0;
+                    for (int i = 0; i < int(src.size()); i++) {
+                        if (labels[i] != c) continue;
+                        int x = i % dims.width, y = i / dims.width;
+                        bounds.min = {std::min(bounds.min.x, x), std::min(bounds.min.y, y)};
+                        bounds.max = {std::max(bounds.max.x, x), std::max(bounds.max.y, y)};
+                        sumX += x;
+                        sumY += y;
+                    }
+                    match = match && comps[c].bounds == bounds &&
+                            comps[c].centerX == Approx(sumX / areas[c]) &&
+                            comps[c].centerY == Approx(sumY / areas[c]);
+                }
+                REQUIRE(match);
+            }
+        }
+        WHEN("the image is converted to BINARY and labeled") {
+            fmo::Image binary;
+            fmo::convert(src, binary, fmo::Format::BINARY);
+            fmo::ComponentLabeler labeler;
+            labeler(binary);
+
+            THEN("the components match the flood fill") { REQUIRE(matchesReference(labeler)); }
+        }
+        WHEN("the whole image is labeled as a single area") {
+            fmo::ComponentLabeler labeler;
+            labeler(src, {fmo::Bounds{{0, 0}, {dims.width - 1, dims.height - 1}}});
+
+            THEN("the components match the flood fill") { REQUIRE(matchesReference(labeler)); }
+        }
+    }
+}
+
+SCENARIO("clustering a large number of items", "[processing]") {
+    GIVEN("300 unit segments on a line, in groups of three separated by wide gaps") {
+        struct Segment {
+            int x0, x1;
+            bool valid;
+        };
+        std::vector<Segment> segments;
+        for (int i = 0; i < 300; i++) {
+            int x = (i / 3) * 10 + (i % 3) * 2;
+            segments.push_back({x, x + 1, true});
+        }
+
+        WHEN("segments closer than three units are merged") {
+            auto distance = [&](fmo::Agglomerator::Id_t i, fmo::Agglomerator::Id_t j) {
+                const Segment* l = &segments[i];
+                const Segment* r = &segments[j];
+                if (l->x0 > r->x0) std::swap(l, r);
+                int gap = r->x0 - l->x1;
+                if (gap < 0 || gap >= 3) return fmo::Agglomerator::infDist;
+                return fmo::Agglomerator::Dist_t(gap);
+            };
+            auto merge = [&](fmo::Agglomerator::Id_t i, fmo::Agglomerator::Id_t j) {
+                segments[i].x0 = std::min(segments[i].x0, segments[j].x0);
+                segments[i].x1 = std::max(segments[i].x1, segments[j].x1);
+                segments[j].valid = false;
+            };
+            fmo::Agglomerator aggl;
+            aggl(distance, merge, fmo::Agglomerator::Id_t(segments.size()));
+
+            THEN("every group becomes a single cluster") {
+                int numValid = 0;
+                bool match = true;
+                for (auto& segment : segments) {
+                    if (!segment.valid) continue;
+                    numValid++;
+                    match = match && segment.x0 % 10 == 0 && segment.x1 == segment.x0 + 5;
+                }
+                REQUIRE(numValid == 100);
+                REQUIRE(match);
+            }
+        }
+    }
+}
+
+SCENARIO("fitting a circle to the points of a curved trajectory", "[processing]") {
+    GIVEN("points on an arc of a circle with small perturbations") {
+        const float cx = 120, cy = 80, r = 60;
+        std::vector<cv::Point2f> pts;
+        std::mt19937 gen(12345);
+        std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+        for (int i = 0; i < 100; i++) {
+            float angle = 0.01f * i;
+            pts.emplace_back(cx + r * std::cos(angle) + noise(gen),
+                             cy + r * std::sin(angle) + noise(gen));
+        }
+
+        WHEN("fitcircle() is called twice") {
+            fmo::SCircle circle1, circle2;
+            float score1 = fmo::fitcircle(pts, 3, circle1);
+            float score2 = fmo::fitcircle(pts, 3, circle2);
+
+            THEN("the results are identical") {
+                REQUIRE(score1 == score2);
+                REQUIRE(circle1.x == circle2.x);
+                REQUIRE(circle1.y == circle2.y);
+                REQUIRE(circle1.radius == circle2.radius);
+            }
+            THEN("the circle is close to the original one") {
+                REQUIRE(score1 > 0);
+                REQUIRE(std::abs(circle1.x - cx) < 0.1f * r);
+                REQUIRE(std::abs(circle1.y - cy) < 0.1f * r);
+                REQUIRE(std::abs(circle1.radius - r) < 0.1f * r);
+            }
+        }
+    }
+}
+
+SCENARIO("re-fitting the union of two point sets from accumulated statistics", "[processing]") {
+    GIVEN("two halves of an arc of a circle") {
+        const float cx = -30, cy = 200, r = 80;
+        std::vector<cv::Point2f> first, second;
+        for (int i = 0; i < 40; i++) {
+            float angle = 0.02f * i;
+            auto& half = (i < 20) ? first : second;
+            half.emplace_back(cx + r * std::cos(angle), cy + r * std::sin(angle));
+        }
+        fmo::FitAccumulator acc1{first}, acc2{second};
+        fmo::FitAccumulator merged = acc1 + acc2;
+
+        THEN("merging is equivalent to accumulating all points") {
+            fmo::FitAccumulator all{first};
+            all.add(second);
+            float x1, y1, r1, x2, y2, r2;
+            merged.circle(x1, y1, r1);
+            all.circle(x2, y2, r2);
+            REQUIRE(merged.count() == 40);
+            REQUIRE(x1 == Approx(x2));
+            REQUIRE(y1 == Approx(y2));
+            REQUIRE(r1 == Approx(r2));
+        }
+        THEN("the circle fit recovers the original circle") {
+            float x, y, radius;
+            float rms = merged.circle(x, y, radius);
+            REQUIRE(x == Approx(cx).epsilon(0.01));
+            REQUIRE(y == Approx(cy).epsilon(0.01));
+            REQUIRE(radius == Approx(r).epsilon(0.01));
+            REQUIRE(rms < 0.1f);
+        }
+        THEN("the line fit goes through the centroid and has a large residual") {
+            cv::Point2f point, dir;
+            float rms = merged.line(point, dir);
+            REQUIRE(std::abs(dir.x * dir.x + dir.y * dir.y - 1) < 1e-4f);
+            REQUIRE(rms > 1.f);
+        }
+    }
+}
+
+namespace {
+    /// Collects the pixels covered by a curve drawn by OpenCV, like the pixels of a connected
+    /// component, and their bounding box.
+    std::vector<cv::Point2f> drawnPixels(const fmo::Curve& curve, float thickness,
+                                         fmo::Bounds& box) {
+        const int size = 256;
+        cv::Mat buf(size, size, CV_8UC1, cv::Scalar(0));
+        curve.draw(buf, 1, thickness);
+        std::vector<cv::Point2f> result;
+        box = {{size, size}, {-1, -1}};
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                if (buf.at<uint8_t>(y, x) == 0) continue;
+                result.emplace_back(float(x), float(y));
+                box.min = {std::min(box.min.x, x), std::min(box.min.y, y)};
+                box.max = {std::max(box.max.x, x), std::max(box.max.y, y)};
+            }
+        }
+        return result;
+    }
+
+    /// Calculates the IoU by drawing the curve into an image the size of the box, like
+    /// TaxonomyV1 used to before curveIoU() was introduced.
+    float rasterIoU(fmo::Curve curve, float thickness, const std::vector<cv::Point2f>& pixels,
+                    const fmo::Bounds& box) {
+        cv::Mat buf(box.max.y - box.min.y + 1, box.max.x - box.min.x + 1, CV_8UC1,
+                    cv::Scalar(0));
+        curve.common().shift = {float(box.min.x), float(box.min.y)};
+        curve.draw(buf, 1, thickness);
+        int inters = 0;
+        for (auto& pix : pixels) {
+            if (buf.at<uint8_t>(int(pix.y) - box.min.y, int(pix.x) - box.min.x) > 0) inters++;
+        }
+        int unio = int(pixels.size()) + cv::countNonZero(buf) - inters;
+        return float(inters) / float(unio);
+    }
+
+    fmo::SLine makeLine(cv::Point2f start, cv::Point2f end) {
+        fmo::SLine line;
+        line.start = start;
+        line.end = end;
+        return line;
+    }
+
+    fmo::SCircle makeArc(float x, float y, float radius, double startDegree, double endDegree) {
+        fmo::SCircle circle;
+        circle.x = x;
+        circle.y = y;
+        circle.radius = radius;
+        circle.startDegree = startDegree;
+        circle.endDegree = endDegree;
+        return circle;
+    }
+}
+
+SCENARIO("computing the IoU of a curve and a set of pixels", "[processing]") {
+    // each fitted curve is paired with the curves that produced the pixels: the same curve, then
+    // curves that overlap it only partially
+    struct Case {
+        fmo::Curve fitted;
+        std::vector<fmo::Curve> drawn;
+    };
+    const std::vector<Case> cases = {
+        {makeLine({40, 50}, {140, 90}),
+         {makeLine({40, 50}, {140, 90}), makeLine({40, 56}, {140, 96}),
+          makeLine({40, 50}, {90, 70})}},
+        {makeArc(100, 100, 50, 30, 200),
+         {makeArc(100, 100, 50, 30, 200), makeArc(104, 103, 50, 30, 200),
+          makeArc(100, 100, 50, 100, 300)}},
+        {makeArc(100, 100, 50, 0, 360),
+         {makeArc(100, 100, 50, 0, 360), makeArc(100, 100, 56, 0, 360)}},
+    };
+
+    // OpenCV draws an odd thickness like the next even one and it also fills the pixels on the
+    // boundary, so the rasterized curve is up to a pixel wider than the analytic one
+    GIVEN("curves drawn with an even thickness") {
+        THEN("the analytic IoU is close to the rasterized IoU") {
+            for (float thickness : {16.f, 20.f}) {
+                for (auto& c : cases) {
+                    for (size_t i = 0; i < c.drawn.size(); i++) {
+                        fmo::Bounds box;
+                        auto pixels = drawnPixels(c.drawn[i], thickness, box);
+                        REQUIRE(!pixels.empty());
+                        float expected = rasterIoU(c.fitted, thickness, pixels, box);
+                        float iou = fmo::curveIoU(c.fitted, thickness, pixels, box);
+                        INFO("thickness " << thickness << ", drawn curve " << i);
+                        REQUIRE(std::abs(iou - expected) < 0.1f);
+                        if (i == 0) {
+                            REQUIRE(expected == 1.f);
+                        } else {
+                            REQUIRE(expected < 1.f);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#include "../catch/catch.hpp"
+#include <atomic>
+#include <chrono>
+#include <fmo/queue.hpp>
+#include <memory>
+#include <thread>
+
+namespace {
+    /// Time given to another thread to reach a blocking call.
+    const std::chrono::milliseconds settleTime{50};
+}
+
+SCENARIO("passing items through a bounded queue", "[queue]") {
+    GIVEN("a queue with a capacity of three") {
+        fmo::BoundedQueue<std::unique_ptr<int>> q{3};
+
+        WHEN("items are pushed and popped") {
+            for (int i = 0; i < 3; i++) { REQUIRE(q.push(std::make_unique<int>(i))); }
+            THEN("they are received in the order of pushing") {
+                std::unique_ptr<int> item;
+                for (int i = 0; i < 3; i++) {
+                    REQUIRE(q.pop(item));
+                    REQUIRE(*item == i);
+                }
+            }
+        }
+
+        WHEN("a producer pushes more items than fit into the queue") {
+            std::atomic<int> numPushed{0};
+            std::thread producer([&]() {
+                for (int i = 0; i < 5; i++) {
+                    q.push(std::make_unique<int>(i));
+                    numPushed++;
+                }
+            });
+            std::this_thread::sleep_for(settleTime);
+
+            THEN("the producer blocks until there is space and the order is kept") {
+                REQUIRE(numPushed == 3);
+                std::unique_ptr<int> item;
+                REQUIRE(q.pop(item));
+                REQUIRE(*item == 0);
+                for (int i = 1; i < 5; i++) {
+                    REQUIRE(q.pop(item));
+                    REQUIRE(*item == i);
+                }
+                producer.join();
+                REQUIRE(numPushed == 5);
+            }
+        }
+
+        WHEN("a consumer waits for an item") {
+            std::atomic<bool> received{false};
+            std::unique_ptr<int> item;
+            std::thread consumer([&]() {
+                q.pop(item);
+                received = true;
+            });
+            std::this_thread::sleep_for(settleTime);
+
+            THEN("it blocks until an item is pushed") {
+                REQUIRE(!received);
+                REQUIRE(q.push(std::make_unique<int>(7)));
+                consumer.join();
+                REQUIRE(received);
+                REQUIRE(*item == 7);
+            }
+        }
+
+        WHEN("the queue is closed while a consumer waits") {
+            std::atomic<int> result{-1};
+            std::thread consumer([&]() {
+                std::unique_ptr<int> item;
+                result = q.pop(item) ? 1 : 0;
+            });
+            std::this_thread::sleep_for(settleTime);
+            q.close();
+            consumer.join();
+
+            THEN("the consumer wakes up and receives nothing") { REQUIRE(result == 0); }
+        }
+
+        WHEN("the queue is closed while a producer waits") {
+            for (int i = 0; i < 3; i++) { REQUIRE(q.push(std::make_unique<int>(i))); }
+            auto extra = std::make_unique<int>(3);
+            std::atomic<int> result{-1};
+            std::thread producer([&]() { result = q.push(std::move(extra)) ? 1 : 0; });
+            std::this_thread::sleep_for(settleTime);
+            q.close();
+            producer.join();
+
+            THEN("the push fails without taking the item") {
+                REQUIRE(result == 0);
+                REQUIRE(extra);
+                REQUIRE(*extra == 3);
+            }
+            THEN("the items that are already queued can still be received") {
+                std::unique_ptr<int> item;
+                for (int i = 0; i < 3; i++) {
+                    REQUIRE(q.pop(item));
+                    REQUIRE(*item == i);
+                }
+                REQUIRE(!q.pop(item));
+            }
+        }
+    }
+}